@@ -0,0 +1,66 @@
+# External Attribute Skeleton
+#
+# Input: Multi-trace, single attribute, batches of trace positions
+# Output: Single attribute
+#
+import sys,os
+import numpy as np
+#
+# Import the module with the I/O scaffolding of the External Attribute
+#
+sys.path.insert(0, os.path.join(sys.path[0], '..'))
+import extattrib as xa
+
+#
+# The attribute parameters - keep what you need
+#
+#	BatchSize asks the plugin to send up to this many trace positions (consecutive along the crossline)
+#	in each frame. Older plugins ignore it and xa.doBatchInput then returns batches of a single trace.
+#
+xa.params = {
+	'Inputs': ['Input'],
+	'ZSampMargin' : {'Value': [-30,30], 'Minimum': [-1,1], 'Symmetric': True, 'Hidden': False},
+	'StepOut' : {'Value': [1,1], 'Minimum': [1,1], 'Hidden': False},
+	'BatchSize' : 64,
+	'Parallel' : False,
+	'Help'  : 'http://waynegm.github.io/OpendTect-Plugin-Docs/Attributes/ExternalAttrib/'
+}
+#
+# Define the compute function
+#
+def doCompute():
+	number_inline = xa.SI['nrinl']
+	number_xline = xa.SI['nrcrl']
+#
+#	This is the batch processing loop
+#
+	while True:
+		xa.doBatchInput()
+#
+#	After doBatchInput the TraceInfo array, xa.BTI, has one entry per trace position in the batch
+#
+		number_of_traces = len(xa.BTI)
+		current_crosslines = xa.BTI['crl']
+#
+#	Get the input - an array of shape (number_of_traces, number_inline, number_xline, number_of_samples)
+#
+		indata = xa.Input['Input']
+#
+#	Your attribute calculation goes here - operate on the whole batch at once
+#
+		outdata = np.mean(indata, axis=(1,2))
+#------------------------------------------------------------------------------------
+#
+#	The output must have shape (number_of_traces, number_of_samples)
+#
+		xa.Output = outdata
+		xa.doBatchOutput()
+
+#
+# Assign the compute function to the attribute
+#
+xa.doCompute = doCompute
+#
+# Do it
+#
+xa.run(sys.argv[1:])
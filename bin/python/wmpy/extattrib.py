@@ -10,7 +10,7 @@
 # Date: 		March, 2016
 # Homepage:		http://waynegm.github.io/OpendTect-Plugin-Docs/external_attributes/
 #
-import sys, getopt, os, json, urllib
+import sys, getopt, os, json, urllib.parse, mmap
 import numpy as np
 
 import logging
@@ -26,7 +26,12 @@ Input = {}
 Output = {}
 TI = {}
 SI = {}
+BTI = {}
+BatchSize = 1
+Shm = None
+ShmSlots = 2
 undef = 1e30
+_batch = {'TI': [], 'Input': {}, 'Output': [], 'pos': 0}
 
 def doCompute():
     global Output
@@ -38,6 +43,9 @@ def doCompute():
 def doInput():
 	global Input
 	global TI
+	if isFramed():
+		doBatchTraceInput()
+		return
 	TI = np.frombuffer(sys.__stdin__.buffer.read(dt_trcInfo.itemsize), dtype=dt_trcInfo, count=1)[0]
 	nrsamples = TI['nrsamp']*SI['nrtraces']
 	if 'Inputs' in params:
@@ -48,6 +56,9 @@ def doInput():
 
 def doOutput():
 	global Output
+	if isFramed():
+		doBatchTraceOutput()
+		return
 	if 'Output' in params:
 	  for out in params['Output']:
 	    Output[out][np.isnan(Output[out])] = undef
@@ -57,6 +68,154 @@ def doOutput():
 	    sys.__stdout__.buffer.write(Output.astype(np.float32,copy=False).tobytes())
 	sys.__stdout__.flush()
 
+#
+# Batch protocol (version 2) - only used when the plugin adds a 'Protocol' key with a BatchSize > 1
+# to the parameters, which it does for scripts that request it with a 'BatchSize' parameter.
+#
+# Each frame holds up to BatchSize traces: an int32 trace count, an array of trace info blocks and then
+# one (nrbatch, nrinl, nrcrl, nrsamp) block per input. The reply is one (nrbatch, nrsamp) block per output.
+#
+def isFramed():
+	return BatchSize > 1 or Shm is not None
+
+def readBatch():
+	if Shm is not None:
+		return readShmBatch()
+	nrbatch = np.frombuffer(sys.__stdin__.buffer.read(4), dtype='i4', count=1)[0]
+	bti = np.frombuffer(sys.__stdin__.buffer.read(nrbatch*dt_trcInfo.itemsize), dtype=dt_trcInfo, count=nrbatch)
+	nrsamp = bti[0]['nrsamp']
+	nrsamples = nrbatch*SI['nrtraces']*nrsamp
+	shape = (nrbatch, SI['nrinl'], SI['nrcrl'], nrsamp)
+	if 'Inputs' in params:
+		inputs = {}
+		for inp in params['Inputs']:
+			inputs[inp] = np.reshape(np.frombuffer(sys.__stdin__.buffer.read(nrsamples*4), dtype="f4", count=nrsamples), shape)
+	else:
+		inputs = np.reshape(np.frombuffer(sys.__stdin__.buffer.read(nrsamples*4), dtype="f4", count=nrsamples), shape)
+	return bti, inputs
+
+def writeBatch(outputs):
+	if Shm is not None:
+		writeShmBatch(outputs)
+		return
+	if 'Output' in params:
+	  for out in params['Output']:
+	    res = np.asarray(outputs[out], dtype=np.float32)
+	    res = np.where(np.isnan(res), np.float32(undef), res)
+	    sys.__stdout__.buffer.write(res.tobytes())
+	else:
+	    res = np.asarray(outputs, dtype=np.float32)
+	    res = np.where(np.isnan(res), np.float32(undef), res)
+	    sys.__stdout__.buffer.write(res.tobytes())
+	sys.__stdout__.flush()
+
+#
+# Shared memory transport - the plugin passes the name of a POSIX shared memory ring in the 'Protocol' parameters.
+# The pipe then only carries an int32 slot number and the batch header, the input and output of each slot are
+# accessed in place and the reply is an int32 count of traces written to the output slab.
+#
+def openShm(size):
+	path = os.path.join('/dev/shm', Shm['name'].lstrip('/'))
+	if os.path.exists(path):
+		fd = os.open(path, os.O_RDWR)
+		try:
+			Shm['map'] = mmap.mmap(fd, size)
+		finally:
+			os.close(fd)
+	else:
+		from multiprocessing import shared_memory, resource_tracker
+		obj = shared_memory.SharedMemory(name=Shm['name'].lstrip('/'))
+		try:
+			resource_tracker.unregister(obj._name, 'shared_memory')
+		except Exception:
+			pass
+		Shm['obj'] = obj
+		Shm['map'] = obj.buf
+	Shm['size'] = size
+
+def readShmBatch():
+	slot, nrbatch = np.frombuffer(sys.__stdin__.buffer.read(8), dtype='i4', count=2)
+	bti = np.frombuffer(sys.__stdin__.buffer.read(nrbatch*dt_trcInfo.itemsize), dtype=dt_trcInfo, count=nrbatch)
+	nrsamp = bti[0]['nrsamp']
+	inpblk = BatchSize*SI['nrtraces']*nrsamp
+	outblk = BatchSize*nrsamp
+	slotsize = SI['nrinput']*inpblk + SI['nroutput']*outblk
+	if Shm['size'] < ShmSlots*slotsize*4:
+		openShm(ShmSlots*slotsize*4)
+	base = slot*slotsize
+	shape = (BatchSize, SI['nrinl'], SI['nrcrl'], nrsamp)
+	def inpview(idx):
+		return np.frombuffer(Shm['map'], dtype='f4', count=inpblk, offset=(base+idx*inpblk)*4).reshape(shape)[:nrbatch]
+	outbase = base + SI['nrinput']*inpblk
+	Shm['out'] = [np.frombuffer(Shm['map'], dtype='f4', count=outblk, offset=(outbase+idx*outblk)*4).reshape((BatchSize, nrsamp))[:nrbatch]
+					for idx in range(SI['nroutput'])]
+	if 'Inputs' in params:
+		inputs = {inp: inpview(idx) for idx, inp in enumerate(params['Inputs'])}
+	else:
+		inputs = inpview(0)
+	return bti, inputs
+
+def writeShmBatch(outputs):
+	if 'Output' in params:
+		results = [outputs[out] for out in params['Output']]
+	else:
+		results = [outputs]
+	for view, res in zip(Shm['out'], results):
+		np.copyto(view, np.reshape(res, view.shape), casting='unsafe')
+		view[np.isnan(view)] = undef
+	sys.__stdout__.buffer.write(np.int32(len(Shm['out'][0])).tobytes())
+	sys.__stdout__.flush()
+
+def doBatchInput():
+	global Input
+	global BTI
+	if isFramed():
+		BTI, Input = readBatch()
+	else:
+		doInput()
+		BTI = np.array([TI], dtype=dt_trcInfo)
+		if 'Inputs' in params:
+			Input = {inp: Input[inp][np.newaxis] for inp in params['Inputs']}
+		else:
+			Input = Input[np.newaxis]
+
+def doBatchOutput():
+	global Output
+	if isFramed():
+		writeBatch(Output)
+	else:
+		if 'Output' in params:
+			Output = {out: np.asarray(Output[out])[0] for out in params['Output']}
+		else:
+			Output = np.asarray(Output)[0]
+		doOutput()
+
+def doBatchTraceInput():
+	global Input
+	global TI
+	if _batch['pos'] == 0:
+		_batch['TI'], _batch['Input'] = readBatch()
+		_batch['Output'] = []
+	pos = _batch['pos']
+	TI = _batch['TI'][pos]
+	if 'Inputs' in params:
+		Input = {inp: _batch['Input'][inp][pos] for inp in params['Inputs']}
+	else:
+		Input = _batch['Input'][pos]
+	_batch['pos'] += 1
+
+def doBatchTraceOutput():
+	if 'Output' in params:
+		_batch['Output'].append({out: np.array(Output[out], dtype=np.float32) for out in params['Output']})
+	else:
+		_batch['Output'].append(np.array(Output, dtype=np.float32))
+	if len(_batch['Output']) == len(_batch['TI']):
+		if 'Output' in params:
+			writeBatch({out: np.stack([res[out] for res in _batch['Output']]) for out in params['Output']})
+		else:
+			writeBatch(np.stack(_batch['Output']))
+		_batch['pos'] = 0
+
 def writePar():
 	try:
 		print(urllib.parse.quote(json.dumps(params)), file=sys.stdout)
@@ -77,7 +236,13 @@ def preCompute():
 	global dt_trcInfo
 	global SI
 	global Output
+	global BatchSize
+	global Shm
 	Output = {}
+	if 'Protocol' in params and params['Protocol'].get('Version', 1) >= 2:
+		BatchSize = int(params['Protocol'].get('BatchSize', 1))
+		if params['Protocol'].get('Transport') == 'shm':
+			Shm = {'name': params['Protocol']['ShmName'], 'map': None, 'size': 0, 'out': []}
 	dt_trcInfo = np.dtype([	('nrsamp','i4'),
 							('z0','i4'),
 							('inl','i4'),
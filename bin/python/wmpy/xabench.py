@@ -0,0 +1,197 @@
+#
+# External Attribute Benchmark
+#
+# Copyright (C) 2026 Wayne Mogg All rights reserved.
+#
+# This file may be used under the terms of the MIT License
+# (https://github.com/waynegm/OpendTect-External-Attributes/blob/master/LICENSE)
+#
+# Author:		Wayne Mogg
+# Date: 		October, 2026
+# Homepage:		http://waynegm.github.io/OpendTect-Plugin-Docs/external_attributes/
+#
+# Drives external attribute scripts through the same stdin/stdout protocol the OpendTect plugin uses,
+# with synthetic SeisInfo/TrcInfo frames and random input, and reports startup time, throughput and
+# per-trace latency. Needs only the interpreter and the packages the scripts import, not OpendTect.
+#
+# Usage: python xabench.py [options] script.py [script.py ...]
+#   -s, --stepout	comma separated list of inline x crossline stepouts, eg 0x0,1x1,2x2 (default: script value)
+#   -n, --nrsamples	comma separated list of trace lengths in samples (default: 100,500)
+#   -t, --traces	number of timed traces per run (default: 200)
+#   -w, --warmup	number of untimed traces after startup (default: 5)
+#   -b, --batch		batch size for the batched protocol, 1 uses the single trace protocol (default: 1)
+#   -i, --interpreter	python interpreter to run the scripts with (default: this one)
+#   -c, --csv		also write the results to this csv file
+#
+import sys, os, getopt, glob, json, struct, subprocess, tempfile, time, urllib.parse
+import numpy as np
+
+dt_seisInfo = struct.Struct('5i5f')
+dt_trcInfo = struct.Struct('4i')
+
+def getParams(interp, script):
+	res = subprocess.run([interp, script, '-g'], capture_output=True, text=True)
+	if res.returncode != 0:
+		raise RuntimeError('getpar failed:\n%s' % res.stderr)
+	return json.loads(urllib.parse.unquote(res.stdout.strip()))
+
+def readExact(stream, nbytes):
+	buf = stream.read(nbytes)
+	if len(buf) != nbytes:
+		raise EOFError('external attribute closed its output')
+	return buf
+
+def percentile(vals, pct):
+	return float(np.percentile(vals, pct)) if len(vals) else float('nan')
+
+def runCase(interp, script, params, stepout, nrsamples, nrtraces, nrwarmup, batchsize):
+	params = dict(params)
+	if 'StepOut' in params and stepout is not None:
+		params['StepOut'] = dict(params['StepOut'], Value=list(stepout))
+	so = params['StepOut']['Value'] if 'StepOut' in params else [0,0]
+	nrinl, nrcrl = 2*so[0]+1, 2*so[1]+1
+	zm = params['ZSampMargin']['Value'] if 'ZSampMargin' in params else [0,0]
+	nrsamp = nrsamples + zm[1] - zm[0]
+	nrin = len(params['Inputs']) if 'Inputs' in params else 1
+	nrout = len(params['Output']) if 'Output' in params else 1
+	if batchsize > 1:
+		params['Protocol'] = {'Version': 2, 'BatchSize': batchsize}
+	nrbatch = max(batchsize, 1)
+
+	rng = np.random.default_rng(12345)
+	data = rng.standard_normal((nrin, nrbatch, nrinl*nrcrl, nrsamp)).astype(np.float32).tobytes()
+	outbytes = nrout*nrbatch*nrsamp*4
+
+	def frame(trc):
+		if batchsize > 1:
+			hdr = struct.pack('i', nrbatch) + b''.join(dt_trcInfo.pack(nrsamp, zm[0], 100, trc*nrbatch+idx) for idx in range(nrbatch))
+		else:
+			hdr = dt_trcInfo.pack(nrsamp, zm[0], 100, trc)
+		return hdr + data
+
+	with tempfile.TemporaryFile() as log:
+		start = time.perf_counter()
+		proc = subprocess.Popen([interp, script, '-c', urllib.parse.quote(json.dumps(params))],
+								stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=log)
+		try:
+			proc.stdin.write(dt_seisInfo.pack(nrinl*nrcrl, nrin, nrout, nrinl, nrcrl, 0.004, 25.0, 25.0, 1.0, 1.0))
+			latency = []
+			for trc in range(1 + nrwarmup + nrtraces):
+				t0 = time.perf_counter()
+				proc.stdin.write(frame(trc))
+				proc.stdin.flush()
+				readExact(proc.stdout, outbytes)
+				t1 = time.perf_counter()
+				if trc == 0:
+					startup = t1 - start
+				elif trc > nrwarmup:
+					latency.append(t1 - t0)
+		except (EOFError, BrokenPipeError) as err:
+			proc.kill()
+			proc.wait()
+			log.seek(0)
+			raise RuntimeError('%s\n%s' % (err, log.read().decode(errors='replace')))
+		proc.stdin.close()
+		proc.kill()
+		proc.wait()
+
+	total = sum(latency)
+	return {
+		'script': os.path.basename(script),
+		'stepout': '%dx%d' % (so[0], so[1]),
+		'nrsamples': nrsamples,
+		'batch': nrbatch,
+		'startup_s': startup,
+		'traces_per_s': nrbatch*len(latency)/total if total > 0 else float('nan'),
+		'p50_ms': 1000*percentile(latency, 50)/nrbatch,
+		'p90_ms': 1000*percentile(latency, 90)/nrbatch,
+		'p99_ms': 1000*percentile(latency, 99)/nrbatch,
+	}
+
+columns = ['script', 'stepout', 'nrsamples', 'batch', 'startup_s', 'traces_per_s', 'p50_ms', 'p90_ms', 'p99_ms']
+
+def printRow(row):
+	print('%-45s %7s %9s %5s %9.3f %12.1f %8.3f %8.3f %8.3f' % tuple(row[col] for col in columns))
+
+def usage():
+	with open(__file__) as fh:
+		for line in fh:
+			if line.startswith('# Usage') or line.startswith('#   '):
+				print(line[2:].rstrip())
+
+def parseStepouts(arg):
+	res = []
+	for item in arg.split(','):
+		inl, crl = item.lower().split('x')
+		res.append((int(inl), int(crl)))
+	return res
+
+def main(argv):
+	stepouts = [None]
+	nrsamples = [100, 500]
+	nrtraces = 200
+	nrwarmup = 5
+	batchsize = 1
+	interp = sys.executable
+	csvfile = None
+	try:
+		opts, args = getopt.getopt(argv, 'hs:n:t:w:b:i:c:',
+					['help', 'stepout=', 'nrsamples=', 'traces=', 'warmup=', 'batch=', 'interpreter=', 'csv='])
+	except getopt.GetoptError as err:
+		print(err)
+		usage()
+		return 2
+	for opt, arg in opts:
+		if opt in ('-h', '--help'):
+			usage()
+			return 0
+		elif opt in ('-s', '--stepout'):
+			stepouts = parseStepouts(arg)
+		elif opt in ('-n', '--nrsamples'):
+			nrsamples = [int(val) for val in arg.split(',')]
+		elif opt in ('-t', '--traces'):
+			nrtraces = int(arg)
+		elif opt in ('-w', '--warmup'):
+			nrwarmup = int(arg)
+		elif opt in ('-b', '--batch'):
+			batchsize = int(arg)
+		elif opt in ('-i', '--interpreter'):
+			interp = arg
+		elif opt in ('-c', '--csv'):
+			csvfile = arg
+
+	scripts = [fn for pattern in args for fn in sorted(glob.glob(pattern))]
+	if not scripts:
+		usage()
+		return 2
+
+	print('%-45s %7s %9s %5s %9s %12s %8s %8s %8s' % tuple(columns))
+	rows = []
+	status = 0
+	for script in scripts:
+		try:
+			params = getParams(interp, script)
+		except Exception as err:
+			print('%-45s failed: %s' % (os.path.basename(script), err))
+			status = 1
+			continue
+		for stepout in stepouts:
+			for ns in nrsamples:
+				try:
+					row = runCase(interp, script, params, stepout, ns, nrtraces, nrwarmup, batchsize)
+				except Exception as err:
+					print('%-45s failed: %s' % (os.path.basename(script), err))
+					status = 1
+					continue
+				printRow(row)
+				rows.append(row)
+
+	if csvfile:
+		with open(csvfile, 'w') as fh:
+			fh.write(','.join(columns) + '\n')
+			for row in rows:
+				fh.write(','.join(str(row[col]) for col in columns) + '\n')
+	return status
+
+if __name__ == '__main__':
+	sys.exit(main(sys.argv[1:]))
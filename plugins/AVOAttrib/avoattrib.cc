@@ -25,6 +25,9 @@
 #include "attribparam.h"
 
 #include "math2.h"
+#include "tracegather.h"
+
+#include <vector>
 
 
 namespace Attrib
@@ -43,6 +46,7 @@ void AVOAttrib::initClass()
 	output->addEnum( "Crossplot Angle" );
 	output->addEnum( "Crossplot Deviation" );
 	output->addEnum( "AVO Class" );
+	output->addEnum( "Fluid, Lithology and Class" );
 	desc->addParam( output );
     
     FloatParam* slope = new FloatParam( slopeStr() );
@@ -79,7 +83,21 @@ void AVOAttrib::updateDesc( Desc& desc )
 	desc.setParamEnabled( intercept_devStr(), output=="Crossplot Angle" || output=="Crossplot Deviation" );
 	desc.setParamEnabled( gradient_devStr(), output=="Crossplot Angle" || output=="Crossplot Deviation" );
 	desc.setParamEnabled( correlationStr(), output=="Crossplot Deviation" );
-	desc.setParamEnabled( class2Str(), output=="AVO Class" );
+	desc.setParamEnabled( class2Str(), output=="AVO Class" || output=="Fluid, Lithology and Class" );
+	desc.setNrOutputs( Seis::UnknowData, output=="Fluid, Lithology and Class" ? 3 : 1 );
+}
+
+void AVOAttrib::getCompNames( BufferStringSet& nms ) const
+{
+	if ( output_ != FluidLithClass ) {
+		Provider::getCompNames( nms );
+		return;
+	}
+
+	nms.erase();
+	nms.add( "Fluid Factor" );
+	nms.add( "Lithology Factor" );
+	nms.add( "AVO Class" );
 }
 
 AVOAttrib::AVOAttrib( Desc& desc )
@@ -95,7 +113,17 @@ AVOAttrib::AVOAttrib( Desc& desc )
 	mGetFloat( class2width_, class2Str() );
 	
 	xplotang_ = float(slope_ < 0 ? M_PI_2 + atan(slope_) : M_PI_2 - atan(slope_));
-
+	cosang_ = cos( xplotang_ );
+	sinang_ = sin( xplotang_ );
+
+	switch ( output_ ) {
+		case LithFactor:		kernel_ = &AVOAttrib::computeSpan<LithFactor>; break;
+		case PorosityFactor:	kernel_ = &AVOAttrib::computeSpan<PorosityFactor>; break;
+		case CrossplotAngle:	kernel_ = &AVOAttrib::computeSpan<CrossplotAngle>; break;
+		case CrossplotDeviation:	kernel_ = &AVOAttrib::computeSpan<CrossplotDeviation>; break;
+		case AVOClass:			kernel_ = &AVOAttrib::computeSpan<AVOClass>; break;
+		default:				kernel_ = &AVOAttrib::computeSpan<FluidFactor>; break;
+	}
 }
 
 
@@ -116,57 +144,90 @@ bool AVOAttrib::getInputData( const BinID& relpos, int zintv )
 bool AVOAttrib::computeData( const DataHolder& output, const BinID& relpos,
 			   int z0, int nrsamples, int threadid ) const
 {
-	float	idev2 = intercept_dev_*intercept_dev_;
-	float	gdev2 = gradient_dev_*gradient_dev_;
-	float	igdev = intercept_dev_*gradient_dev_;
-    for ( int idx=0; idx<nrsamples; idx++ ) {
-		const float intercept = getInputValue( interceptdata_[0], interceptdataidx_, idx, z0);
-		const float gradient = getInputValue( gradientdata_[0], gradientdataidx_, idx, z0);
-		const float slint = slope_*intercept;
-		
-		float outval = mUdf(float);
-		
-		if (!mIsUdf(intercept) && !mIsUdf(gradient)) {
-			if (output_ == FluidFactor) 
-				outval = intercept*cos(xplotang_) + gradient*sin(xplotang_);
-			else if (output_ == LithFactor)
-				outval = -intercept*sin(xplotang_) + gradient*cos(xplotang_);
-			else if (output_ == PorosityFactor) {
-				if (mIsEqual(gradient, slint, mDefEpsF)) 
-					outval = 0.0;
-				else if (gradient > slint)
-					outval = intercept*sin(xplotang_) - gradient*cos(xplotang_);
-				else
-					outval = -intercept*sin(xplotang_) + gradient*cos(xplotang_);
-			} else if (output_ == CrossplotAngle) {
-				outval = Math::toDegrees(Math::ACos((-intercept*sin(xplotang_) + gradient*cos(xplotang_))/sqrt(intercept*intercept+gradient*gradient)));
-				outval = gradient > slint ? outval-180: outval;
-			} else if (output_ == CrossplotDeviation) {
-				outval = sqrt(intercept*intercept/idev2+gradient*gradient/gdev2-2*correlation_*intercept*gradient/igdev);
-			} else if (output_ == AVOClass) {
-				if (intercept<=class2width_ && intercept>=-class2width_) {
-					outval = float(gradient > slint ? -2: 2);
-				} else if (gradient<=slint && gradient>=0 && intercept<=0)
-					outval = 4;
-				else if (gradient>slint && gradient<=0 && intercept>=0)
-					outval = -4;
-				else if (gradient<=slint && gradient<0 && intercept<=0)
-					outval = 3;
-				else if (gradient>slint && gradient>=0 && intercept>=0)
-					outval = -3;
-				else if (gradient<=slint && gradient<0 && intercept>=0)
-					outval = 1;
-				else if (gradient>slint && gradient>0 && intercept<=0)
-					outval = -1;
-			}
-		}
-		
-		setOutputValue( output, 0, idx, z0, outval );
-    }
+	auto getintercept = [&]( const DataHolder& dh, int sampidx )
+			{ return getInputValue( dh, interceptdataidx_, sampidx, z0 ); };
+	auto getgradient = [&]( const DataHolder& dh, int sampidx )
+			{ return getInputValue( dh, gradientdataidx_, sampidx, z0 ); };
+
+	std::vector<float> intercept( nrsamples ), gradient( nrsamples ), res( nrsamples );
+	wmGather::gatherTrace( interceptdata_, interceptdataidx_, z0, 0, nrsamples,
+			       intercept.data(), getintercept, mUdf(float) );
+	wmGather::gatherTrace( gradientdata_, gradientdataidx_, z0, 0, nrsamples,
+			       gradient.data(), getgradient, mUdf(float) );
+
+	if ( output_ != FluidLithClass ) {
+		(this->*kernel_)( intercept.data(), gradient.data(), res.data(), nrsamples );
+		for ( int idx=0; idx<nrsamples; idx++ )
+			setOutputValue( output, 0, idx, z0, res[idx] );
+		return true;
+	}
+
+	const SpanKernel kernels[] = { &AVOAttrib::computeSpan<FluidFactor>,
+				       &AVOAttrib::computeSpan<LithFactor>,
+				       &AVOAttrib::computeSpan<AVOClass> };
+	for ( int iout=0; iout<3; iout++ ) {
+		if ( !isOutputEnabled(iout) )
+			continue;
+		(this->*kernels[iout])( intercept.data(), gradient.data(), res.data(), nrsamples );
+		for ( int idx=0; idx<nrsamples; idx++ )
+			setOutputValue( output, iout, idx, z0, res[idx] );
+	}
 
     return true;
 }
 
+/* AVO class lookup indexed by
+   8*(gradient above the crossplot line) + 4*(intercept within the class 2 halfwidth)
+   + 2*(gradient on the far side of zero) + (intercept on the far side of zero)
+   where far side means negative below the line and positive above it for the
+   gradient, the reverse for the intercept. Combinations not covered by any
+   class are undefined.
+*/
+static const float sAVOClassTable[] =
+{
+	4.f, mUdf(float), 3.f, 1.f,	2.f, 2.f, 2.f, 2.f,
+	-4.f, mUdf(float), -3.f, -1.f,	-2.f, -2.f, -2.f, -2.f
+};
+
+template <int outtype>
+void AVOAttrib::computeSpan( const float* intercept, const float* gradient,
+			     float* res, int nrsamples ) const
+{
+	const float idev2 = intercept_dev_*intercept_dev_;
+	const float gdev2 = gradient_dev_*gradient_dev_;
+	const float igdev = intercept_dev_*gradient_dev_;
+	const float udf = mUdf(float);
+	for ( int idx=0; idx<nrsamples; idx++ ) {
+		const float I = intercept[idx];
+		const float G = gradient[idx];
+		const bool valid = !mIsUdf(I) && !mIsUdf(G);
+		const float slint = slope_*I;
+		const bool above = G > slint;
+		const float lith = -I*sinang_ + G*cosang_;
+
+		float outval;
+		if ( outtype == FluidFactor )
+			outval = I*cosang_ + G*sinang_;
+		else if ( outtype == LithFactor )
+			outval = lith;
+		else if ( outtype == PorosityFactor )
+			outval = mIsEqual(G, slint, mDefEpsF) ? 0.f : (above ? -lith : lith);
+		else if ( outtype == CrossplotAngle ) {
+			outval = valid ? Math::toDegrees(Math::ACos(lith/Math::Sqrt(I*I+G*G))) : 0.f;
+			outval = above ? outval-180 : outval;
+		} else if ( outtype == CrossplotDeviation )
+			outval = valid ? Math::Sqrt(I*I/idev2+G*G/gdev2-2*correlation_*I*G/igdev) : 0.f;
+		else {
+			const int band = I<=class2width_ && I>=-class2width_;
+			const int gfar = above ? G>0 : G<0;
+			const int ifar = above ? I<0 : I>0;
+			outval = sAVOClassTable[8*above + 4*band + 2*gfar + ifar];
+		}
+
+		res[idx] = valid ? outval : udf;
+	}
+}
+
 
 } // namespace Attrib
 
@@ -47,8 +47,11 @@ public:
     static const char*	class2Str()				{ return "class2width"; }
     
 
-    enum OutputType			{ FluidFactor, LithFactor, PorosityFactor, CrossplotAngle, CrossplotDeviation, AVOClass };
+    enum OutputType			{ FluidFactor, LithFactor, PorosityFactor, CrossplotAngle, CrossplotDeviation, AVOClass,
+							  FluidLithClass };
 	
+    void		getCompNames(BufferStringSet&) const;
+
 protected:
 
 						~AVOAttrib() {}
@@ -60,8 +63,22 @@ protected:
     bool		getInputData(const BinID&,int zintv);
     bool		computeData(const DataHolder&,const BinID& relpos, int z0,int nrsamples,int threadid) const;
 
+/* Each output type has its own kernel working on whole spans of gathered
+   intercept and gradient values, picked once in the constructor. Undefined
+   inputs give undefined output. FluidLithClass returns fluid factor,
+   lithology factor and AVO class as three outputs from one pass.
+*/
+    typedef void (AVOAttrib::*SpanKernel)(const float* intercept, const float* gradient,
+    					  float* res, int nrsamples) const;
+    template <int outtype>
+    void		computeSpan(const float* intercept, const float* gradient,
+				    float* res, int nrsamples) const;
+
     int			output_;
     float		xplotang_;
+    float		cosang_;
+    float		sinang_;
+    SpanKernel	kernel_;
 	float		slope_;
     float		intercept_dev_;
 	float		gradient_dev_;
@@ -13,9 +13,27 @@
 
 
 #include "windowedops_eigen.h"
+#include "tracegather.h"
 
 namespace Attrib {
 
+/* All outputs are derived from windowed sums of the squared and cross products
+   of intercept and gradient, over all traces for the background angle and over
+   the centre trace for the event angle, and from the windowed min/max of the
+   centre trace intercept for the strength. The moments are accumulated in one
+   pass over the traces and windowed with prefix sums. Everything lives in
+   a per thread workspace that is kept between calls.
+*/
+struct AVOPolarAttrib::Workspace
+{
+    Eigen::ArrayXXd A, B;
+    Eigen::ArrayXd  A2, B2, AB, cA2, cB2, cAB;
+    Eigen::ArrayXd  A2win, B2win, ABwin, cA2win, cB2win, cABwin;
+    Eigen::ArrayXd  prefix;
+    Eigen::ArrayXd  cA, Amax, Amin;
+    Eigen::ArrayXi  imax, imin;
+};
+
 mAttrDefCreateInstance(AVOPolarAttrib)
 
 void AVOPolarAttrib::initClass()
@@ -156,6 +174,9 @@ bool AVOPolarAttrib::getInputData( const BinID& relpos, int zintv )
     return true;
 }
 
+AVOPolarAttrib::~AVOPolarAttrib()
+{}
+
 bool AVOPolarAttrib::computeData( const DataHolder& output, const BinID& relpos, int z0, int nrsamples, int threadid) const
 {
     if ( intercept_.isEmpty() || gradient_.isEmpty() || output.isEmpty() )
@@ -164,148 +185,140 @@ bool AVOPolarAttrib::computeData( const DataHolder& output, const BinID& relpos,
     const int sz = sampgateBG_.width() + nrsamples;
     const int ntraces = trcpos_.size();
 
-    Eigen::ArrayXXd A(sz, ntraces);
-    for (int trcidx=0; trcidx<ntraces; trcidx++) {
-        const DataHolder* data = intercept_[trcidx];
-        for (int idx=0; idx<sz; idx++) {
-            float val = getInputValue(*data, intercept_idx_, sampgateBG_.start+idx, z0);
-            A(idx, trcidx) = mIsUdf(val)?0.0f:val;
-        }
-    }
+    auto getintercept = [&](const DataHolder& dh, int sampidx)
+                        { return getInputValue(dh, intercept_idx_, sampidx, z0); };
+    auto getgradient = [&](const DataHolder& dh, int sampidx)
+                        { return getInputValue(dh, gradient_idx_, sampidx, z0); };
 
-    Eigen::ArrayXXd B(sz, ntraces);
+    Workspace& ws = workspaces_.get( threadid );
+    Eigen::ArrayXXd& A = ws.A;
+    Eigen::ArrayXXd& B = ws.B;
+    A.resize(sz, ntraces);
+    B.resize(sz, ntraces);
     for (int trcidx=0; trcidx<ntraces; trcidx++) {
-        const DataHolder* data = gradient_[trcidx];
-        for (int idx=0; idx<sz; idx++) {
-            float val = getInputValue(*data, gradient_idx_, sampgateBG_.start+idx, z0);
-            B(idx, trcidx) = mIsUdf(val)?0.0f:val;
-        }
-    }
-
-    Eigen::ArrayXd bgAngle(0);
-    Eigen::ArrayXd evAngle(0);
-    Eigen::ArrayXd quality(0);
-    Eigen::ArrayXd angleDiff(0);
-    Eigen::ArrayXd strength(0);
-
-    if (isOutputEnabled(BGAngle)) {
-        computeBackgroundAngle( A, B, bgAngle );
-        for (int idx=0; idx<nrsamples; idx++)
-            setOutputValue(output,BGAngle, idx, z0, bgAngle[idx-sampgateBG_.start]);
-    }
-
-    if (isOutputEnabled(EventAngle)) {
-        computeEventAngle( A, B, evAngle, quality );
-        for (int idx=0; idx<nrsamples; idx++)
-            setOutputValue(output,EventAngle, idx, z0, evAngle[idx-sampgateBG_.start]);
+        wmGather::gatherTrace(intercept_[trcidx], intercept_idx_, z0, sampgateBG_.start, sz,
+                              A.col(trcidx).data(), getintercept);
+        wmGather::gatherTrace(gradient_[trcidx], gradient_idx_, z0, sampgateBG_.start, sz,
+                              B.col(trcidx).data(), getgradient);
     }
 
-    if (isOutputEnabled(Difference)) {
-        if (bgAngle.size()==0)
-            computeBackgroundAngle( A, B, bgAngle );
-        if (evAngle.size()==0)
-            computeEventAngle( A, B, evAngle, quality );
-        angleDiff = evAngle - bgAngle;
-        for (int idx=0; idx<nrsamples; idx++)
-            setOutputValue(output,Difference, idx, z0, angleDiff[idx-sampgateBG_.start]);
-    }
-
-    if (isOutputEnabled(Strength)) {
-        computeStrength( A, B, strength );
-        for (int idx=0; idx<nrsamples; idx++)
-            setOutputValue(output,Strength, idx, z0, strength[idx-sampgateBG_.start]);
-    }
-
-    if (isOutputEnabled(Product)) {
-        if (strength.size()==0)
-            computeStrength( A, B, strength );
-        if (angleDiff.size()==0) {
-            if (bgAngle.size()==0)
-                computeBackgroundAngle( A, B, bgAngle );
-            if (evAngle.size()==0)
-                computeEventAngle( A, B, evAngle, quality );
-            angleDiff = evAngle - bgAngle;
+    const bool needdiff = isOutputEnabled(Difference) || isOutputEnabled(Product);
+    const bool needbg = isOutputEnabled(BGAngle) || needdiff;
+    const bool needev = isOutputEnabled(EventAngle) || isOutputEnabled(Quality) || needdiff;
+    const bool needstrength = isOutputEnabled(Strength) || isOutputEnabled(Product);
+
+    if (needbg || needev)
+        computeMoments( ws, needbg, needev );
+    if (needstrength)
+        computeExtremes( ws );
+
+    for (int idx=0; idx<nrsamples; idx++) {
+        const int widx = idx-sampgateBG_.start;
+        double bgangle = 0.0, evangle = 0.0, quality = 0.0, strength = 0.0;
+        if (needbg) {
+            const double A2mB2 = ws.A2win[widx] - ws.B2win[widx];
+            const double ABwin = ws.ABwin[widx];
+            bgangle = atan(2.0*ABwin/(A2mB2 + sqrt(4.0*ABwin*ABwin + A2mB2*A2mB2)))/M_PI*180.0;
+        }
+        if (needev) {
+            const double A2mB2 = ws.cA2win[widx] - ws.cB2win[widx];
+            const double ABwin = ws.cABwin[widx];
+            const double del = sqrt(4.0*ABwin*ABwin + A2mB2*A2mB2);
+            evangle = atan(2.0*ABwin/(A2mB2 + del))/M_PI*180.0;
+            quality = del / (ws.cA2win[widx] + ws.cB2win[widx]);
+        }
+        if (needstrength) {
+            const double amin = ws.Amin[widx];
+            const double amax = ws.Amax[widx];
+            const double bmin = B(ws.imin[widx],centertrcidx_);
+            const double bmax = B(ws.imax[widx],centertrcidx_);
+            strength = sqrt(amin*amin+bmin*bmin) + sqrt(amax*amax+bmax*bmax);
         }
-        Eigen::ArrayXd prod = angleDiff*strength;
-        for (int idx=0; idx<nrsamples; idx++)
-            setOutputValue(output,Product, idx, z0, prod[idx-sampgateBG_.start]);
-    }
 
-    if (isOutputEnabled(Quality)) {
-        if (evAngle.size()==0)
-            computeEventAngle( A, B, evAngle, quality );
-        for (int idx=0; idx<nrsamples; idx++)
-            setOutputValue(output,Quality, idx, z0, quality[idx-sampgateBG_.start]);
+        const double anglediff = evangle - bgangle;
+        if (isOutputEnabled(BGAngle))
+            setOutputValue(output, BGAngle, idx, z0, bgangle);
+        if (isOutputEnabled(EventAngle))
+            setOutputValue(output, EventAngle, idx, z0, evangle);
+        if (isOutputEnabled(Difference))
+            setOutputValue(output, Difference, idx, z0, anglediff);
+        if (isOutputEnabled(Strength))
+            setOutputValue(output, Strength, idx, z0, strength);
+        if (isOutputEnabled(Product))
+            setOutputValue(output, Product, idx, z0, anglediff*strength);
+        if (isOutputEnabled(Quality))
+            setOutputValue(output, Quality, idx, z0, quality);
     }
 
     return true;
 }
 
-void AVOPolarAttrib::computeEventAngle(  const Eigen::ArrayXXd& A, const Eigen::ArrayXXd& B, Eigen::ArrayXd& angle, Eigen::ArrayXd& qual) const
-{
-    const int sz = A.rows();
-    angle.resize(sz);
-    qual.resize(sz);
-    const int winsamples = sampgateBG_.width()+1;
-
-
-    Eigen::ArrayXd A2 = A.col(centertrcidx_)*A.col(centertrcidx_);
-    Eigen::ArrayXd B2 = B.col(centertrcidx_)*B.col(centertrcidx_);
-    Eigen::ArrayXd AB = A.col(centertrcidx_)*B.col(centertrcidx_);
-
-    Eigen::ArrayXd A2win(sz);
-    windowedOpsEigen::sum( A2, winsamples, A2win );
-    Eigen::ArrayXd B2win(sz);
-    windowedOpsEigen::sum( B2, winsamples, B2win );
-    Eigen::ArrayXd ABwin(sz);
-    windowedOpsEigen::sum( AB, winsamples, ABwin );
-
-    Eigen::ArrayXd A2mB2 = A2win - B2win;
-    Eigen::ArrayXd del = (4.0*ABwin.square() + A2mB2.square()).sqrt().eval();
-
-    angle = (2.0*ABwin/(A2mB2 + del)).atan()/M_PI*180.0;
-    qual = del / (A2win + B2win);
-}
-
-void AVOPolarAttrib::computeBackgroundAngle(  const Eigen::ArrayXXd& A, const Eigen::ArrayXXd& B, Eigen::ArrayXd& result ) const
+void AVOPolarAttrib::computeMoments( Workspace& ws, bool needbg, bool needev ) const
 {
+    const Eigen::ArrayXXd& A = ws.A;
+    const Eigen::ArrayXXd& B = ws.B;
     const int sz = A.rows();
-    result.resize(sz);
-    const int winsamples = sampgateBG_.width()+1;
-
-    Eigen::ArrayXd A2 = A.square().rowwise().sum();
-    Eigen::ArrayXd B2 = B.square().rowwise().sum();
-    Eigen::ArrayXd AB = (A*B).rowwise().sum();
+    const int ntraces = A.cols();
+    const int halfWinSize = sampgateBG_.width()/2;
+
+    Eigen::ArrayXd* moments[] = { &ws.A2, &ws.B2, &ws.AB, &ws.cA2, &ws.cB2, &ws.cAB };
+    Eigen::ArrayXd* windowed[] = { &ws.A2win, &ws.B2win, &ws.ABwin,
+                                   &ws.cA2win, &ws.cB2win, &ws.cABwin };
+    const int first = needbg ? 0 : 3;
+    const int last = needev ? 6 : 3;
+    for (int imom=first; imom<last; imom++) {
+        moments[imom]->setZero(sz);
+        windowed[imom]->resize(sz);
+    }
 
-    Eigen::ArrayXd A2win(sz);
-    windowedOpsEigen::sum( A2, winsamples, A2win );
-    Eigen::ArrayXd B2win(sz);
-    windowedOpsEigen::sum( B2, winsamples, B2win );
-    Eigen::ArrayXd ABwin(sz);
-    windowedOpsEigen::sum( AB, winsamples, ABwin );
+    for (int trcidx=0; trcidx<ntraces; trcidx++) {
+        const bool center = trcidx==centertrcidx_;
+        if (!needbg && !center)
+            continue;
+
+        const double* a = A.col(trcidx).data();
+        const double* b = B.col(trcidx).data();
+        double* a2 = ws.A2.data();
+        double* b2 = ws.B2.data();
+        double* ab = ws.AB.data();
+        for (int idx=0; idx<sz; idx++) {
+            const double aa = a[idx]*a[idx];
+            const double bb = b[idx]*b[idx];
+            const double aabb = a[idx]*b[idx];
+            if (needbg) {
+                a2[idx] += aa;
+                b2[idx] += bb;
+                ab[idx] += aabb;
+            }
+            if (center && needev) {
+                ws.cA2[idx] = aa;
+                ws.cB2[idx] = bb;
+                ws.cAB[idx] = aabb;
+            }
+        }
+    }
 
-    Eigen::ArrayXd A2mB2 = A2win - B2win;
-    result = (2.0*ABwin/(A2mB2 + (4.0*ABwin.square() + A2mB2.square()).sqrt())).atan()/M_PI*180.0;
+    ws.prefix.resize( sz+1 );
+    for (int imom=first; imom<last; imom++) {
+        const Eigen::ArrayXd& mom = *moments[imom];
+        Eigen::ArrayXd& win = *windowed[imom];
+        ws.prefix[0] = 0.0;
+        for (int idx=0; idx<sz; idx++)
+            ws.prefix[idx+1] = ws.prefix[idx] + mom[idx];
+        for (int idx=0; idx<sz; idx++) {
+            int beg, end;
+            windowedOpsEigen::window(idx, halfWinSize, sz, beg, end);
+            win[idx] = ws.prefix[end+1] - ws.prefix[beg];
+        }
+    }
 }
 
-void AVOPolarAttrib::computeStrength(  const Eigen::ArrayXXd& A, const Eigen::ArrayXXd& B, Eigen::ArrayXd& result ) const
+void AVOPolarAttrib::computeExtremes( Workspace& ws ) const
 {
-    const int sz = A.rows();
-    result.resize(sz);
     const int winsamples = sampgateBG_.width()+1;
-
-    Eigen::ArrayXi imax(sz);
-    Eigen::ArrayXd Amax(sz);
-    windowedOpsEigen::max( A.col(centertrcidx_), winsamples, Amax, imax);
-    Eigen::ArrayXi imin(sz);
-    Eigen::ArrayXd Amin(sz);
-    windowedOpsEigen::min( A.col(centertrcidx_), winsamples, Amin, imin);
-
-    for (int idx=0; idx<sz;idx++) {
-        double bmin = B(imin[idx],centertrcidx_);
-        double bmax = B(imax[idx],centertrcidx_);
-        result[idx] = sqrt(Amin[idx]*Amin[idx]+bmin*bmin) + sqrt(Amax[idx]*Amax[idx]+bmax*bmax);
-    }
+    ws.cA = ws.A.col(centertrcidx_);
+    windowedOpsEigen::max( ws.cA, winsamples, ws.Amax, ws.imax );
+    windowedOpsEigen::min( ws.cA, winsamples, ws.Amin, ws.imin );
 }
 } // Attrib
 
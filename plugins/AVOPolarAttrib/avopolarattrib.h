@@ -2,6 +2,7 @@
 #define avopolarattrib_h
 
 #include "attribprovider.h"
+#include "perthread.h"
 
 #include "Eigen/Core"
 
@@ -21,7 +22,7 @@ public:
     enum Output { BGAngle, EventAngle, Difference, Strength, Product, Quality };
     
 protected:
-                        ~AVOPolarAttrib() {}
+                        ~AVOPolarAttrib();
     static Provider*    createInstance(Desc&);
     static void         updateDefaults(Desc&);
                     
@@ -31,9 +32,9 @@ protected:
     void                prepPriorToBoundsCalc();
     bool                computeData(const DataHolder&,const BinID& relpos, int z0,int nrsamples,int threadid) const;
 
-    void                computeBackgroundAngle(  const Eigen::ArrayXXd& intercept, const Eigen::ArrayXXd& gradient, Eigen::ArrayXd& result ) const;
-    void                computeEventAngle(  const Eigen::ArrayXXd& intercept, const Eigen::ArrayXXd& gradient, Eigen::ArrayXd& angle, Eigen::ArrayXd& quality ) const;
-    void                computeStrength(  const Eigen::ArrayXXd& intercept, const Eigen::ArrayXXd& gradient, Eigen::ArrayXd& result ) const;
+    struct Workspace;
+    void                computeMoments(Workspace&, bool needbg, bool needev) const;
+    void                computeExtremes(Workspace&) const;
     
     
     const BinID*            desStepout(int,int) const;
@@ -54,6 +55,8 @@ protected:
     ObjectSet<const DataHolder>   gradient_;
     int             intercept_idx_;
     int             gradient_idx_;
+
+    wmThreads::PerThread<Workspace> workspaces_;
 };
 
 };
@@ -0,0 +1,142 @@
+/*Copyright (C) 2026 Wayne Mogg All rights reserved.
+ This file may be used either under the terms of:
+ 1. The GNU General Public License version 3 or higher, as published by
+ the Free Software Foundation, or
+ This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*+
+ ________________________________________________________________________
+ Microbenchmark for the windowedOpsEigen running window operations.
+
+ Standalone, not linked to OpendTect. Compares the O(n) operations with
+ the direct O(n.w) window scans for window sizes from 5 to 200 samples, checks
+ they agree and reports the time per trace for both. Only built when the
+ WM_BUILD_BENCHMARKS option is on:
+
+   cmake -DWM_BUILD_BENCHMARKS=ON ...
+   cmake --build . --target windowedops_bench
+   ./windowedops_bench [nrsamples] [nrtraces]
+ ________________________________________________________________________
+ -*/
+#include "windowedops_eigen.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace directOps{
+
+void window( int idx, int halfWinSize, int sz, int& beg, int& n )
+{
+    beg = idx-halfWinSize;
+    int end = idx+halfWinSize;
+    beg = beg<0 ? 0: beg;
+    end = end>=sz ? sz-1 : end;
+    n = end-beg+1;
+}
+
+void sum( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output )
+{
+    int sz = input.size();
+    output.resize(sz);
+    for (int idx=0; idx<sz; idx++) {
+        int beg, n;
+        window(idx, (winSize-1)/2, sz, beg, n);
+        output(idx) = input.segment(beg,n).sum();
+    }
+}
+
+void min( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output, Eigen::ArrayXi& indices )
+{
+    int sz = input.size();
+    output.resize(sz);
+    indices.resize(sz);
+    Eigen::Index ind;
+    for (int idx=0; idx<sz; idx++) {
+        int beg, n;
+        window(idx, (winSize-1)/2, sz, beg, n);
+        output(idx) = input.segment(beg,n).minCoeff(&ind);
+        indices(idx) = ind+beg;
+    }
+}
+
+void max( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output, Eigen::ArrayXi& indices )
+{
+    int sz = input.size();
+    output.resize(sz);
+    indices.resize(sz);
+    Eigen::Index ind;
+    for (int idx=0; idx<sz; idx++) {
+        int beg, n;
+        window(idx, (winSize-1)/2, sz, beg, n);
+        output(idx) = input.segment(beg,n).maxCoeff(&ind);
+        indices(idx) = ind+beg;
+    }
+}
+
+}
+
+template <class Fn>
+double timePerTrace( const std::vector<Eigen::ArrayXd>& traces, Fn fn )
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& trc : traces)
+        fn(trc);
+    const std::chrono::duration<double,std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / traces.size();
+}
+
+int main( int argc, char** argv )
+{
+    const int nrsamples = argc>1 ? atoi(argv[1]) : 1000;
+    const int nrtraces = argc>2 ? atoi(argv[2]) : 2000;
+
+    std::mt19937 gen(42);
+    std::normal_distribution<double> dist;
+    std::vector<Eigen::ArrayXd> traces(nrtraces, Eigen::ArrayXd(nrsamples));
+    for (auto& trc : traces) {
+        for (int idx=0; idx<nrsamples; idx++)
+            trc(idx) = std::round(dist(gen)*8.0);  // rounded to get ties
+    }
+
+    const int winsizes[] = { 5, 10, 21, 50, 101, 150, 200 };
+    printf("%d samples, %d traces, times in us per trace\n", nrsamples, nrtraces);
+    printf("%6s %10s %10s %8s %10s %10s %8s %s\n", "window", "sum old", "sum new", "speedup",
+           "minmax old", "minmax new", "speedup", "check");
+
+    Eigen::ArrayXd out1, out2, out3, out4;
+    Eigen::ArrayXi ind1, ind2, ind3, ind4;
+    for (int winsize : winsizes) {
+        bool ok = true;
+        for (int itrc=0; itrc<nrtraces && ok; itrc+=97) {
+            const Eigen::ArrayXd& trc = traces[itrc];
+            directOps::sum(trc, winsize, out1);
+            windowedOpsEigen::sum(trc, winsize, out2);
+            ok = ok && ((out1-out2).abs() <= 1e-9*(1.0+out1.abs())).all();
+            directOps::min(trc, winsize, out1, ind1);
+            windowedOpsEigen::min(trc, winsize, out2, ind2);
+            directOps::max(trc, winsize, out3, ind3);
+            windowedOpsEigen::max(trc, winsize, out4, ind4);
+            ok = ok && (out1==out2).all() && (ind1==ind2).all();
+            ok = ok && (out3==out4).all() && (ind3==ind4).all();
+        }
+
+        const double sumold = timePerTrace(traces, [&](const Eigen::ArrayXd& trc)
+                                           { directOps::sum(trc, winsize, out1); });
+        const double sumnew = timePerTrace(traces, [&](const Eigen::ArrayXd& trc)
+                                           { windowedOpsEigen::sum(trc, winsize, out2); });
+        const double mmold = timePerTrace(traces, [&](const Eigen::ArrayXd& trc)
+                                          { directOps::min(trc, winsize, out1, ind1);
+                                            directOps::max(trc, winsize, out3, ind3); });
+        const double mmnew = timePerTrace(traces, [&](const Eigen::ArrayXd& trc)
+                                          { windowedOpsEigen::min(trc, winsize, out2, ind2);
+                                            windowedOpsEigen::max(trc, winsize, out4, ind4); });
+        printf("%6d %10.2f %10.2f %7.1fx %10.2f %10.2f %7.1fx %s\n", winsize, sumold, sumnew,
+               sumold/sumnew, mmold, mmnew, mmold/mmnew, ok ? "ok" : "MISMATCH");
+    }
+    return 0;
+}
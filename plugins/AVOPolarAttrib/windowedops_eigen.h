@@ -17,130 +17,146 @@
  -*/ 
 #include "Eigen/Core"
 
+#include <vector>
+
+/*
+ * Running window operations with the window centred on each sample and clipped at the ends
+ * of the input. Window sums use a prefix sum and the min/max operations the van Herk/Gil-Werman
+ * algorithm, so each call is O(n) whatever the window size. Ties resolve to the first index, as with
+ * Eigen's minCoeff/maxCoeff.
+ */
 namespace windowedOpsEigen{
-    
-void sum( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output )
+
+inline void window( int idx, int halfWinSize, int sz, int& beg, int& end )
+{
+    beg = idx-halfWinSize;
+    end = idx+halfWinSize;
+    beg = beg<0 ? 0: beg;
+    end = end>=sz ? sz-1 : end;
+}
+
+inline void sum( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output )
 {
     int sz = input.size();
     output.resize(sz);
     int halfWinSize = (winSize-1)/2;
     
+    std::vector<double> prefix(sz+1);
+    prefix[0] = 0.0;
+    for (int idx=0; idx<sz; idx++)
+        prefix[idx+1] = prefix[idx] + input(idx);
+    
     for (int idx=0; idx<sz; idx++) {
-        int beg = idx-halfWinSize;
-        int end = idx+halfWinSize;
-        beg = beg<0 ? 0: beg;
-        end = end>=sz ? sz-1 : end;
-        int n = end-beg+1;
-        output(idx) = input.segment(beg,n).sum();
+        int beg, end;
+        window(idx, halfWinSize, sz, beg, end);
+        output(idx) = prefix[end+1] - prefix[beg];
     }
 } 
 
-
-
-void minIdx( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXi& output )
+/*
+ * Window extreme by the van Herk/Gil-Werman algorithm. The input is split in blocks of the
+ * full window width, fwd holds the extreme from the block start up to each sample and bwd
+ * the extreme from each sample to the block end, so any full window spanning two blocks is
+ * the better of one bwd and one fwd value, three comparisons per sample. Windows clipped at
+ * the ends of the input are running extremes from the first or the last sample.
+ * isbetter(a,b) is true if a should be preferred over b.
+ */
+template <class Compare>
+void extreme( const Eigen::ArrayXd& input, const int winSize, Compare isbetter,
+              Eigen::ArrayXd* output, Eigen::ArrayXi* indices )
 {
-    int sz = input.size();
-    output.resize(sz);
-    int halfWinSize = (winSize-1)/2;
-    Eigen::Index ind;
+    const int sz = input.size();
+    if (output)
+        output->resize(sz);
+    if (indices)
+        indices->resize(sz);
+    if (sz==0)
+        return;
     
-    for (int idx=0; idx<sz; idx++) {
-        int beg = idx-halfWinSize;
-        int end = idx+halfWinSize;
-        beg = beg<0 ? 0: beg;
-        end = end>=sz ? sz-1 : end;
-        int n = end-beg+1;
-        input.segment(beg,n).minCoeff(&ind);
-        output[idx] = ind+beg;
+    const int halfWinSize = (winSize-1)/2 > 0 ? (winSize-1)/2 : 0;
+    const int width = 2*halfWinSize + 1;
+    std::vector<int> fwd(sz), bwd(sz);
+    for (int blk=0; blk<sz; blk+=width) {
+        const int last = blk+width<sz ? blk+width-1 : sz-1;
+        fwd[blk] = blk;
+        for (int idx=blk+1; idx<=last; idx++)
+            fwd[idx] = isbetter(input(idx), input(fwd[idx-1])) ? idx : fwd[idx-1];
+        bwd[last] = last;
+        for (int idx=last-1; idx>=blk; idx--)
+            bwd[idx] = isbetter(input(bwd[idx+1]), input(idx)) ? bwd[idx+1] : idx;
+    }
+    
+    auto setResult = [&]( int idx, int ind ) {
+        if (output)
+            (*output)(idx) = input(ind);
+        if (indices)
+            (*indices)(idx) = ind;
+    };
+    
+    // Left clipped windows [0,idx+halfWinSize]
+    int ind = 0;
+    int next = 0;
+    const int nrleft = halfWinSize<sz ? halfWinSize : sz;
+    for (int idx=0; idx<nrleft; idx++) {
+        const int end = idx+halfWinSize<sz ? idx+halfWinSize : sz-1;
+        for (; next<=end; next++)
+            ind = isbetter(input(next), input(ind)) ? next : ind;
+        setResult(idx, ind);
+    }
+    
+    // Full windows [idx-halfWinSize,idx+halfWinSize]
+    const int lastfull = sz-1-halfWinSize;
+    for (int idx=halfWinSize; idx<=lastfull; idx++) {
+        const int left = bwd[idx-halfWinSize];
+        const int right = fwd[idx+halfWinSize];
+        setResult(idx, isbetter(input(right), input(left)) ? right : left);
+    }
+    
+    // Right clipped windows [idx-halfWinSize,sz-1]
+    const int firstright = lastfull+1>nrleft ? lastfull+1 : nrleft;
+    if (firstright>=sz)
+        return;
+    ind = sz-1;
+    next = sz-1;
+    for (int idx=sz-1; idx>=firstright; idx--) {
+        const int beg = idx-halfWinSize>0 ? idx-halfWinSize : 0;
+        for (; next>=beg; next--)
+            ind = isbetter(input(ind), input(next)) ? ind : next;
+        setResult(idx, ind);
     }
 }
 
-void maxIdx( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXi& output )
+struct isLess    { bool operator()( double a, double b ) const { return a<b; } };
+struct isGreater { bool operator()( double a, double b ) const { return a>b; } };
+
+inline void minIdx( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXi& output )
 {
-    int sz = input.size();
-    output.resize(sz);
-    int halfWinSize = (winSize-1)/2;
-    
-    for (int idx=0; idx<sz; idx++) {
-        Eigen::Index imax;
-        int beg = idx-halfWinSize;
-        int end = idx+halfWinSize;
-        beg = beg<0 ? 0: beg;
-        end = end>=sz ? sz-1 : end;
-        int n = end-beg+1;
-        input.segment(beg,n).maxCoeff(&imax);
-        output[idx] = imax+beg;
-    }
+    extreme(input, winSize, isLess(), nullptr, &output);
+}
+
+inline void maxIdx( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXi& output )
+{
+    extreme(input, winSize, isGreater(), nullptr, &output);
 }    
 
-void min( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output )
+inline void min( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output )
 {
-    int sz = input.size();
-    output.resize(sz);
-    int halfWinSize = (winSize-1)/2;
-    
-    for (int idx=0; idx<sz; idx++) {
-        int beg = idx-halfWinSize;
-        int end = idx+halfWinSize;
-        beg = beg<0 ? 0: beg;
-        end = end>=sz ? sz-1 : end;
-        int n = end-beg+1;
-        output[idx] = input.segment(beg,n).minCoeff();
-    }
+    extreme(input, winSize, isLess(), &output, nullptr);
 }    
 
-void min( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output, Eigen::ArrayXi& indices )
+inline void min( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output, Eigen::ArrayXi& indices )
 {
-    int sz = input.size();
-    output.resize(sz);
-    indices.resize(sz);
-    int halfWinSize = (winSize-1)/2;
-    Eigen::Index ind;
-    
-    for (int idx=0; idx<sz; idx++) {
-        int beg = idx-halfWinSize;
-        int end = idx+halfWinSize;
-        beg = beg<0 ? 0: beg;
-        end = end>=sz ? sz-1 : end;
-        int n = end-beg+1;
-        output[idx] = input.segment(beg,n).minCoeff(&ind);
-        indices[idx] = ind+beg;
-    }
+    extreme(input, winSize, isLess(), &output, &indices);
 }    
 
-void max( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output )
+inline void max( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output )
 {
-    int sz = input.size();
-    output.resize(sz);
-    int halfWinSize = (winSize-1)/2;
-    
-    for (int idx=0; idx<sz; idx++) {
-        int beg = idx-halfWinSize;
-        int end = idx+halfWinSize;
-        beg = beg<0 ? 0: beg;
-        end = end>=sz ? sz-1 : end;
-        int n = end-beg+1;
-        output[idx] = input.segment(beg,n).maxCoeff();
-    }
+    extreme(input, winSize, isGreater(), &output, nullptr);
 }    
 
-void max( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output, Eigen::ArrayXi& indices )
+inline void max( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output, Eigen::ArrayXi& indices )
 {
-    int sz = input.size();
-    output.resize(sz);
-    indices.resize(sz);
-    int halfWinSize = (winSize-1)/2;
-    Eigen::Index ind;
-    
-    for (int idx=0; idx<sz; idx++) {
-        int beg = idx-halfWinSize;
-        int end = idx+halfWinSize;
-        beg = beg<0 ? 0: beg;
-        end = end>=sz ? sz-1 : end;
-        int n = end-beg+1;
-        output[idx] = input.segment(beg,n).maxCoeff(&ind);
-        indices[idx] = ind+beg;
-    }
+    extreme(input, winSize, isGreater(), &output, &indices);
 }    
 
 }
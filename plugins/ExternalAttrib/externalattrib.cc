@@ -24,12 +24,14 @@ ________________________________________________________________________
 #include "attribdescset.h"
 #include "attribfactory.h"
 #include "attribparam.h"
+#include "valseries.h"
 #include "envvars.h"
 #include "filepath.h"
 #include "oddirs.h"
 #include "pythonaccess.h"
 #include "settings.h"
 #include "survinfo.h"
+#include "tracegather.h"
 
 #include "uiwgmhelp.h"
 
@@ -137,7 +139,7 @@ void ExternalAttrib::updateDesc( Desc& desc )
 	}
     }
 
-    if (dProc_->hasStepOut())
+    if (dProc_->hasStepOut() || dProc_->batchSize()>1 || dProc_->asyncCompute())
 	desc.setLocality(Desc::MultiTrace);
     else
 	desc.setLocality(Desc::SingleTrace);
@@ -148,6 +150,12 @@ ExternalAttrib::ExternalAttrib( Desc& desc )
     : Provider( desc )
     , stepout_(0,0)
     , zmargin_(0,0)
+    , batchsz_(1)
+    , async_(false)
+    , lookahead_(1)
+    , nrpos_(1)
+    , batchstep_(1)
+    , reqstepout_(0,0)
 {
     if ( !isOK() ) return;
 
@@ -194,6 +202,12 @@ ExternalAttrib::ExternalAttrib( Desc& desc )
 
 	nrout_ = proc_->numOutput();
 	nrin_ = proc_->numInput();
+	batchsz_ = proc_->batchSize();
+	async_ = proc_->asyncCompute();
+	lookahead_ = async_ ? 2*batchsz_ : batchsz_;
+	proc_->setBatchSize( batchsz_ );
+	proc_->setShmTransport( proc_->shmTransport() );
+	reqstepout_ = BinID( stepout_.inl(), stepout_.crl()+lookahead_-1 );
 	getTrcPos();
 	int ninl = stepout_.inl()*2 + 1;
 	int ncrl = stepout_.crl()*2 + 1;
@@ -204,6 +218,10 @@ ExternalAttrib::ExternalAttrib( Desc& desc )
 
 ExternalAttrib::~ExternalAttrib()
 {
+    for (auto* pb : pending_)
+	drainPending( pb->pi_ );
+    deepErase( pending_ );
+    deepErase( batchres_ );
     if (proc_)
 	delete proc_;
 }
@@ -245,7 +263,7 @@ void ExternalAttrib::getCompNames( BufferStringSet& nms ) const
 
 bool ExternalAttrib::getInputData( const BinID& relpos, int zintv )
 {
-    while ( indata_.size() < trcpos_.size()*nrin_ ) {
+    while ( indata_.size() < trcpos_.size()*nrin_*lookahead_ ) {
 	indata_ += 0;
     }
     while (indataidx_.size() < nrin_) {
@@ -253,18 +271,25 @@ bool ExternalAttrib::getInputData( const BinID& relpos, int zintv )
     }
 
     const BinID bidstep = inputs_[0]->getStepoutStep();
-    for (int iin=0; iin<nrin_; iin++) {
-	for ( int idx=0; idx<trcpos_.size(); idx++ ) {
-	    BinID pos = relpos + trcpos_[idx] * bidstep;
-	    const DataHolder* data = inputs_[iin]->getData( pos, zintv );
-	    if ( !data ) {
-                pos = relpos + trcpos_[centertrcidx_]*bidstep;
-                data = inputs_[iin]->getData( pos, zintv );
-                if ( !data ) return false;
+    batchstep_ = bidstep.crl();
+    nrpos_ = 1;
+    for (int bidx=0; bidx<lookahead_; bidx++) {
+	const BinID batchpos = relpos + BinID(0,bidx) * bidstep;
+	for (int iin=0; iin<nrin_; iin++) {
+	    for ( int idx=0; idx<trcpos_.size(); idx++ ) {
+		BinID pos = batchpos + trcpos_[idx] * bidstep;
+		const DataHolder* data = inputs_[iin]->getData( pos, zintv );
+		if ( !data ) {
+		    pos = batchpos + trcpos_[centertrcidx_]*bidstep;
+		    data = inputs_[iin]->getData( pos, zintv );
+		    if ( !data )
+			return bidx>0;
+		}
+		indata_.replace( (bidx*nrin_+iin)*trcpos_.size()+idx, data );
 	    }
-	    indata_.replace( iin*trcpos_.size()+idx, data );
+	    indataidx_[iin] = getDataIndex(iin);
 	}
-	indataidx_[iin] = getDataIndex(iin);
+	nrpos_ = bidx+1;
     }
 
     return true;
@@ -275,29 +300,29 @@ bool ExternalAttrib::computeData( const DataHolder& output, const BinID& relpos,
     if ( indata_.isEmpty() || output.isEmpty() )
 	return false;
     if (proc_->isOK()) {
+	if (batchsz_>1 || async_)
+	    return getBatchResult( output, z0, nrsamples )
+		   || computeBatch( output, z0, nrsamples );
+
 	const int nrtraces = trcpos_.size();
 	const int sz = zmargin_.width() + nrsamples;
 	ProcInst* pi = proc_->getIdleInst( sz );
+	if (!pi)
+	    return false;
 	BinID bin = getCurrentPosition();
 	for (int iin = 0; iin<nrin_; iin++) {
 	    for (int trcidx=0; trcidx<nrtraces; trcidx++) {
 		const DataHolder* data = indata_[iin*nrtraces+trcidx];
-		for ( int idx=0; idx<sz; idx++ ) {
-		    float val = getInputValue(*data, indataidx_[iin], zmargin_.start+idx, z0);
-		    val = mIsUdf(val)?0.0f:val;
-		    proc_->setInput( pi, iin, trcidx, idx, val );
-		}
+		getInputBlock( *data, indataidx_[iin], z0, sz,
+			       proc_->getInputBuffer(pi, 0, iin, trcidx) );
 	    }
 	}
 
 	proc_->compute( pi, z0, bin.inl(), bin.crl() );
 	for (int iout = 0; iout<nrout_; iout++) {
-	    if (outputinterest_[iout]) {
-		for ( int idx=0; idx<nrsamples; idx++ ) {
-		    float val = proc_->getOutput( pi, iout, idx-zmargin_.start);
-		    setOutputValue( output, iout, idx, z0, val );
-		}
-	    }
+	    if (outputinterest_[iout])
+		setOutputBlock( output, iout, z0, nrsamples,
+			proc_->getOutputBuffer(pi, 0, iout) - zmargin_.start );
 	}
 	proc_->setInstIdle( pi );
 	return true;
@@ -305,6 +330,198 @@ bool ExternalAttrib::computeData( const DataHolder& output, const BinID& relpos,
 	return false;
 }
 
+bool ExternalAttrib::getBatchResult( const DataHolder& output, int z0,
+				     int nrsamples ) const
+{
+    const BinID bin = getCurrentPosition();
+    ObjectSet<PendingBatch> stale;
+    bool found = false;
+    {
+	Threads::Locker lckr( batchlock_ );
+	for (int ires=batchres_.size()-1; ires>=0; ires--) {
+	    const BatchResult* br = batchres_[ires];
+	    if (br->pos_.inl()!=bin.inl() || br->pos_.crl()<bin.crl()) {
+		delete batchres_.removeSingle( ires );
+		continue;
+	    }
+	    if (found || br->pos_!=bin || br->z0_!=z0 || br->nrsamples_!=nrsamples)
+		continue;
+
+	    for (int iout = 0; iout<nrout_; iout++) {
+		if (outputinterest_[iout])
+		    setOutputBlock( output, iout, z0, nrsamples,
+				    br->vals_.arr() + iout*nrsamples );
+	    }
+	    delete batchres_.removeSingle( ires );
+	    found = true;
+	}
+	for (int ipend=pending_.size()-1; ipend>=0; ipend--) {
+	    const PendingBatch* pb = pending_[ipend];
+	    if (pb->pos_.inl()!=bin.inl() || pb->pos_.crl()<bin.crl())
+		stale += pending_.removeSingle( ipend );
+	}
+    }
+
+// The engine has moved past these, read and discard their results
+    for (auto* pb : stale)
+	drainPending( pb->pi_ );
+    deepErase( stale );
+    return found;
+}
+
+ProcInst* ExternalAttrib::takePending( int z0, int nrsamples, int& nrtrcs ) const
+{
+    const BinID bin = getCurrentPosition();
+    Threads::Locker lckr( batchlock_ );
+    for (int ipend=0; ipend<pending_.size(); ipend++) {
+	const PendingBatch* pb = pending_[ipend];
+	if (pb->pos_==bin && pb->z0_==z0 && pb->nrsamples_==nrsamples) {
+	    PendingBatch* taken = pending_.removeSingle( ipend );
+	    ProcInst* pi = taken->pi_;
+	    nrtrcs = taken->nrtrcs_;
+	    delete taken;
+	    return pi;
+	}
+    }
+    return nullptr;
+}
+
+void ExternalAttrib::drainPending( ProcInst* pi ) const
+{
+    while (pi->nrPending()>0) {
+	if (!proc_->collect( pi ))
+	    break;
+    }
+    proc_->setInstIdle( pi );
+}
+
+bool ExternalAttrib::submitInput( ProcInst* pi, int firstpos, int nrtrcs,
+				  int z0, int sz ) const
+{
+    const int nrtraces = trcpos_.size();
+    const BinID bin = getCurrentPosition();
+    TypeSet<int> inls, crls;
+    for (int bidx=0; bidx<nrtrcs; bidx++) {
+	const int posidx = firstpos + bidx;
+	inls += bin.inl();
+	crls += bin.crl() + posidx*batchstep_;
+	for (int iin = 0; iin<nrin_; iin++) {
+	    for (int trcidx=0; trcidx<nrtraces; trcidx++) {
+		const DataHolder* data = indata_[(posidx*nrin_+iin)*nrtraces+trcidx];
+		getInputBlock( *data, indataidx_[iin], z0, sz,
+			       proc_->getInputBuffer(pi, bidx, iin, trcidx) );
+	    }
+	}
+    }
+
+    return proc_->submitBatch( pi, nrtrcs, z0, inls.arr(), crls.arr() );
+}
+
+bool ExternalAttrib::computeBatch( const DataHolder& output, int z0,
+				   int nrsamples ) const
+{
+    const int sz = zmargin_.width() + nrsamples;
+    const BinID bin = getCurrentPosition();
+    const int nrnext = async_ ? mMAX(nrpos_-batchsz_,0) : 0;
+    int nrcur = mMIN( nrpos_, batchsz_ );
+    ProcInst* pi = takePending( z0, nrsamples, nrcur );
+    if (!pi) {
+	pi = proc_->getIdleInst( sz );
+	if (!pi)
+	    return false;
+	if (!submitInput( pi, 0, nrcur, z0, sz )) {
+	    proc_->setInstIdle( pi );
+	    return false;
+	}
+    }
+
+// With shared memory the next batch goes into the other slot of the ring
+// before this one is collected
+    bool nextsubmitted = false;
+    if (nrnext>0 && proc_->canSubmit(pi))
+	nextsubmitted = submitInput( pi, batchsz_, nrnext, z0, sz );
+
+    if (!proc_->collect( pi )) {
+	drainPending( pi );
+	return false;
+    }
+
+    for (int iout = 0; iout<nrout_; iout++) {
+	if (outputinterest_[iout])
+	    setOutputBlock( output, iout, z0, nrsamples,
+			    proc_->getOutputBuffer(pi, 0, iout) - zmargin_.start );
+    }
+
+    ObjectSet<BatchResult> ahead;
+    for (int bidx=1; bidx<nrcur; bidx++) {
+	BatchResult* br = new BatchResult;
+	br->pos_ = BinID( bin.inl(), bin.crl() + bidx*batchstep_ );
+	br->z0_ = z0;
+	br->nrsamples_ = nrsamples;
+	br->vals_.setSize( nrout_*nrsamples, mUdf(float) );
+	for (int iout = 0; iout<nrout_; iout++) {
+	    if (outputinterest_[iout]) {
+		const float* vals = proc_->getOutputBuffer( pi, bidx, iout )
+				    - zmargin_.start;
+		OD::memCopy( br->vals_.arr()+iout*nrsamples, vals,
+			     nrsamples*sizeof(float) );
+	    }
+	}
+	ahead += br;
+    }
+
+    if (nrnext>0 && !nextsubmitted)
+	nextsubmitted = submitInput( pi, batchsz_, nrnext, z0, sz );
+
+    Threads::Locker lckr( batchlock_ );
+    batchres_.append( ahead );
+    if (nextsubmitted) {
+	PendingBatch* pb = new PendingBatch;
+	pb->pos_ = BinID( bin.inl(), bin.crl() + batchsz_*batchstep_ );
+	pb->z0_ = z0;
+	pb->nrsamples_ = nrsamples;
+	pb->nrtrcs_ = nrnext;
+	pb->pi_ = pi;
+	pending_ += pb;
+    } else {
+	lckr.unlockNow();
+	proc_->setInstIdle( pi );
+    }
+    return true;
+}
+
+/* Copies the sz samples starting zmargin_.start samples from z0 into res,
+   replacing undefined and missing values with 0.
+*/
+void ExternalAttrib::getInputBlock( const DataHolder& data, int dataidx, int z0,
+				    int sz, float* res ) const
+{
+    auto getval = [&]( const DataHolder& dh, int sampidx )
+		    { return getInputValue( dh, dataidx, sampidx, z0 ); };
+    wmGather::gatherTrace( &data, dataidx, z0, zmargin_.start, sz, res, getval );
+}
+
+void ExternalAttrib::setOutputBlock( const DataHolder& output, int outidx,
+				     int z0, int nrsamples, const float* vals ) const
+{
+    ValueSeries<float>* outser = outidx<output.nrSeries() ? output.series( outidx )
+							  : nullptr;
+    const int shift = z0 - output.z0_;
+    if ( !outser || shift<0 || shift+nrsamples>output.nrsamples_ ) {
+	for ( int idx=0; idx<nrsamples; idx++ )
+	    setOutputValue( output, outidx, idx, z0, vals[idx] );
+	return;
+    }
+
+    float* arr = outser->arr();
+    if ( arr )
+	OD::memCopy( arr+shift, vals, nrsamples*sizeof(float) );
+    else {
+	for ( int idx=0; idx<nrsamples; idx++ )
+	    outser->setValue( shift+idx, vals[idx] );
+    }
+}
+
 const Interval<int>* ExternalAttrib::desZSampMargin(int,int) const
 {
     if (zmargin_ == Interval<int>(0,0))
@@ -315,10 +532,10 @@ const Interval<int>* ExternalAttrib::desZSampMargin(int,int) const
 
 const BinID* ExternalAttrib::desStepout(int input,int output) const
 {
-    if (stepout_ == BinID(0,0))
+    if (reqstepout_ == BinID(0,0))
 	return nullptr;
     else
-	return &stepout_;
+	return &reqstepout_;
 }
 }; //namespace
 
@@ -23,6 +23,7 @@ ________________________________________________________________________
 #include "externalattribmod.h"
 #include "attribprovider.h"
 #include "bufstring.h"
+#include "threadlock.h"
 
 
 /*!\brief External Attribute
@@ -31,6 +32,7 @@ Compute attribute using external process
 
 */
 class ExtProc;
+class ProcInst;
 
 namespace Attrib
 {
@@ -71,6 +73,16 @@ protected:
 	
     bool		getInputData(const BinID&,int zintv);
     bool		computeData(const DataHolder&, const BinID& relpos, int z0, int nrsamples, int threadid) const;
+    bool		computeBatch(const DataHolder&, int z0, int nrsamples) const;
+    bool		getBatchResult(const DataHolder&, int z0, int nrsamples) const;
+    bool		submitInput(ProcInst*, int firstpos, int nrtrcs, int z0,
+				    int sz) const;
+    ProcInst*		takePending(int z0, int nrsamples, int& nrtrcs) const;
+    void		drainPending(ProcInst*) const;
+    void		getInputBlock(const DataHolder&, int dataidx, int z0, int sz,
+				      float* res) const;
+    void		setOutputBlock(const DataHolder&, int outidx, int z0, int nrsamples,
+				       const float* vals) const;
 
     BufferString	interpfile_;
     BufferString	exfile_;
@@ -88,6 +100,43 @@ protected:
     ExtProc*		proc_;
     int			nrin_;
     int			nrout_;
+
+/* Batch mode: the input traces for the batchsz_-1 positions following the
+   current one along the crossline are gathered as well and all sent to the
+   external process in a single frame. Results for the following positions are
+   kept until the attribute engine asks for them.
+
+   Async mode: the batch following the current one is gathered too and
+   submitted before returning, so the external process computes it while the
+   attribute engine moves on. Its ProcInst is kept in pending_ until the
+   engine reaches the first position of that batch.
+*/
+    struct BatchResult
+    {
+	BinID		pos_;
+	int		z0_;
+	int		nrsamples_;
+	TypeSet<float>	vals_;
+    };
+
+    struct PendingBatch
+    {
+	BinID		pos_;
+	int		z0_;
+	int		nrsamples_;
+	int		nrtrcs_;
+	ProcInst*	pi_;
+    };
+
+    int			batchsz_;
+    bool		async_;
+    int			lookahead_;
+    int			nrpos_;
+    int			batchstep_;
+    BinID		reqstepout_;
+    mutable ObjectSet<BatchResult>	batchres_;
+    mutable ObjectSet<PendingBatch>	pending_;
+    mutable Threads::Lock	batchlock_;
 };
 
 }; // namespace Attrib
@@ -29,6 +29,7 @@ ________________________________________________________________________
 #include "filepath.h"
 #include "envvars.h"
 #include "procinst.h"
+#include "procinstpool.h"
 #include "urllib.h"
 
 
@@ -48,9 +49,15 @@ static const char* LegacyKeys[] =
     "Par_5",
     "Help",
     "Parallel",
+    "BatchSize",
+    "Protocol",
+    "Transport",
+    "Async",
     0
 };
 
+static const int cMaxBatchSize = 1024;
+
 struct ExtProcImpl
 {
 public:
@@ -58,6 +65,7 @@ public:
     ~ExtProcImpl();
 
     void		startInst( ProcInst* pi );
+    BufferString	poolKey() const;
 
     bool		getParam();
     void		updateNewParamKeys();
@@ -71,23 +79,39 @@ public:
     BufferString	infile_;
     json::Value		jsonpar_;
     BufferStringSet	newparamkeys_;
+    int			batchsize_;
+    bool		shm_;
     ObjectSet<ProcInst> idleinsts_;
     Threads::Mutex	idleinstslock_;
 };
 
 ExtProcImpl::ExtProcImpl(const char* fname, const char* iname)
-:  idleinsts_(),isok_(true)
+:  idleinsts_(),isok_(true),batchsize_(1),shm_(false)
 {
     setFile(fname, iname);
 }
 
 ExtProcImpl::~ExtProcImpl()
 {
-// Delete all ProcInst's in idleinsts_
-    while (!idleinsts_.isEmpty()) {
-	ProcInst* pi = idleinsts_.pop();
-	delete pi;
-    }
+// Hand the idle ProcInst's over to the process wide pool for reuse by later jobs
+    if (!idleinsts_.isEmpty())
+	ProcInstPool::instance().release( poolKey(), idleinsts_ );
+}
+
+// Everything a running external process was started with: interpreter,
+// script, parameters, the SeisInfo block and the transport settings
+BufferString ExtProcImpl::poolKey() const
+{
+    BufferString key( infile_ );
+    key.add( "|" ).add( exfile_ );
+    key.add( "|" ).add( json::Serialize(jsonpar_).c_str() );
+    key.add( "|" ).add( seisinfo_.nrInl ).add( "," ).add( seisinfo_.nrCrl )
+       .add( "," ).add( seisinfo_.nrInput ).add( "," ).add( seisinfo_.nrOutput )
+       .add( "," ).add( seisinfo_.zStep ).add( "," ).add( seisinfo_.inlDistance )
+       .add( "," ).add( seisinfo_.crlDistance ).add( "," ).add( seisinfo_.zFactor )
+       .add( "," ).add( seisinfo_.dipFactor );
+    key.add( "|" ).add( batchsize_ ).add( shm_ ? "shm" : "pipe" );
+    return key;
 }
 
 void ExtProcImpl::setFile(const char* fname, const char* iname)
@@ -186,7 +210,17 @@ void ExtProcImpl::addQuotesIfNeeded(BufferStringSet& args)
 
 void ExtProcImpl::startInst( ProcInst* pi )
 {
-    BufferString params(json::Serialize(jsonpar_).c_str());
+    pi->setBatchSize( batchsize_ );
+    json::Value instpar = jsonpar_;
+    if (shm_ && pi->setShmTransport( true )) {
+	json::Object jobj;
+	jobj["Version"] = 2;
+	jobj["BatchSize"] = batchsize_;
+	jobj["Transport"] = "shm";
+	jobj["ShmName"] = pi->shmName().buf();
+	instpar["Protocol"] = jobj;
+    }
+    BufferString params(json::Serialize(instpar).c_str());
     BufferStringSet runargs;
     if ( !infile_.isEmpty() && !exfile_.isEmpty() )
 	runargs = getInterpreterArgs();
@@ -290,6 +324,8 @@ ProcInst* ExtProc::getIdleInst( int nrsamples )
     if (!pD->idleinsts_.isEmpty())
 	pi = pD->idleinsts_.pop();
     pD->idleinstslock_.unLock();
+    if (pi==NULL)
+	pi = ProcInstPool::instance().take( pD->poolKey() );
     if (pi==NULL) {
 	pi = new ProcInst();
 	if (pi==NULL)
@@ -300,11 +336,21 @@ ProcInst* ExtProc::getIdleInst( int nrsamples )
 	}
     } else
 	pi->resize( nrsamples );
+
+    if (pi!=NULL && !pi->isOK()) {
+	ErrMsg( "ExtProc::getIdleInst - external attribute instance failed" );
+	delete pi;
+	pi = NULL;
+    }
     return pi;
 }
 
 void ExtProc::setInstIdle( ProcInst* pi )
 {
+    if (pi!=NULL && !pi->isOK()) {
+	delete pi;
+	return;
+    }
     pD->idleinstslock_.lock();
     if (pi!=NULL) {
 	pD->idleinsts_.push(pi);
@@ -318,6 +364,96 @@ bool ExtProc::compute( ProcInst* pi,  int z0, int inl, int crl)
     return pD->isok_;
 }
 
+int ExtProc::batchSize() const
+{
+    int batchsz = 1;
+    if (pD->jsonpar_.GetType() != json::NULLVal && pD->jsonpar_.HasKey("BatchSize"))
+	batchsz = pD->jsonpar_["BatchSize"];
+
+    return mMIN(mMAX(batchsz, 1), cMaxBatchSize);
+}
+
+void ExtProc::setBatchSize( int batchsz )
+{
+// The "Protocol" key is only added by the plugin so scripts requesting a
+// BatchSize still receive single trace frames from older plugin versions
+    pD->batchsize_ = mMIN(mMAX(batchsz, 1), cMaxBatchSize);
+    if (pD->batchsize_ > 1) {
+	json::Object jobj;
+	jobj["Version"] = 2;
+	jobj["BatchSize"] = pD->batchsize_;
+	pD->jsonpar_["Protocol"] = jobj;
+    }
+}
+
+bool ExtProc::shmTransport() const
+{
+    return pD->jsonpar_.GetType() != json::NULLVal && pD->jsonpar_.HasKey("Transport")
+	   && BufferString(pD->jsonpar_["Transport"].ToString().c_str()) == "shm";
+}
+
+void ExtProc::setShmTransport( bool yn )
+{
+#ifdef __win__
+    pD->shm_ = false;
+#else
+    pD->shm_ = yn;
+#endif
+}
+
+void ExtProc::setBatchInput( ProcInst* pi, int bidx, int inpdx, int trc, int idx, float val )
+{
+    pi->setBatchInput( bidx, inpdx, trc, idx, val );
+}
+
+float ExtProc::getBatchOutput( ProcInst* pi, int bidx, int outdx, int idx )
+{
+    return pi->getBatchOutput( bidx, outdx, idx );
+}
+
+float* ExtProc::getInputBuffer( ProcInst* pi, int bidx, int inpdx, int trc )
+{
+    return pi->inputBuffer( bidx, inpdx, trc );
+}
+
+const float* ExtProc::getOutputBuffer( ProcInst* pi, int bidx, int outdx )
+{
+    return pi->outputBuffer( bidx, outdx );
+}
+
+bool ExtProc::computeBatch( ProcInst* pi, int nrtrcs, int z0, const int* inls,
+			    const int* crls )
+{
+    pD->isok_ = pi->computeBatch( nrtrcs, z0, inls, crls );
+    return pD->isok_;
+}
+
+bool ExtProc::asyncCompute() const
+{
+    if (pD->jsonpar_.GetType() != json::NULLVal && pD->jsonpar_.HasKey("Async"))
+	return pD->jsonpar_["Async"];
+    else
+	return false;
+}
+
+bool ExtProc::submitBatch( ProcInst* pi, int nrtrcs, int z0, const int* inls,
+			   const int* crls )
+{
+    pD->isok_ = pi->submitBatch( nrtrcs, z0, inls, crls );
+    return pD->isok_;
+}
+
+bool ExtProc::collect( ProcInst* pi )
+{
+    pD->isok_ = pi->collect();
+    return pD->isok_;
+}
+
+bool ExtProc::canSubmit( ProcInst* pi ) const
+{
+    return pi->canSubmit();
+}
+
 BufferStringSet ExtProc::getInputNames() const
 {
     if (!hasInput() && !hasInputs())
@@ -45,6 +45,23 @@ public:
     void		setInput( ProcInst* pi, int input, int trc, int idx, float val );
     float		getOutput( ProcInst* pi, int output, int idx );
     bool		compute( ProcInst* pi, int z0, int inl, int crl );
+
+    int			batchSize() const;
+    void		setBatchSize( int batchsz );
+    bool		shmTransport() const;
+    void		setShmTransport( bool yn );
+    void		setBatchInput( ProcInst* pi, int bidx, int input, int trc, int idx,
+				       float val );
+    float		getBatchOutput( ProcInst* pi, int bidx, int output, int idx );
+    float*		getInputBuffer( ProcInst* pi, int bidx, int input, int trc );
+    const float*	getOutputBuffer( ProcInst* pi, int bidx, int output );
+    bool		computeBatch( ProcInst* pi, int nrtrcs, int z0, const int* inls,
+				      const int* crls );
+    bool		asyncCompute() const;
+    bool		submitBatch( ProcInst* pi, int nrtrcs, int z0, const int* inls,
+				     const int* crls );
+    bool		collect( ProcInst* pi );
+    bool		canSubmit( ProcInst* pi ) const;
 	
     BufferStringSet	getInputNames() const;
     BufferStringSet	getOutputNames() const;
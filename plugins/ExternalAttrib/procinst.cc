@@ -22,6 +22,7 @@ ________________________________________________________________________
 #include <stdlib.h>
 #include <sys/types.h>
 #include <fcntl.h>
+#include <atomic>
 
 #include "errmsg.h"
 #include "msgh.h"
@@ -37,8 +38,13 @@ ________________________________________________________________________
 #include <paths.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 
+// Number of input/output slabs in the shared memory ring
+static const int cShmSlots = 2;
+
 struct TrcInfo
 {
 	int		nrSamples;
@@ -54,11 +60,29 @@ public:
 	
 	float*			input;
 	float*			output;
+	int*			batchHdr;
 	int				nrSamples;
 	int				nrTraces;
 	int				nrOutput;
 	int				nrInput;
+	int				batchSize;
+	int				allocBatchSize;
 	TrcInfo			trcInfo;
+
+	bool			useShm;
+	BufferString	shmName;
+	int				shmFd;
+	char*			shmPtr;
+	size_t			shmSize;
+	int				shmSlot;
+	bool			failed;
+	int				nrPending;
+	int				pendingTrcs[cShmSlots];
+	int				pendingSlot[cShmSlots];
+
+	size_t			slotSize() const;
+	float*			slotInput( int slot );
+	float*			slotOutput( int slot );
 	
 	FILE*			read_fd;
 	FILE*			write_fd;
@@ -72,7 +96,7 @@ public:
 };
 
 ProcInstImpl::ProcInstImpl()
-: input(NULL), output(NULL), read_fd(NULL), write_fd(NULL)
+: input(NULL), output(NULL), batchHdr(NULL), read_fd(NULL), write_fd(NULL)
 {
 	logFile = FilePath::getTempFullPath(nullptr, nullptr);
 #ifdef __win__
@@ -85,6 +109,32 @@ ProcInstImpl::ProcInstImpl()
 	nrTraces = 0;
 	nrOutput = 1;
 	nrInput = 1;
+	batchSize = 1;
+	allocBatchSize = 0;
+	useShm = false;
+	shmFd = -1;
+	shmPtr = NULL;
+	shmSize = 0;
+	shmSlot = 0;
+	failed = false;
+	nrPending = 0;
+}
+
+// Each slot of the shared memory ring holds a full batch of input followed by
+// the matching output, using the same layout as the heap buffers
+size_t ProcInstImpl::slotSize() const
+{
+	return (size_t) nrSamples * batchSize * (nrTraces*nrInput + nrOutput);
+}
+
+float* ProcInstImpl::slotInput( int slot )
+{
+	return (float*) shmPtr + slot*slotSize();
+}
+
+float* ProcInstImpl::slotOutput( int slot )
+{
+	return slotInput( slot ) + (size_t) nrSamples * batchSize * nrTraces * nrInput;
 }
 
 
@@ -96,14 +146,25 @@ ProcInst::ProcInst()
 ProcInst::~ProcInst()
 {
 	finish();
-	if (pD->input != NULL)
-		delete [] pD->input;
-	if (pD->output != NULL)
-		delete [] pD->output;
+	if (pD->useShm) {
+		setShmTransport( false );
+	} else {
+		if (pD->input != NULL)
+			delete [] pD->input;
+		if (pD->output != NULL)
+			delete [] pD->output;
+	}
+	if (pD->batchHdr != NULL)
+		delete [] pD->batchHdr;
 
 	delete pD;
 }
 
+bool ProcInst::isOK() const
+{
+	return !pD->failed;
+}
+
 BufferString ProcInst::logFileName()
 {
 	return pD->logFile;
@@ -111,34 +172,168 @@ BufferString ProcInst::logFileName()
 
 void ProcInst::setInput( int inpdx, int trc, int idx, float val )
 {
-	int pos = inpdx*pD->nrSamples*pD->nrTraces + trc*pD->nrSamples + idx;
-	pD->input[pos] = val;
+	setBatchInput( 0, inpdx, trc, idx, val );
 }
 
 float ProcInst::getOutput( int outdx, int idx )
 {
-	int pos = outdx*pD->nrSamples + idx;
+	return getBatchOutput( 0, outdx, idx );
+}
+
+// Batch buffers are laid out input (output) major so each attribute input
+// (output) of a batch is one contiguous block: [input][batch][trace][sample]
+// and [output][batch][sample]. For a batch size of 1 this is the legacy layout.
+void ProcInst::setBatchInput( int bidx, int inpdx, int trc, int idx, float val )
+{
+	int pos = ((inpdx*pD->batchSize + bidx)*pD->nrTraces + trc)*pD->nrSamples + idx;
+	pD->input[pos] = val;
+}
+
+float ProcInst::getBatchOutput( int bidx, int outdx, int idx )
+{
+	int pos = (outdx*pD->batchSize + bidx)*pD->nrSamples + idx;
 	return pD->output[pos];
 }
 
+float* ProcInst::inputBuffer( int bidx, int inpdx, int trc )
+{
+	return pD->input + ((inpdx*pD->batchSize + bidx)*pD->nrTraces + trc)*pD->nrSamples;
+}
+
+const float* ProcInst::outputBuffer( int bidx, int outdx ) const
+{
+	return pD->output + (outdx*pD->batchSize + bidx)*pD->nrSamples;
+}
+
+void ProcInst::setBatchSize( int batchsz )
+{
+	pD->batchSize = batchsz>1 ? batchsz : 1;
+}
+
+int ProcInst::batchSize() const
+{
+	return pD->batchSize;
+}
+
 void ProcInst::resize( int nrsamples )
 {
-	if (nrsamples != pD->nrSamples) {
-		if (pD->input != NULL)
-			delete [] pD->input;
-		if (pD->output != NULL)
-			delete [] pD->output;
+	if (nrsamples != pD->nrSamples || pD->batchSize != pD->allocBatchSize) {
+		if (!pD->useShm) {
+			if (pD->input != NULL)
+				delete [] pD->input;
+			if (pD->output != NULL)
+				delete [] pD->output;
+		}
+		if (pD->batchHdr != NULL)
+			delete [] pD->batchHdr;
 		pD->nrSamples = nrsamples;
+		pD->allocBatchSize = pD->batchSize;
 		int nrtraces = pD->nrTraces;
 		int nrout = pD->nrOutput;
 		int nrin = pD->nrInput;
-		pD->input = new float[nrsamples*nrtraces*nrin];
-		pD->output = new float[nrsamples*nrout];
-		if (pD->input==NULL || pD->output==NULL)
+		int nrbatch = pD->batchSize;
+		pD->batchHdr = new int[2 + nrbatch*sizeof(TrcInfo)/sizeof(int)];
+		if (pD->useShm) {
+			if (!resizeShm()) {
+				ErrMsg( "ProcInst::resize - error resizing shared memory" );
+				pD->input = NULL;
+				pD->output = NULL;
+				pD->nrSamples = 0;
+				pD->allocBatchSize = 0;
+				pD->failed = true;
+			}
+			return;
+		}
+		pD->input = new float[nrsamples*nrtraces*nrin*nrbatch];
+		pD->output = new float[nrsamples*nrout*nrbatch];
+		if (pD->input==NULL || pD->output==NULL || pD->batchHdr==NULL)
 			ErrMsg( "ProcInst::resize - error allocating array space" );
 	}
 }
 
+// Not on macOS, ftruncate there cannot grow a POSIX shared memory object
+// once it has been sized
+bool ProcInst::setShmTransport( bool yn )
+{
+#if defined(__win__) || defined(__APPLE__)
+	return !yn;
+#else
+	if (yn == pD->useShm)
+		return true;
+	if (yn) {
+		if (pD->child_pid != -1 || pD->input != NULL) {
+			ErrMsg("ProcInst::setShmTransport - transport must be set before start");
+			return false;
+		}
+		static std::atomic<int> shmcount( 0 );
+		pD->shmName = "/odextattr_";
+		pD->shmName.add( (int) getpid() ).add( "_" ).add( shmcount++ );
+		pD->shmFd = shm_open( pD->shmName.buf(), O_CREAT | O_EXCL | O_RDWR,
+							  S_IRUSR | S_IWUSR );
+		if (pD->shmFd == -1) {
+			ErrMsg("ProcInst::setShmTransport - unable to create shared memory");
+			pD->shmName.setEmpty();
+			return false;
+		}
+		pD->useShm = true;
+	} else {
+		if (pD->shmPtr != NULL)
+			munmap( pD->shmPtr, pD->shmSize );
+		if (pD->shmFd != -1) {
+			close( pD->shmFd );
+			shm_unlink( pD->shmName.buf() );
+		}
+		pD->shmPtr = NULL;
+		pD->shmSize = 0;
+		pD->shmFd = -1;
+		pD->shmName.setEmpty();
+		pD->input = NULL;
+		pD->output = NULL;
+		pD->useShm = false;
+	}
+	return true;
+#endif
+}
+
+bool ProcInst::useShm() const
+{
+	return pD->useShm;
+}
+
+BufferString ProcInst::shmName() const
+{
+	return pD->shmName;
+}
+
+// The ring only ever grows, the external process maps as much of it as
+// the current trace length needs
+bool ProcInst::resizeShm()
+{
+#if defined(__win__) || defined(__APPLE__)
+	return false;
+#else
+	const size_t needed = cShmSlots * pD->slotSize() * sizeof(float);
+	if (needed > pD->shmSize) {
+		if (pD->shmPtr != NULL)
+			munmap( pD->shmPtr, pD->shmSize );
+		pD->shmPtr = NULL;
+		pD->shmSize = 0;
+		if (ftruncate( pD->shmFd, needed ) == -1)
+			return false;
+		void* ptr = mmap( NULL, needed, PROT_READ | PROT_WRITE, MAP_SHARED,
+						  pD->shmFd, 0 );
+		if (ptr == MAP_FAILED)
+			return false;
+		pD->shmPtr = (char*) ptr;
+		pD->shmSize = needed;
+	}
+	pD->shmSlot = 0;
+	pD->input = pD->slotInput( 0 );
+	pD->output = pD->slotOutput( 0 );
+	return true;
+#endif
+}
+
 bool ProcInst::start( const BufferStringSet& runargs)
 {
 #ifdef __win__
@@ -371,6 +566,7 @@ bool ProcInst::start( const BufferStringSet& runargs, SeisInfo& si )
 	} else {
 		ErrMsg("ProcInst::start - run error");
 	}
+	pD->failed = !result;
 	return result;
 }
 
@@ -473,16 +669,96 @@ BufferString ProcInst::readAllStdOut()
 
 bool ProcInst::compute( int z0, int inl, int crl )
 {
-	bool result = false;
+	if (pD->useShm)
+		return computeBatch( 1, z0, &inl, &crl );
+
 // 	Send info packet to process stdin
-	result |= writeTrcInfo( z0, inl, crl );
+	const bool infook = writeTrcInfo( z0, inl, crl );
 // 	Send input array to process stdin
-	result |= writeData();
+	const bool writeok = writeData();
 // 	Read output array from process stdout 
-	result |= readData();
+	const bool readok = readData();
+	if (!infook || !writeok || !readok)
+		pD->failed = true;
+	return infook || writeok || readok;
+}
+
+bool ProcInst::computeBatch( int nrtrcs, int z0, const int* inls, const int* crls )
+{
+	if (pD->nrPending>0) {
+		ErrMsg("ProcInst::computeBatch - results of an earlier submit not collected");
+		return false;
+	}
+	return submitBatch( nrtrcs, z0, inls, crls ) && collect();
+}
+
+// Asynchronous mode: submitBatch sends a batch and returns without waiting,
+// collect reads the result of the oldest outstanding batch. With the pipe
+// transport only one batch can be outstanding, the shared memory ring allows
+// the next batch to be submitted before the previous one is collected.
+bool ProcInst::submitBatch( int nrtrcs, int z0, const int* inls, const int* crls )
+{
+	if (nrtrcs<1 || nrtrcs>pD->batchSize) {
+		ErrMsg("ProcInst::submitBatch - invalid number of traces in batch");
+		return false;
+	}
+	if (!canSubmit()) {
+		ErrMsg("ProcInst::submitBatch - too many outstanding batches");
+		return false;
+	}
+
+	bool result = false;
+	if (pD->useShm)
+		result = writeShmInfo( nrtrcs, z0, inls, crls );
+	else if (pD->batchSize==1)
+		result = writeTrcInfo( z0, inls[0], crls[0] ) && writeData();
+	else
+		result = writeBatchInfo( nrtrcs, z0, inls, crls )
+				 && writeBatchData( nrtrcs );
+
+	if (!result) {
+		pD->failed = true;
+		return false;
+	}
+	pD->pendingTrcs[pD->nrPending] = nrtrcs;
+	pD->nrPending++;
+	return true;
+}
+
+bool ProcInst::collect()
+{
+	if (pD->nrPending<1) {
+		ErrMsg("ProcInst::collect - nothing submitted");
+		return false;
+	}
+	const int nrtrcs = pD->pendingTrcs[0];
+	for (int idx=1; idx<pD->nrPending; idx++)
+		pD->pendingTrcs[idx-1] = pD->pendingTrcs[idx];
+	pD->nrPending--;
+
+	bool result = false;
+	if (pD->useShm)
+		result = readShmResult( nrtrcs );
+	else if (pD->batchSize==1)
+		result = readData();
+	else
+		result = readBatchData( nrtrcs );
+
+	if (!result)
+		pD->failed = true;
 	return result;
 }
 
+bool ProcInst::canSubmit() const
+{
+	return pD->nrPending < (pD->useShm ? cShmSlots : 1);
+}
+
+int ProcInst::nrPending() const
+{
+	return pD->nrPending;
+}
+
 bool ProcInst::writeSeisInfo( SeisInfo& si )
 {
 	pD->nrTraces = si.nrTraces;
@@ -563,3 +839,122 @@ bool ProcInst::readData()
 		return false;
 	}
 }
+
+// A batch frame starts with the number of traces in the batch followed by
+// one TrcInfo block per trace, all sent with a single write.
+bool ProcInst::writeBatchInfo( int nrtrcs, int z0, const int* inls, const int* crls )
+{
+	if (pD->write_fd) {
+		int* hdr = pD->batchHdr + 1;
+		hdr[0] = nrtrcs;
+		TrcInfo* tis = (TrcInfo*) (hdr+1);
+		for (int idx=0; idx<nrtrcs; idx++) {
+			tis[idx].nrSamples = pD->nrSamples;
+			tis[idx].z0 = z0;
+			tis[idx].inl = inls[idx];
+			tis[idx].crl = crls[idx];
+		}
+		size_t nbytes = sizeof(int) + nrtrcs*sizeof(TrcInfo);
+		size_t res = fwrite((void*) hdr, nbytes, 1, pD->write_fd);
+		if (res != 1) {
+			ErrMsg("ProcInst::writeBatchInfo - error writing batch info block to external attribute");
+			return false;
+		}
+		fflush(pD->write_fd);
+		return true;
+	} else {
+		ErrMsg("ProcInst::writeBatchInfo - no stdin");
+		return false;
+	}
+}
+
+bool ProcInst::writeBatchData( int nrtrcs )
+{
+	if (pD->write_fd) {
+		size_t nbytes = sizeof(float);
+		size_t blksize = pD->nrSamples * pD->nrTraces;
+		size_t nsize = blksize * nrtrcs;
+		for (int inpdx=0; inpdx<pD->nrInput; inpdx++) {
+			float* inp = pD->input + inpdx*blksize*pD->batchSize;
+			size_t res = fwrite((void*) inp, nbytes, nsize, pD->write_fd);
+			if (res != nsize) {
+				ErrMsg("ProcInst::writeBatchData - error writing data to external attribute");
+				return false;
+			}
+		}
+		fflush(pD->write_fd);
+		return true;
+	} else {
+		ErrMsg("ProcInst::writeBatchData - no stdin");
+		return false;
+	}
+}
+
+bool ProcInst::readBatchData( int nrtrcs )
+{
+	if (pD->read_fd) {
+		size_t nbytes = sizeof(float);
+		size_t nsize = pD->nrSamples * nrtrcs;
+		for (int outdx=0; outdx<pD->nrOutput; outdx++) {
+			float* out = pD->output + outdx*pD->nrSamples*pD->batchSize;
+			size_t res = fread((void*) out, nbytes, nsize, pD->read_fd);
+			if (res != nsize) {
+				ErrMsg("ProcInst::readBatchData - error reading from external attribute");
+				return false;
+			}
+		}
+		return true;
+	} else {
+		ErrMsg("ProcInst::readBatchData - no stdout");
+		return false;
+	}
+}
+
+// With the shared memory transport only the slot number and the batch
+// header go through the pipe. The external process replies with the number
+// of traces it has written to the output slab of that slot.
+bool ProcInst::writeShmInfo( int nrtrcs, int z0, const int* inls, const int* crls )
+{
+	if (!pD->write_fd || pD->shmPtr == NULL) {
+		ErrMsg("ProcInst::writeShmInfo - no connection to external attribute");
+		return false;
+	}
+	const int slot = pD->shmSlot;
+	int* hdr = pD->batchHdr;
+	hdr[0] = slot;
+	hdr[1] = nrtrcs;
+	TrcInfo* tis = (TrcInfo*) (hdr+2);
+	for (int idx=0; idx<nrtrcs; idx++) {
+		tis[idx].nrSamples = pD->nrSamples;
+		tis[idx].z0 = z0;
+		tis[idx].inl = inls[idx];
+		tis[idx].crl = crls[idx];
+	}
+	size_t nbytes = 2*sizeof(int) + nrtrcs*sizeof(TrcInfo);
+	if (fwrite((void*) hdr, nbytes, 1, pD->write_fd) != 1) {
+		ErrMsg("ProcInst::writeShmInfo - error writing batch info block to external attribute");
+		return false;
+	}
+	fflush(pD->write_fd);
+
+	pD->pendingSlot[pD->nrPending] = slot;
+	pD->shmSlot = (slot+1) % cShmSlots;
+	pD->input = pD->slotInput( pD->shmSlot );
+	return true;
+}
+
+bool ProcInst::readShmResult( int nrtrcs )
+{
+	const int slot = pD->pendingSlot[0];
+	for (int idx=1; idx<cShmSlots; idx++)
+		pD->pendingSlot[idx-1] = pD->pendingSlot[idx];
+
+	int nrdone = 0;
+	if (!pD->read_fd || fread((void*) &nrdone, sizeof(int), 1, pD->read_fd) != 1
+					 || nrdone != nrtrcs) {
+		ErrMsg("ProcInst::readShmResult - error reading from external attribute");
+		return false;
+	}
+	pD->output = pD->slotOutput( slot );
+	return true;
+}
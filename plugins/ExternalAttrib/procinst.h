@@ -45,14 +45,29 @@ public:
 	
 	void			setInput( int input, int trc, int idx, float val );
 	float			getOutput( int output, int idx );
+	void			setBatchInput( int bidx, int input, int trc, int idx, float val );
+	float			getBatchOutput( int bidx, int output, int idx );
+	float*			inputBuffer( int bidx, int input, int trc );
+	const float*	outputBuffer( int bidx, int output ) const;
 	void			resize( int nrsamples );
+	void			setBatchSize( int batchsz );
+	int				batchSize() const;
+	bool			setShmTransport( bool yn );
+	bool			useShm() const;
+	BufferString	shmName() const;
 
 	bool			start( const BufferStringSet& runargs);
 	bool			start( const BufferStringSet& runargs, SeisInfo& si );
 	int				finish();
+	bool			isOK() const;
 	BufferString	logFileName();
 	BufferString	readAllStdOut();
 	bool			compute( int z0, int inl, int crl );
+	bool			computeBatch( int nrtrcs, int z0, const int* inls, const int* crls );
+	bool			submitBatch( int nrtrcs, int z0, const int* inls, const int* crls );
+	bool			collect();
+	bool			canSubmit() const;
+	int				nrPending() const;
 
 	void			processLog();
 	
@@ -61,6 +76,12 @@ protected:
 	bool			writeTrcInfo( int z0, int inl, int crl );
 	bool			writeData();
 	bool			readData();
+	bool			writeBatchInfo( int nrtrcs, int z0, const int* inls, const int* crls );
+	bool			writeBatchData( int nrtrcs );
+	bool			readBatchData( int nrtrcs );
+	bool			writeShmInfo( int nrtrcs, int z0, const int* inls, const int* crls );
+	bool			readShmResult( int nrtrcs );
+	bool			resizeShm();
 	
 	ProcInstImpl*	pD;
 
@@ -0,0 +1,168 @@
+/*Copyright (C) 2026 Wayne Mogg All rights reserved.
+
+This file may be used either under the terms of:
+
+1. The GNU General Public License version 3 or higher, as published by
+the Free Software Foundation, or
+
+This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+/*+
+________________________________________________________________________
+
+ Author:        Wayne Mogg
+ Date:          October 2026
+ ________________________________________________________________________
+
+-*/
+#include <chrono>
+
+#include "procinstpool.h"
+#include "procinst.h"
+#include "envvars.h"
+#include "genc.h"
+
+typedef std::chrono::steady_clock PoolClock;
+
+struct ProcInstPoolEntry
+{
+	BufferString		key;
+	ProcInst*			pi;
+	PoolClock::time_point	idlesince;
+};
+
+static void clearProcInstPool()
+{
+	ProcInstPool::instance().clear();
+}
+
+ProcInstPool& ProcInstPool::instance()
+{
+// Never destroyed, the pooled processes are stopped from the program exit
+// notifier while the message handlers used by ProcInst::finish are still alive
+	static ProcInstPool* pool = nullptr;
+	static Threads::Lock instlock;
+	Threads::Locker lckr( instlock );
+	if (!pool) {
+		pool = new ProcInstPool;
+		NotifyExitProgram( &clearProcInstPool );
+	}
+	return *pool;
+}
+
+ProcInstPool::ProcInstPool()
+	: maxsize_(GetEnvVarIVal("OD_EX_POOL_SIZE", 8))
+	, idletimeout_(GetEnvVarIVal("OD_EX_POOL_TIMEOUT", 300))
+{
+}
+
+ProcInstPool::~ProcInstPool()
+{
+	clear();
+}
+
+ProcInst* ProcInstPool::take( const char* key )
+{
+	ObjectSet<ProcInst> expired;
+	ProcInst* pi = nullptr;
+	{
+		Threads::Locker lckr( lock_ );
+		getExpired( expired );
+		for (int idx=entries_.size()-1; idx>=0; idx--) {
+			if (entries_[idx]->key == key) {
+				ProcInstPoolEntry* entry = entries_.removeSingle( idx );
+				pi = entry->pi;
+				delete entry;
+				break;
+			}
+		}
+	}
+	deepErase( expired );
+	return pi;
+}
+
+void ProcInstPool::release( const char* key, ObjectSet<ProcInst>& pis )
+{
+	ObjectSet<ProcInst> expired;
+	{
+		Threads::Locker lckr( lock_ );
+		const PoolClock::time_point now = PoolClock::now();
+		for (int idx=0; idx<pis.size(); idx++) {
+			if (!pis[idx] || !pis[idx]->isOK()) {
+				expired += pis[idx];
+				continue;
+			}
+			ProcInstPoolEntry* entry = new ProcInstPoolEntry;
+			entry->key = key;
+			entry->pi = pis[idx];
+			entry->idlesince = now;
+			entries_ += entry;
+		}
+		getExpired( expired );
+	}
+	pis.erase();
+	deepErase( expired );
+}
+
+// Collects the timed out entries and the oldest ones beyond the maximum pool
+// size, the caller stops them outside the lock
+void ProcInstPool::getExpired( ObjectSet<ProcInst>& expired )
+{
+	const PoolClock::time_point now = PoolClock::now();
+	const std::chrono::seconds timeout( idletimeout_ );
+	for (int idx=entries_.size()-1; idx>=0; idx--) {
+		if (now-entries_[idx]->idlesince > timeout) {
+			ProcInstPoolEntry* entry = entries_.removeSingle( idx );
+			expired += entry->pi;
+			delete entry;
+		}
+	}
+	while (entries_.size() > maxsize_) {
+		ProcInstPoolEntry* entry = entries_.removeSingle( 0 );
+		expired += entry->pi;
+		delete entry;
+	}
+}
+
+void ProcInstPool::setMaxSize( int maxsz )
+{
+	ObjectSet<ProcInst> expired;
+	{
+		Threads::Locker lckr( lock_ );
+		maxsize_ = maxsz>0 ? maxsz : 0;
+		getExpired( expired );
+	}
+	deepErase( expired );
+}
+
+int ProcInstPool::maxSize() const
+{
+	Threads::Locker lckr( lock_ );
+	return maxsize_;
+}
+
+void ProcInstPool::setIdleTimeout( int seconds )
+{
+	Threads::Locker lckr( lock_ );
+	idletimeout_ = seconds>0 ? seconds : 0;
+}
+
+int ProcInstPool::idleTimeout() const
+{
+	Threads::Locker lckr( lock_ );
+	return idletimeout_;
+}
+
+void ProcInstPool::clear()
+{
+	ObjectSet<ProcInst> pis;
+	{
+		Threads::Locker lckr( lock_ );
+		for (auto* entry : entries_)
+			pis += entry->pi;
+		deepErase( entries_ );
+	}
+	deepErase( pis );
+}
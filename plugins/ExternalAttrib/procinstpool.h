@@ -0,0 +1,68 @@
+/*Copyright (C) 2026 Wayne Mogg All rights reserved.
+
+This file may be used either under the terms of:
+
+1. The GNU General Public License version 3 or higher, as published by
+the Free Software Foundation, or
+
+This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+#ifndef procinstpool_h
+#define procinstpool_h
+
+/*+
+________________________________________________________________________
+
+ Author:        Wayne Mogg
+ Date:          October 2026
+ ________________________________________________________________________
+
+-*/
+#include "bufstring.h"
+#include "objectset.h"
+#include "threadlock.h"
+
+class ProcInst;
+struct ProcInstPoolEntry;
+
+/*!\brief Process wide pool of idle external attribute processes
+
+Keeps running ProcInst's alive after the ExtProc that started them is gone so
+a later job with the same interpreter, script and parameters can reuse the
+warm interpreter instead of starting a new one. The key identifies everything
+the process was started with.
+
+The maximum number of pooled processes and their idle timeout in seconds
+default to the OD_EX_POOL_SIZE and OD_EX_POOL_TIMEOUT environment variables.
+A pool size of 0 disables pooling. Timed out processes are stopped the next
+time the pool is used.
+*/
+
+class ProcInstPool {
+public:
+	static ProcInstPool&	instance();
+	~ProcInstPool();
+
+	ProcInst*		take( const char* key );
+	void			release( const char* key, ObjectSet<ProcInst>& );
+
+	void			setMaxSize( int );
+	int				maxSize() const;
+	void			setIdleTimeout( int seconds );
+	int				idleTimeout() const;
+	void			clear();
+
+protected:
+	ProcInstPool();
+
+	void			getExpired( ObjectSet<ProcInst>& );
+
+	ObjectSet<ProcInstPoolEntry>	entries_;
+	int				maxsize_;
+	int				idletimeout_;
+	mutable Threads::Lock	lock_;
+};
+
+#endif
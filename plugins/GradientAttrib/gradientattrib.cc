@@ -26,6 +26,9 @@ ________________________________________________________________________
 #include "attribdescset.h"
 #include "attribfactory.h"
 #include "attribparam.h"
+#include "seisselection.h"
+#include "trckeyzsampling.h"
+#include "tracegather.h"
 #include <math.h>
 
 namespace Attrib
@@ -72,6 +75,11 @@ GradientAttrib::GradientAttrib( Desc& desc )
 	, size_(0)
     , stepout_(0,0)
     , zmargin_(0,0)
+	, tilesz_(1)
+	, nrpos_(1)
+	, colstep_(1)
+	, crlstep_(1)
+	, reqstepout_(0,0)
 {
     if ( !isOK() ) return;
 
@@ -128,10 +136,13 @@ GradientAttrib::GradientAttrib( Desc& desc )
     getTrcPos();
     zmargin_ = Interval<int>(-hsz, hsz);
     inputdata_.allowNull( true );
+
+	reqstepout_ = BinID( stepout_.inl(), stepout_.crl()+cTileSize-1 );
 }
 
 GradientAttrib::~GradientAttrib()
 {
+	deepErase( tileres_ );
 	delete [] ikernel_;
 	delete [] xkernel_;
 	delete [] zkernel_;
@@ -159,10 +170,13 @@ bool GradientAttrib::getTrcPos()
 
 bool GradientAttrib::getInputData( const BinID& relpos, int zintv )
 {
-	while ( inputdata_.size() < trcpos_.size() )
+	const int ncols = size_ + tilesz_ - 1;
+	while ( inputdata_.size() < size_*ncols )
 		inputdata_ += 0;
 
 	const BinID bidstep = inputs_[0]->getStepoutStep();
+	nrpos_ = 1;
+	bool replaced = false;
 	for ( int idx=0; idx<trcpos_.size(); idx++ )
 	{
 		const DataHolder* data =
@@ -171,53 +185,233 @@ bool GradientAttrib::getInputData( const BinID& relpos, int zintv )
             const BinID pos = relpos + trcpos_[centertrcidx_]*bidstep;
             data = inputs_[0]->getData( pos, zintv );
             if ( !data ) return false;
+			replaced = true;
         }
-		inputdata_.replace( idx, data );
+		inputdata_.replace( (idx/size_)*ncols + idx%size_, data );
 	}
 
 	dataidx_ = getDataIndex( 0 );
 
+// Following positions are only added while all their traces exist
+	const int hsz = size_/2;
+	int lastcol = size_ - 1;
+	for ( int pidx=1; pidx<tilesz_ && !replaced; pidx++ ) {
+		const int endcol = pidx*colstep_ + size_ - 1;
+		if ( endcol>=ncols )
+			break;
+		for ( int col=mMAX(pidx*colstep_,lastcol+1); col<=endcol; col++ ) {
+			for ( int iln=0; iln<size_; iln++ ) {
+				const BinID pos = relpos + BinID(iln-hsz, col-hsz)*bidstep;
+				const DataHolder* data = inputs_[0]->getData( pos, zintv );
+				if ( !data )
+					return true;
+				inputdata_.replace( iln*ncols+col, data );
+			}
+		}
+		lastcol = endcol;
+		nrpos_ = pidx+1;
+	}
+
 	return true;
 }
 
 bool GradientAttrib::computeData( const DataHolder& output, const BinID& relpos,
 				  int z0, int nrsamples, int threadid ) const
 {
-
 	if ( inputdata_.isEmpty() ) return false;
 
+	if ( tilesz_>1 )
+		return getTileResult( output, z0, nrsamples )
+			   || computeTile( output, z0, nrsamples );
+
+	return computeTrace( output, z0, nrsamples );
+}
+
+bool GradientAttrib::computeTrace( const DataHolder& output, int z0,
+				   int nrsamples ) const
+{
 	const int sz = zmargin_.width() + nrsamples;
+	const int ncols = size_ + tilesz_ - 1;
 	Array1DImpl<float> vals( sz );
-	const int hsz = size_/2;
 
-	for ( int idx=0; idx<sz; idx++ ) {
-		float reso = 0.0;
+	auto getval = [&]( const DataHolder& dh, int sampidx )
+			{ return getInputValue( dh, dataidx_, sampidx, z0 ); };
+	wmGather::TraceBlock<float> block( size_*size_, sz );
+	for (int iln=0; iln<size_; iln++) {
+		for (int crl=0; crl<size_; crl++)
+			wmGather::gatherTrace( inputdata_[iln*ncols+crl], dataidx_, z0,
+					       zmargin_.start, sz,
+					       block.trace(iln*size_+crl), getval );
+	}
+
+	for ( int idx=0; idx<sz; idx++ )
+		vals.set( idx, 0.0f );
+	for (int iln=0; iln<size_; iln++) {
+		for (int crl=0; crl<size_; crl++) {
+			const float wt = ikernel_[iln]*xkernel_[crl];
+			const float* trc = block.trace( iln*size_+crl );
+			float* res = vals.getData();
+			for ( int idx=0; idx<sz; idx++ )
+				res[idx] += wt*trc[idx];
+		}
+	}
+
+	TypeSet<float> res( nrsamples, 0.0f );
+	zFilter( vals.getData(), res.arr(), nrsamples );
+	for (int idx=0; idx<nrsamples; idx++)
+		setOutputValue( output, 0, idx, z0, res[idx] );
+	return true;
+}
+
+bool GradientAttrib::computeTile( const DataHolder& output, int z0,
+				  int nrsamples ) const
+{
+	const int sz = zmargin_.width() + nrsamples;
+	const int ncols = size_ + tilesz_ - 1;
+	const int nrpos = nrpos_;
+	const int nrcols = (nrpos-1)*colstep_ + size_;
+	const BinID bin = getCurrentPosition();
+
+	auto getval = [&]( const DataHolder& dh, int sampidx )
+			{ return getInputValue( dh, dataidx_, sampidx, z0 ); };
+
+// Inline pass, one trace per crossline column of the tile
+	wmGather::TraceBlock<float> trc( 1, sz );
+	wmGather::TraceBlock<float> ifilt( nrcols, sz );
+	for (int col=0; col<nrcols; col++) {
+		if ( colstep_>size_ && col%colstep_>=size_ )
+			continue;
+
+		float* res = ifilt.trace( col );
+		for ( int idx=0; idx<sz; idx++ )
+			res[idx] = 0.0f;
 		for (int iln=0; iln<size_; iln++) {
-			float res = 0.0;
-			for (int crl=0; crl<size_; crl++) {
-				const DataHolder* data = inputdata_[iln*size_+crl];
-				float val = getInputValue(*data, dataidx_, zmargin_.start+idx, z0);
-				res += mIsUdf(val)?0.0f:val*xkernel_[crl];
+			wmGather::gatherTrace( inputdata_[iln*ncols+col], dataidx_, z0,
+					       zmargin_.start, sz, trc.data(), getval );
+			const float wt = ikernel_[iln];
+			const float* vals = trc.data();
+			for ( int idx=0; idx<sz; idx++ )
+				res[idx] += wt*vals[idx];
+		}
+	}
+
+// Crossline and z passes per position
+	wmGather::TraceBlock<float> xfilt( 1, sz );
+	TypeSet<float> res( nrsamples, 0.0f );
+	ObjectSet<TileResult> ahead;
+	for (int pidx=0; pidx<nrpos; pidx++) {
+		float* xvals = xfilt.data();
+		for ( int idx=0; idx<sz; idx++ )
+			xvals[idx] = 0.0f;
+		for (int crl=0; crl<size_; crl++) {
+			const float wt = xkernel_[crl];
+			const float* vals = ifilt.trace( pidx*colstep_+crl );
+			for ( int idx=0; idx<sz; idx++ )
+				xvals[idx] += wt*vals[idx];
+		}
+
+		if ( pidx==0 ) {
+			zFilter( xvals, res.arr(), nrsamples );
+			for (int idx=0; idx<nrsamples; idx++)
+				setOutputValue( output, 0, idx, z0, res[idx] );
+			continue;
+		}
+
+		TileResult* tr = new TileResult;
+		tr->pos_ = BinID( bin.inl(), bin.crl() + pidx*crlstep_ );
+		tr->z0_ = z0;
+		tr->nrsamples_ = nrsamples;
+		tr->vals_.setSize( nrsamples, 0.0f );
+		zFilter( xvals, tr->vals_.arr(), nrsamples );
+		ahead += tr;
+	}
+
+	Threads::Locker lckr( tilelock_ );
+	for (int ires=tileres_.size()-1; ires>=0; ires--) {
+		for (int aidx=0; aidx<ahead.size(); aidx++) {
+			if ( tileres_[ires]->pos_==ahead[aidx]->pos_ ) {
+				delete tileres_.removeSingle( ires );
+				break;
 			}
-			reso += ikernel_[iln]*res;
 		}
-		vals.set(idx, reso);
 	}
+	tileres_.append( ahead );
+	return true;
+}
 
+bool GradientAttrib::getTileResult( const DataHolder& output, int z0,
+				    int nrsamples ) const
+{
+	const BinID bin = getCurrentPosition();
+	bool found = false;
+	Threads::Locker lckr( tilelock_ );
+	for (int ires=tileres_.size()-1; ires>=0; ires--) {
+		const TileResult* tr = tileres_[ires];
+		if ( tr->pos_.inl()!=bin.inl() || tr->pos_.crl()<bin.crl() ) {
+			delete tileres_.removeSingle( ires );
+			continue;
+		}
+		if ( found || tr->pos_!=bin || tr->z0_!=z0 || tr->nrsamples_!=nrsamples )
+			continue;
+
+		for (int idx=0; idx<nrsamples; idx++)
+			setOutputValue( output, 0, idx, z0, tr->vals_[idx] );
+		delete tileres_.removeSingle( ires );
+		found = true;
+	}
+	return found;
+}
+
+void GradientAttrib::zFilter( const float* vals, float* res, int nrsamples ) const
+{
 	for (int idx=0; idx<nrsamples; idx++) {
 		float value = 0.0;
-		const int ipos = idx - zmargin_.start - hsz;
-		for (int zi=0; zi<size_; zi++) {
-			value += vals[ipos+zi]*zkernel_[zi];
-		}
-		setOutputValue( output, 0, idx, z0, value );
+		for (int zi=0; zi<size_; zi++)
+			value += vals[idx+zi]*zkernel_[zi];
+		res[idx] = value;
 	}
-	return true;
 }
 
 
+// Tiles only pay off when whole runs of crosslines on an inline are computed, so not
+// for 2D, crossline sections, single traces, random lines or picked positions
+bool GradientAttrib::useTiles() const
+{
+	if ( is2D() || !desiredvolume_ )
+		return false;
+	if ( seldata_ && seldata_->type()!=Seis::Range )
+		return false;
+
+	const int colstep = tileColStep();
+	return colstep>0 && colstep<cTileSize
+		&& desiredvolume_->hsamp_.nrCrl() >= cTileSize;
+}
+
+// Number of input traces between output positions along the crossline, 0 when the
+// output crossline step is not a multiple of the input step
+int GradientAttrib::tileColStep() const
+{
+	if ( !desiredvolume_ || inputs_.isEmpty() || !inputs_[0] )
+		return 0;
+
+	const int instep = inputs_[0]->getStepoutStep().crl();
+	const int outstep = desiredvolume_->hsamp_.step_.crl();
+	if ( instep<=0 || outstep<instep || outstep%instep )
+		return 0;
+
+	return outstep/instep;
+}
+
+void GradientAttrib::prepareForComputeData()
+{
+	Provider::prepareForComputeData();
+	tilesz_ = useTiles() ? cTileSize : 1;
+	colstep_ = tilesz_>1 ? tileColStep() : 1;
+	crlstep_ = desiredvolume_ ? desiredvolume_->hsamp_.step_.crl() : 1;
+}
+
 const BinID* GradientAttrib::desStepout( int inp, int out ) const
-{ return &stepout_; }
+{ return useTiles() ? &reqstepout_ : &stepout_; }
 
 
 }; //namespace
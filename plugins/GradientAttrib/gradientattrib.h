@@ -23,6 +23,7 @@ ________________________________________________________________________
 
 #include "gradientattribmod.h"
 #include "attribprovider.h"
+#include "threadlock.h"
 
 
 /*!\brief Gradient Attribute
@@ -65,6 +66,13 @@ protected:
 
 	bool					getInputData(const BinID&,int zintv);
 	bool					computeData(const DataHolder&, const BinID& relpos, int z0, int nrsamples, int threadid) const;
+	bool					computeTrace(const DataHolder&, int z0, int nrsamples) const;
+	bool					computeTile(const DataHolder&, int z0, int nrsamples) const;
+	bool					getTileResult(const DataHolder&, int z0, int nrsamples) const;
+	void					zFilter(const float* vals, float* res, int nrsamples) const;
+	bool					useTiles() const;
+	int						tileColStep() const;
+	void					prepareForComputeData();
 
 	const BinID*			desStepout(int input,int output) const;
 	const Interval<int>*	desZSampMargin(int input,int output) const
@@ -85,6 +93,36 @@ protected:
 	int						dataidx_;
 
 	ObjectSet<const DataHolder>	inputdata_;
+
+/* Brick mode: the input traces for the output positions following the
+   current one along the crossline are gathered as well, inputdata_ holding
+   size_ inline rows of size_+tilesz_-1 traces. Output positions are colstep_
+   input traces apart, so a decimated output keeps fewer positions per tile.
+   The whole tile is filtered in three passes, first along inline giving one
+   trace per crossline column, then along crossline and z, so the inline pass
+   of a column is shared by all positions that use it. Results for the
+   following positions are kept, keyed on the output crossline step crlstep_,
+   until the attribute engine asks for them. Tiles are only used when the
+   desired volume spans at least cTileSize crosslines and its crossline step
+   leaves more than one position per tile, everything else, 2D included, uses
+   the per trace computation.
+*/
+	struct TileResult
+	{
+		BinID				pos_;
+		int					z0_;
+		int					nrsamples_;
+		TypeSet<float>		vals_;
+	};
+
+	static const int		cTileSize = 16;
+	int						tilesz_;
+	int						nrpos_;
+	int						colstep_;
+	int						crlstep_;
+	BinID					reqstepout_;
+	mutable ObjectSet<TileResult>	tileres_;
+	mutable Threads::Lock	tilelock_;
 };
 
 }; // namespace Attrib
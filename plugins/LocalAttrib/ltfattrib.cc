@@ -28,9 +28,37 @@
 #include "math2.h"
 
 #include "rsflib.h"
+
+#include <cmath>
+#include <vector>
+
 namespace Attrib
 {
 
+/* Per thread solver and trace buffers. The sine and cosine systems of all frequencies are
+   interleaved, sample index slowest, so that they are solved together by one DivnBatch. */
+struct LTFAttrib::Workspace
+{
+    sf::DivnBatch*		divn_ = nullptr;
+    std::vector<float>		num_;
+    std::vector<float>		den_;
+    std::vector<float>		rat_;
+    
+    ~Workspace()		{ delete divn_; }
+    
+    sf::DivnBatch&		getDivn( int ns, int smooth, int nrhs, int niter )
+    {
+	if ( !divn_ || !divn_->isSame(ns,smooth,nrhs,niter) ) {
+	    delete divn_;
+	    divn_ = new sf::DivnBatch( ns, smooth, nrhs, niter );
+	    num_.resize( ns*nrhs );
+	    den_.resize( ns*nrhs );
+	    rat_.resize( ns*nrhs );
+	}
+	return *divn_;
+    }
+};
+
 mAttrDefCreateInstance(LTFAttrib)    
     
 void LTFAttrib::initClass()
@@ -111,6 +139,9 @@ LTFAttrib::LTFAttrib( Desc& desc )
 //	dessamp_ = Interval<int>(-smooth_*margin_, smooth_*margin_);
 }
 
+LTFAttrib::~LTFAttrib()
+{}
+
 bool LTFAttrib::getInputData( const BinID& relpos, int zintv )
 {
 	indata_ = inputs_[0]->getData( relpos, zintv );
@@ -156,41 +187,70 @@ bool LTFAttrib::computeData( const DataHolder& output, const BinID& relpos,
     int ns = zsampMargin_.width() + nrsamples;
     const int nfreq = outputinterest_.size();
     
-	Array1DImpl<float> ss(ns), bs(ns), bc(ns), trc(ns), cc(ns);
+    TypeSet<int> freqidxs;
+    for (int idf=0; idf<nfreq; idf++) {
+        if (outputinterest_[idf])
+            freqidxs += idf;
+    }
+    const int nrhs = 2*freqidxs.size();
+    if (nrhs == 0)
+        return true;
+    
 	int smooth = mNINT32(window_/(2.0*getRefStep()));
-    sf::Divn sfdivn(1,ns,&ns,&smooth,niter_);
+    Workspace& ws = workspaces_.get( threadid );
+    sf::DivnBatch& sfdivn = ws.getDivn( ns, smooth, nrhs, niter_ );
+    float* num = ws.num_.data();
+    float* den = ws.den_.data();
+    float* rat = ws.rat_.data();
 	
 	for (int idx=0; idx<ns; idx++) {
 		float val = getInputValue(*indata_, indataidx_, zsampMargin_.start+idx, z0);
 		val = mIsUdf(val)?0.0f:val;
-		trc.set(idx,val);
+		for (int irhs=0; irhs<nrhs; irhs++)
+		    num[idx*nrhs+irhs] = val;
 	}
 	int off = zsampMargin_.start-mNINT32((gate_.start + gate_.stop)/2.0/getRefStep());
     
-    for (int idf=0; idf<nfreq; idf++) {
-        if (!outputinterest_[idf])
-            continue;
-        float freq = step_ * (idf+1);
+    // Sine and cosine basis by rotation, starting from the exact phase at the first sample
+    const double t0 = (z0 + zsampMargin_.start) * refstep_;
+    for (int ifreq=0; ifreq<freqidxs.size(); ifreq++) {
+        float freq = step_ * (freqidxs[ifreq]+1);
         float w = freq * 2.0 * M_PIf;
-        
+        float* bs = den + 2*ifreq;
+        float* bc = bs + 1;
         if (w == 0.) {
+            // no sine term, its slot just repeats the constant system
             for ( int idx=0; idx<ns; idx++ ) {
-                ss.set(idx, 0.0);
-                bc.set(idx, 0.5);
-            }
-            sfdivn.doDiv(trc.arr(), bc.arr(), cc.arr());
-        } else {
-            for (int idx=0; idx<ns; idx++) {
-                float t = (z0 + zsampMargin_.start + idx) * refstep_;
-                bs.set(idx, sinf(w*t));
-                bc.set(idx, cosf(w*t));
+                bs[idx*nrhs] = 0.5;
+                bc[idx*nrhs] = 0.5;
             }
-            sfdivn.doDiv(trc.arr(),bs.arr(),ss.arr());
-            sfdivn.doDiv(trc.arr(),bc.arr(),cc.arr());
+            continue;
+        }
+        
+        const double dw = double(w) * refstep_;
+        const double cosdw = cos(dw);
+        const double sindw = sin(dw);
+        double s = sin(w*t0);
+        double c = cos(w*t0);
+        for (int idx=0; idx<ns; idx++) {
+            bs[idx*nrhs] = s;
+            bc[idx*nrhs] = c;
+            const double snext = s*cosdw + c*sindw;
+            c = c*cosdw - s*sindw;
+            s = snext;
         }
+    }
+    
+    sfdivn.doDiv(num, den, rat);
+    
+    for (int ifreq=0; ifreq<freqidxs.size(); ifreq++) {
+        const int idf = freqidxs[ifreq];
+        const bool zerofreq = step_ * (idf+1) == 0.f;
+        const float* ss = rat + 2*ifreq;
+        const float* cc = ss + 1;
         for (int idx=0; idx<nrsamples; idx++) {
-            float outVal = mUdf(float);
-            outVal = hypotf(ss[idx-off],cc[idx-off]);
+            const int sampidx = (idx-off)*nrhs;
+            const float outVal = zerofreq ? fabsf(cc[sampidx]) : hypotf(ss[sampidx],cc[sampidx]);
             setOutputValue( output, idf, idx, z0, outVal );
         }
     }
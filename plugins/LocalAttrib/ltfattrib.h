@@ -20,6 +20,7 @@
 
 #include "localattribmod.h"
 #include "attribprovider.h"
+#include "perthread.h"
 
 /*!\brief Local Time-Frequency Attribute
 
@@ -49,7 +50,7 @@ bool				prepPriorToOutputSetup();
 
 protected:
 
-							~LTFAttrib() {}
+							~LTFAttrib();
     static Provider*		createInstance(Desc&);
 	static void				updateDesc(Desc&);
     static void				updateDefaults(Desc&);
@@ -63,6 +64,8 @@ protected:
 
     bool					areAllOutputsEnabled() const;
     
+    struct Workspace;
+    
     Interval<float>		gate_;
     float				window_; // effective time window
     float				step_; // frequency spacing
@@ -75,6 +78,8 @@ protected:
 	const DataHolder*	indata_;
 	int					indataidx_;
     Interval<int>		zsampMargin_;
+    
+    wmThreads::PerThread<Workspace>	workspaces_;
 	
 };
 
@@ -19,11 +19,36 @@
 #include <cstddef>
 #include "rsflib.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define mRSFLibSSE2
+#endif
+
 #ifdef NO_BLAS
+/* The unit stride cases are the ones used by ConjGrad and get vector loops, the strided
+   loops are kept for the smoothing of the slower axes in Trianglen. */
 void cblas_saxpy(int n, float a, const float *x, int sx, float *y, int sy)
 {
     int i, ix, iy;
     
+    if (sx == 1 && sy == 1) {
+        i = 0;
+#ifdef mRSFLibSSE2
+        const __m128 va = _mm_set1_ps(a);
+        for (; i+8 <= n; i += 8) {
+            __m128 y0 = _mm_loadu_ps(y+i);
+            __m128 y1 = _mm_loadu_ps(y+i+4);
+            y0 = _mm_add_ps(y0, _mm_mul_ps(va, _mm_loadu_ps(x+i)));
+            y1 = _mm_add_ps(y1, _mm_mul_ps(va, _mm_loadu_ps(x+i+4)));
+            _mm_storeu_ps(y+i, y0);
+            _mm_storeu_ps(y+i+4, y1);
+        }
+#endif
+        for (; i < n; i++)
+            y[i] += a * x[i];
+        return;
+    }
+    
     for (i=0; i < n; i++) {
         ix = i*sx;
         iy = i*sy;
@@ -36,6 +61,23 @@ void cblas_sswap(int n, float *x, int sx, float* y, int sy)
     int i, ix, iy;
     float t;
     
+    if (sx == 1 && sy == 1) {
+        i = 0;
+#ifdef mRSFLibSSE2
+        for (; i+4 <= n; i += 4) {
+            const __m128 xv = _mm_loadu_ps(x+i);
+            _mm_storeu_ps(x+i, _mm_loadu_ps(y+i));
+            _mm_storeu_ps(y+i, xv);
+        }
+#endif
+        for (; i < n; i++) {
+            t = x[i];
+            x[i] = y[i];
+            y[i] = t;
+        }
+        return;
+    }
+    
     for (i=0; i < n; i++) {
         ix = i*sx;
         iy = i*sy;
@@ -52,6 +94,29 @@ double cblas_dsdot(int n, const float *x, int sx, const float *y, int sy)
     
     dot = 0.;
     
+    if (sx == 1 && sy == 1) {
+        i = 0;
+#ifdef mRSFLibSSE2
+        /* four double partial sums, the products are exact in double */
+        __m128d d0 = _mm_setzero_pd();
+        __m128d d1 = _mm_setzero_pd();
+        for (; i+4 <= n; i += 4) {
+            const __m128 xv = _mm_loadu_ps(x+i);
+            const __m128 yv = _mm_loadu_ps(y+i);
+            d0 = _mm_add_pd(d0, _mm_mul_pd(_mm_cvtps_pd(xv), _mm_cvtps_pd(yv)));
+            d1 = _mm_add_pd(d1, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(xv,xv)),
+                                           _mm_cvtps_pd(_mm_movehl_ps(yv,yv))));
+        }
+        double part[4];
+        _mm_storeu_pd(part, d0);
+        _mm_storeu_pd(part+2, d1);
+        dot = (part[0] + part[2]) + (part[1] + part[3]);
+#endif
+        for (; i < n; i++)
+            dot += (double) x[i] * y[i];
+        return dot;
+    }
+    
     for (i=0; i < n; i++) {
         ix = i*sx;
         iy = i*sy;
@@ -141,8 +206,77 @@ void fold2 (int o, int d, int nx, int nb, int np, float *x, const float* tmp)
     }    
 }
 
+/* smooth2 for a contiguous trace and a triangle (not box) filter, with unit stride loops
+   the compiler can vectorise. The backward integration writes the middle of the fold
+   straight into x, so tmp is only kept for the reflected ends. Each x value gets its terms
+   in the same order as in the separate passes. */
+static void smooth2contig(Triangle& tr, float* x)
+{
+    const int nx = tr.nx_;
+    const int nb = tr.nb_;
+    const int np = tr.np_;
+    const float wt = tr.wt_;
+    const float wt2 = 2.*tr.wt_;
+    float* tmp = tr.tmp_;
+    
+    /* triple, the first tap also clears tmp */
+    for (int i=0; i < nx; i++)
+        tmp[i] = -wt*x[i];
+    for (int i=nx; i < np; i++)
+        tmp[i] = 0.;
+    for (int i=0; i < nx; i++)
+        tmp[i+nb] += wt2*x[i];
+    for (int i=0; i < nx; i++)
+        tmp[i+2*nb] += -wt*x[i];
+    
+    /* integrate forward */
+    float t = 0.;
+    for (int i=0; i < np; i++) {
+        t += tmp[i];
+        tmp[i] = t;
+    }
+    
+    /* integrate backward, the middle goes to x */
+    t = 0.;
+    for (int i=np-1; i >= nb+nx; i--) {
+        t += tmp[i];
+        tmp[i] = t;
+    }
+    for (int i=nb+nx-1; i >= nb; i--) {
+        t += tmp[i];
+        x[i-nb] = t;
+    }
+    for (int i=nb-1; i >= 0; i--) {
+        t += tmp[i];
+        tmp[i] = t;
+    }
+    
+    /* reflections from the right side */
+    for (int j=nb+nx; j < np; j += nx) {
+        for (int i=0; i < nx && i < np-j; i++)
+            x[nx-1-i] += tmp[j+i];
+        j += nx;
+        for (int i=0; i < nx && i < np-j; i++)
+            x[i] += tmp[j+i];
+    }
+    
+    /* reflections from the left side */
+    for (int j=nb; j >= 0; j -= nx) {
+        for (int i=0; i < nx && i < j; i++)
+            x[i] += tmp[j-1-i];
+        j -= nx;
+        for (int i=0; i < nx && i < j; i++)
+            x[nx-1-i] += tmp[j-1-i];
+    }    
+}
+
 void smooth2(Triangle& tr, int o, int d, bool der, float* x)
 {
+    if (d == 1 && !tr.box_ && !der) {
+        smooth2contig(tr, x+o);
+        return;
+    }
+    
     triple2(o,d,tr.nx_,tr.nb_,x,tr.tmp_, tr.box_, tr.wt_);
     doubint2(tr.np_,tr.tmp_,(bool) (tr.box_ || der));
     fold2(o,d,tr.nx_,tr.nb_,tr.np_,x,tr.tmp_);
@@ -230,27 +364,170 @@ void Trianglen::doLop(bool adj, bool add, int nx, int ny, float* x, float* y)
     if (nx != ny || nx != nd_) 
         return;
         
-    adjnull (adj, add, nx, ny, x, y);
-    
+    /* without add the output is smoothed in place instead of going through tmp_ */
+    float* out = adj ? x : y;
+    const float* in = adj ? y : x;
+    float* work = add ? tmp_ : out;
     for (int i=0; i<nd_; i++) 
-        tmp_[i] = adj ? y[i] : x[i];
+        work[i] = in[i];
     
     for (int i=0; i<dim_; i++) {
         if (!tr_[i].isNull()) {
             for (int j=0; j<nd_/n_[i]; j++) {
                 int i0 = first_index(i, j, dim_, n_, s_);
-                smooth2(tr_[i], i0, s_[i], false, tmp_);
+                smooth2(tr_[i], i0, s_[i], false, work);
             }
         }
     }
     
-    if (adj) {
+    if (add) {
         for (int i=0; i<nd_; i++)
-            x[i] += tmp_[i];
-    } else {
-        for (int i=0; i<nd_; i++)
-            y[i] += tmp_[i];
-    }        
+            out[i] += tmp_[i];
+    }
+}
+
+BatchTriangle::BatchTriangle(int nbox, int ndat, int nrhs)
+    : tmp_(NULL)
+    , rowtmp_(new float[nrhs])
+    , work_(new float[ndat*nrhs])
+    , nb_(nbox)
+    , nx_(ndat)
+    , np_(ndat + 2*nbox)
+    , nrhs_(nrhs)
+{
+    wt_ = 1.0/(nbox*nbox);
+    if (nbox > 1)
+        tmp_ = new float[np_*nrhs_];
+}
+
+BatchTriangle::~BatchTriangle()
+{
+    delete[] tmp_;
+    delete[] rowtmp_;
+    delete[] work_;
+}
+
+/* Operations on the nrhs values of one sample of interleaved traces */
+static void rowscale(int m, float a, const float* src, float* dst)
+{
+    int k = 0;
+#ifdef mRSFLibSSE2
+    const __m128 va = _mm_set1_ps(a);
+    for (; k+4 <= m; k += 4)
+        _mm_storeu_ps(dst+k, _mm_mul_ps(va, _mm_loadu_ps(src+k)));
+#endif
+    for (; k < m; k++)
+        dst[k] = a*src[k];
+}
+
+static void rowaxpy(int m, float a, const float* src, float* dst)
+{
+    int k = 0;
+#ifdef mRSFLibSSE2
+    const __m128 va = _mm_set1_ps(a);
+    for (; k+4 <= m; k += 4)
+        _mm_storeu_ps(dst+k, _mm_add_ps(_mm_loadu_ps(dst+k),
+                                        _mm_mul_ps(va, _mm_loadu_ps(src+k))));
+#endif
+    for (; k < m; k++)
+        dst[k] += a*src[k];
+}
+
+static void rowadd(int m, const float* src, float* dst)
+{
+    int k = 0;
+#ifdef mRSFLibSSE2
+    for (; k+4 <= m; k += 4)
+        _mm_storeu_ps(dst+k, _mm_add_ps(_mm_loadu_ps(dst+k), _mm_loadu_ps(src+k)));
+#endif
+    for (; k < m; k++)
+        dst[k] += src[k];
+}
+
+/* One integration step: run += src, dst = run */
+static void rowscan(int m, float* run, const float* src, float* dst)
+{
+    int k = 0;
+#ifdef mRSFLibSSE2
+    for (; k+4 <= m; k += 4) {
+        const __m128 r = _mm_add_ps(_mm_loadu_ps(run+k), _mm_loadu_ps(src+k));
+        _mm_storeu_ps(run+k, r);
+        _mm_storeu_ps(dst+k, r);
+    }
+#endif
+    for (; k < m; k++) {
+        run[k] += src[k];
+        dst[k] = run[k];
+    }
+}
+
+void BatchTriangle::smooth(float* x)
+{
+    const int m = nrhs_;
+    
+    /* triple and integrate forward in one pass, adding the three taps in triple2 order */
+    const float wt = wt_;
+    const float wt2 = 2.*wt_;
+    for (int k=0; k < m; k++)
+        rowtmp_[k] = 0.;
+    for (int i=0; i < np_; i++) {
+        float* ti = tmp_ + i*m;
+        if (i < nx_)
+            rowscale(m, -wt, x + i*m, ti);
+        else {
+            for (int k=0; k < m; k++)
+                ti[k] = 0.;
+        }
+        if (i >= nb_ && i-nb_ < nx_)
+            rowaxpy(m, wt2, x + (i-nb_)*m, ti);
+        if (i >= 2*nb_ && i-2*nb_ < nx_)
+            rowaxpy(m, -wt, x + (i-2*nb_)*m, ti);
+        rowscan(m, rowtmp_, ti, ti);
+    }
+    
+    /* integrate backward, the middle of the fold goes straight to x */
+    for (int k=0; k < m; k++)
+        rowtmp_[k] = 0.;
+    for (int i=np_-1; i >= 0; i--) {
+        float* ti = tmp_ + i*m;
+        rowscan(m, rowtmp_, ti, i >= nb_ && i < nb_+nx_ ? x + (i-nb_)*m : ti);
+    }
+    
+    /* reflections, as fold2 with whole rows */
+    for (int j=nb_+nx_; j < np_; j += nx_) {
+        for (int i=0; i < nx_ && i < np_-j; i++)
+            rowadd(m, tmp_+(j+i)*m, x+(nx_-1-i)*m);
+        j += nx_;
+        for (int i=0; i < nx_ && i < np_-j; i++)
+            rowadd(m, tmp_+(j+i)*m, x+i*m);
+    }
+    for (int j=nb_; j >= 0; j -= nx_) {
+        for (int i=0; i < nx_ && i < j; i++)
+            rowadd(m, tmp_+(j-1-i)*m, x+i*m);
+        j -= nx_;
+        for (int i=0; i < nx_ && i < j; i++)
+            rowadd(m, tmp_+(j-1-i)*m, x+(nx_-1-i)*m);
+    }
+}
+
+void BatchTriangle::doLop(bool adj, bool add, int nx, int ny, float* x, float* y)
+{
+    const int nd = nx_*nrhs_;
+    if (nx != ny || nx != nd)
+        return;
+    
+    /* without add the output is smoothed in place */
+    float* out = adj ? x : y;
+    const float* in = adj ? y : x;
+    float* work = add ? work_ : out;
+    for (int i=0; i<nd; i++)
+        work[i] = in[i];
+    if (tmp_)
+        smooth(work);
+    if (add) {
+        for (int i=0; i<nd; i++)
+            out[i] += work_[i];
+    }
 }
 
 Weight::Weight(const float* w)
@@ -420,6 +697,174 @@ void ConjGrad::doCG(Lop* prec, Lop* oper, Lop* shape, float* p, float* x, const
     if (NULL != prec) delete[] d;
 }
 
+/* Per system dot products of interleaved vectors */
+static void batchdot(int n, int nrhs, const float* x, const float* y, double* dot)
+{
+    for (int k=0; k < nrhs; k++)
+        dot[k] = 0.0;
+    for (int i=0; i < n; i++) {
+        const float* xi = x + i*nrhs;
+        const float* yi = y + i*nrhs;
+        int k = 0;
+#ifdef mRSFLibSSE2
+        for (; k+4 <= nrhs; k += 4) {
+            const __m128 xv = _mm_loadu_ps(xi+k);
+            const __m128 yv = _mm_loadu_ps(yi+k);
+            const __m128d p0 = _mm_mul_pd(_mm_cvtps_pd(xv), _mm_cvtps_pd(yv));
+            const __m128d p1 = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(xv,xv)),
+                                          _mm_cvtps_pd(_mm_movehl_ps(yv,yv)));
+            _mm_storeu_pd(dot+k, _mm_add_pd(_mm_loadu_pd(dot+k), p0));
+            _mm_storeu_pd(dot+k+2, _mm_add_pd(_mm_loadu_pd(dot+k+2), p1));
+        }
+#endif
+        for (; k < nrhs; k++)
+            dot[k] += (double) xi[k] * yi[k];
+    }
+}
+
+/* y += alpha*x per system, alpha is zero for the converged ones */
+static void batchaxpy(int n, int nrhs, const float* alpha, const float* x, float* y)
+{
+    for (int i=0; i < n; i++) {
+        const float* xi = x + i*nrhs;
+        float* yi = y + i*nrhs;
+        int k = 0;
+#ifdef mRSFLibSSE2
+        for (; k+4 <= nrhs; k += 4)
+            _mm_storeu_ps(yi+k, _mm_add_ps(_mm_loadu_ps(yi+k),
+                                           _mm_mul_ps(_mm_loadu_ps(alpha+k), _mm_loadu_ps(xi+k))));
+#endif
+        for (; k < nrhs; k++)
+            yi[k] += alpha[k] * xi[k];
+    }
+}
+
+/* s = g + alpha*s per system, the saxpy and swap of the single system version */
+static void batchupdate(int n, int nrhs, const float* alpha, const float* g, float* s)
+{
+    for (int i=0; i < n; i++) {
+        const float* gi = g + i*nrhs;
+        float* si = s + i*nrhs;
+        int k = 0;
+#ifdef mRSFLibSSE2
+        for (; k+4 <= nrhs; k += 4)
+            _mm_storeu_ps(si+k, _mm_add_ps(_mm_loadu_ps(gi+k),
+                                           _mm_mul_ps(_mm_loadu_ps(alpha+k), _mm_loadu_ps(si+k))));
+#endif
+        for (; k < nrhs; k++)
+            si[k] = gi[k] + alpha[k] * si[k];
+    }
+}
+
+int ConjGrad::doCGBatch(int nrhs, Lop* oper, Lop* shape, float* p, float* x, const float* dat, int niter,
+                        bool* active, int maxleft)
+{
+    const int np = np_/nrhs;
+    const int nx = nx_/nrhs;
+    const int nr = nr_/nrhs;
+    
+    for (int i=0; i < nr_; i++)
+        r_[i] = - dat[i];
+    for (int i=0; i < np_; i++)
+        p[i] = 0.;
+    for (int i=0; i < nx_; i++)
+        x[i] = 0.;
+    
+    double* g0 = new double[nrhs];
+    double* gn = new double[nrhs];
+    double* gnp = new double[nrhs];
+    double* alpha = new double[nrhs];
+    double* dot = new double[nrhs];
+    float* step = new float[nrhs];
+    
+    batchdot(nr, nrhs, r_, r_, dot);
+    int nractive = 0;
+    for (int k=0; k < nrhs; k++) {
+        active[k] = dot[k] != 0.;
+        if (active[k])
+            nractive++;
+    }
+    
+    for (int iter=0; iter < niter && nractive > maxleft; iter++) {
+        for (int i=0; i < np_; i++) {
+            gp_[i] = eps_*p[i];
+        }
+        for (int i=0; i < nx_; i++) {
+            gx_[i] = -eps_*x[i];
+        }
+        
+        oper->doLop(true, true, nx_, nr_, gx_, r_);
+        shape->doLop(true, true, np_, nx_, gp_, gx_);
+        shape->doLop(false, false, np_, nx_, gp_, gx_);
+        oper->doLop(false, false, nx_, nr_, gx_, gr_);
+        
+        batchdot(np, nrhs, gp_, gp_, gn);
+        
+        if (iter==0) {
+            for (int k=0; k < nrhs; k++)
+                g0[k] = gn[k];
+            for (int i=0; i < np_; i++) {
+                sp_[i] = gp_[i];
+            }
+            for (int i=0; i < nx_; i++) {
+                sx_[i] = gx_[i];
+            }
+            for (int i=0; i < nr_; i++) {
+                sr_[i] = gr_[i];
+            }
+        } else {
+            for (int k=0; k < nrhs; k++) {
+                if (!active[k])
+                    continue;
+                alpha[k] = gn[k] / gnp[k];
+                const double dg = gn[k] / g0[k];
+                if (alpha[k] < tol_ || dg < tol_) {
+                    active[k] = false;
+                    nractive--;
+                }
+            }
+            if (nractive <= maxleft)
+                break;
+            
+            for (int k=0; k < nrhs; k++)
+                step[k] = active[k] ? alpha[k] : 0.;
+            batchupdate(np, nrhs, step, gp_, sp_);
+            batchupdate(nx, nrhs, step, gx_, sx_);
+            batchupdate(nr, nrhs, step, gr_, sr_);
+        }
+        
+        batchdot(nr, nrhs, sr_, sr_, alpha);
+        batchdot(np, nrhs, sp_, sp_, dot);
+        for (int k=0; k < nrhs; k++)
+            alpha[k] += eps_*dot[k];
+        batchdot(nx, nrhs, sx_, sx_, dot);
+        for (int k=0; k < nrhs; k++) {
+            const double beta = alpha[k] - eps_*dot[k];
+            step[k] = active[k] ? - gn[k] / beta : 0.;
+        }
+        
+        batchaxpy(np, nrhs, step, sp_, p);
+        batchaxpy(nx, nrhs, step, sx_, x);
+        batchaxpy(nr, nrhs, step, sr_, r_);
+        
+        for (int k=0; k < nrhs; k++)
+            gnp[k] = gn[k];
+    }
+    
+    delete[] g0;
+    delete[] gn;
+    delete[] gnp;
+    delete[] alpha;
+    delete[] dot;
+    delete[] step;
+    
+    if (nractive > 0 && nractive <= maxleft)
+        return nractive;
+    for (int k=0; k < nrhs; k++)
+        active[k] = false;
+    return 0;
+}
+
 Divn::Divn(int ndim, int nd, int* ndat, int* nbox, int niter)
     : niter_(niter)
     , n_(nd)
@@ -440,4 +885,55 @@ void Divn::doDiv(const float* num, const float* den, float* rat)
     conjgrad_.doCG(NULL, &w, &trianglen_, p_, rat, num, niter_);
 }
     
+DivnBatch::DivnBatch(int nd, int nbox, int nrhs, int niter)
+    : nd_(nd)
+    , nbox_(nbox)
+    , nrhs_(nrhs)
+    , niter_(niter)
+    , p_(new float[nd*nrhs])
+    , active_(new bool[nrhs])
+    , num1_(new float[nd])
+    , den1_(new float[nd])
+    , rat1_(new float[nd])
+    , triangle_(nbox, nd, nrhs)
+    , conjgrad_(nd*nrhs, nd*nrhs, nd*nrhs, nd*nrhs, 1., 1.e-6, false)
+    , divn1_(1, nd, &nd_, &nbox_, niter)
+{
+}
+
+DivnBatch::~DivnBatch()
+{
+    delete[] p_;
+    delete[] active_;
+    delete[] num1_;
+    delete[] den1_;
+    delete[] rat1_;
+}
+
+bool DivnBatch::isSame(int nd, int nbox, int nrhs, int niter) const
+{
+    return nd==nd_ && nbox==nbox_ && nrhs==nrhs_ && niter==niter_;
+}
+
+void DivnBatch::doDiv(const float* num, const float* den, float* rat)
+{
+    Weight w(den);
+    const int nrleft = conjgrad_.doCGBatch(nrhs_, &w, &triangle_, p_, rat, num, niter_,
+                                           active_, nrhs_/4);
+    if (nrleft == 0)
+        return;
+    
+    for (int k=0; k < nrhs_; k++) {
+        if (!active_[k])
+            continue;
+        for (int i=0; i < nd_; i++) {
+            num1_[i] = num[i*nrhs_+k];
+            den1_[i] = den[i*nrhs_+k];
+        }
+        divn1_.doDiv(num1_, den1_, rat1_);
+        for (int i=0; i < nd_; i++)
+            rat[i*nrhs_+k] = rat1_[i];
+    }
+}
+    
 }; //namespace sf
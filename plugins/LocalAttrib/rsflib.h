@@ -79,6 +79,32 @@ protected:
     int*        s_;
 };
 
+/*
+ * Triangle smoothing along the samples of nrhs traces stored interleaved, sample index
+ * slowest, equivalent to a 1D Trianglen applied to each trace. Every smoothing step works on
+ * a whole row of nrhs values.
+ */
+class BatchTriangle : public Lop
+{
+public:
+    BatchTriangle(int nbox, int ndat, int nrhs);
+    ~BatchTriangle();
+    
+    void doLop(bool adj, bool add, int nx, int ny, float* x, float* y);
+    
+protected:
+    void smooth(float* x);
+    
+    float*  tmp_;
+    float*  rowtmp_;
+    float*  work_;
+    float   wt_;
+    int     nb_;
+    int     nx_;
+    int     np_;
+    int     nrhs_;
+};
+
 class Weight : public Lop
 {
 public:
@@ -109,6 +135,21 @@ public:
               float* x          /* estimated model */, 
               const float* dat        /* data */, 
               int niter         /* number of iterations */);
+    
+    /* Solve nrhs independent systems stored interleaved, sample index slowest, without
+       data preconditioning or initial model. Each system has its own step lengths and
+       stopping test but the operators are applied to all of them together. Iteration
+       stops early once no more than maxleft systems are unconverged, these are flagged
+       in active and the number of them is returned. */
+    int doCGBatch(int nrhs    /* number of right hand sides */,
+              Lop* oper  /* linear operator */, 
+              Lop* shape /* shaping operator */, 
+              float* p          /* preconditioned model */, 
+              float* x          /* estimated model */, 
+              const float* dat        /* data */, 
+              int niter         /* number of iterations */,
+              bool* active      /* unconverged systems */,
+              int maxleft=0     /* systems left for the caller */);
 protected:
     int np_;
     int nx_;
@@ -143,6 +184,35 @@ protected:
     
 };
 
+/*
+ * Smooth division of nrhs interleaved 1D systems of the same length and smoothing radius.
+ * The few systems converging much slower than the rest are finished one at a time with a
+ * Divn so they do not keep the whole batch iterating.
+ */
+class DivnBatch
+{
+public:
+        DivnBatch(int nd, int nbox, int nrhs, int niter);
+        ~DivnBatch();
+        
+        bool isSame(int nd, int nbox, int nrhs, int niter) const;
+        void doDiv(const float* num, const float* den, float* rat);
+            
+protected:
+    int             nd_;
+    int             nbox_;
+    int             nrhs_;
+    int             niter_;
+    float*          p_;
+    bool*           active_;
+    float*          num1_;
+    float*          den1_;
+    float*          rat1_;
+    BatchTriangle   triangle_;
+    ConjGrad        conjgrad_;
+    Divn            divn1_;
+};
+
 }; //namespace sf
 
 #endif
@@ -0,0 +1,134 @@
+/*
+ *   LocalAttrib Plugin
+ *   Copyright (C) 2026  Wayne Mogg
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmark for the rsflib smooth division used by LTFAttrib.
+ *
+ * Standalone, not linked to OpendTect. Times sf::Divn::doDiv for typical trace
+ * lengths and smoothing radii, and one sf::DivnBatch::doDiv against the same divisions
+ * done one at a time, as LTFAttrib runs them for nrfreq frequencies. Only built when the
+ * WM_BUILD_BENCHMARKS option is on:
+ *
+ *   cmake -DWM_BUILD_BENCHMARKS=ON ...
+ *   cmake --build . --target rsflib_bench
+ *   ./rsflib_bench [niter] [nrfreq]
+ */
+
+#include "rsflib.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+template <class Fn>
+double timePerCall( int nrcalls, Fn fn )
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int idx=0; idx<nrcalls; idx++)
+        fn();
+    const std::chrono::duration<double,std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / nrcalls;
+}
+
+// Sine basis as LTFAttrib builds it, dt in seconds and freq in Hz
+void makeBasis( int ns, float freq, float dt, bool cosine, float* basis, int stride )
+{
+    const double w = 2.0 * M_PI * freq;
+    for (int idx=0; idx<ns; idx++) {
+        const double t = (100+idx) * dt;
+        basis[idx*stride] = cosine ? cos(w*t) : sin(w*t);
+    }
+}
+
+int main( int argc, char** argv )
+{
+    const int niter = argc>1 ? atoi(argv[1]) : 100;
+    const int nrfreq = argc>2 ? atoi(argv[2]) : 16;
+    const float dt = 0.004f;
+
+    std::mt19937 gen(42);
+    std::normal_distribution<float> dist;
+
+    const int lengths[] = { 100, 250, 500, 1000, 2000 };
+    const int radii[] = { 5, 10, 25 };
+    printf("niter %d, times in us per call\n", niter);
+    printf("%6s %6s %10s\n", "ns", "smooth", "Divn");
+    for (int ns : lengths) {
+        std::vector<float> num(ns), den(ns), rat(ns);
+        for (int idx=0; idx<ns; idx++)
+            num[idx] = dist(gen);
+        makeBasis(ns, 30.f, dt, false, den.data(), 1);
+        for (int smooth : radii) {
+            if (2*smooth > ns)
+                continue;
+            sf::Divn divn(1, ns, &ns, &smooth, niter);
+            const int nrcalls = std::max(20, 400000/ns);
+            const double tdivn = timePerCall(nrcalls, [&]()
+                                   { divn.doDiv(num.data(), den.data(), rat.data()); });
+            printf("%6d %6d %10.2f\n", ns, smooth, tdivn);
+        }
+    }
+
+    const int nrhs = 2*nrfreq;
+    const float fstep = 0.5f / dt / (nrfreq+1);
+    printf("\n%d frequencies, %d divisions per trace, times in us per trace\n", nrfreq, nrhs);
+    printf("%6s %6s %10s %10s %8s %10s\n", "ns", "smooth", "Divn", "DivnBatch", "speedup", "maxdiff");
+    for (int ns : lengths) {
+        int smooth = 10;
+        std::vector<float> trc(ns), den(ns*nrhs), num(ns*nrhs), rat(ns*nrhs), rat1(ns);
+        for (int idx=0; idx<ns; idx++)
+            trc[idx] = dist(gen);
+        for (int ifreq=0; ifreq<nrfreq; ifreq++) {
+            makeBasis(ns, fstep*(ifreq+1), dt, false, den.data()+2*ifreq, nrhs);
+            makeBasis(ns, fstep*(ifreq+1), dt, true, den.data()+2*ifreq+1, nrhs);
+        }
+        for (int idx=0; idx<ns; idx++)
+            std::fill(num.begin()+idx*nrhs, num.begin()+(idx+1)*nrhs, trc[idx]);
+
+        sf::Divn divn(1, ns, &ns, &smooth, niter);
+        sf::DivnBatch divnbatch(ns, smooth, nrhs, niter);
+        std::vector<float> den1(ns);
+        float maxdiff = 0.f;
+        divnbatch.doDiv(num.data(), den.data(), rat.data());
+        for (int irhs=0; irhs<nrhs; irhs++) {
+            for (int idx=0; idx<ns; idx++)
+                den1[idx] = den[idx*nrhs+irhs];
+            divn.doDiv(trc.data(), den1.data(), rat1.data());
+            for (int idx=0; idx<ns; idx++)
+                maxdiff = std::max(maxdiff, std::abs(rat1[idx]-rat[idx*nrhs+irhs]));
+        }
+
+        const int nrcalls = std::max(5, 20000/ns);
+        const double tsingle = timePerCall(nrcalls, [&]() {
+            for (int irhs=0; irhs<nrhs; irhs++) {
+                for (int idx=0; idx<ns; idx++)
+                    den1[idx] = den[idx*nrhs+irhs];
+                divn.doDiv(trc.data(), den1.data(), rat1.data());
+            }
+        });
+        const double tbatch = timePerCall(nrcalls, [&]()
+                                { divnbatch.doDiv(num.data(), den.data(), rat.data()); });
+        printf("%6d %6d %10.1f %10.1f %7.2fx %10.2g\n", ns, smooth, tsingle, tbatch,
+               tsingle/tbatch, maxdiff);
+    }
+    return 0;
+}
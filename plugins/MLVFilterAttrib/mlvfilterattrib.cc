@@ -27,6 +27,8 @@ ________________________________________________________________________
 #include "attribfactory.h"
 #include "attribparam.h"
 #include "attribsteering.h"
+#include "tracegather.h"
+#include <algorithm>
 #include <math.h>
 
 namespace Attrib
@@ -142,6 +144,23 @@ bool MLVFilter::getElements()
 		}
 		elements_ += pset;
 	}
+
+	// Points of each element that enter and leave its window when it moves one sample down
+	enterpts_.erase();
+	leavepts_.erase();
+	for ( int ielem=0; ielem<nrelem; ielem++ ) {
+		const SamplePointSet& pset = elements_[ielem];
+		SamplePointSet enter, leave;
+		for ( int ipnt=0; ipnt<pset.size(); ipnt++ ) {
+			const SamplePoint& samp = pset[ipnt];
+			if ( !pset.isPresent(SamplePoint(samp.x, samp.y+1)) )
+				enter += samp;
+			if ( !pset.isPresent(SamplePoint(samp.x, samp.y-1)) )
+				leave += samp;
+		}
+		enterpts_ += enter;
+		leavepts_ += leave;
+	}
 	return true;
 }
 
@@ -169,40 +188,41 @@ bool MLVFilter::getInputData( const BinID& relpos, int zintv )
 	return true;
 }
 
-int MLVFilter::findLeastVarianceElement( int idx, int z0, float* result,  wmStats::StatCalc<float>& elemStats) const
+float MLVFilter::elementValue( int elem, const float* block, int blocklen, int idx,
+							   double mean, double var, TypeSet<float>& vals ) const
 {
-	int minelem = 0;
-	float minvar = -1;
-	for (int elem=0; elem<elements_.size(); elem++) {
-		SamplePointSet points = elements_[elem];
-		const int np = points.size();
-		elemStats.clear();
-		for ( int ipnt=0; ipnt < np; ipnt++ ) {
-			int trcidx = points[ipnt].x;
-			const DataHolder* data = inputdata_[trcidx];
-			const int zidx = points[ipnt].y;
-			float traceval = mUdf(float);
-			if ( data )
-				traceval = getInputValue( *data, dataidx_, idx + zidx, z0);
-			elemStats.addValue(traceval);
-		}
-		if (np) {
-			float variance = float(elemStats.variance());
-			if ( variance<minvar || minvar<0) {
-				minvar = variance;
-				minelem = elem;
-				if ( outtype_ == Average ) {
-					*result = float(elemStats.average());
-				} else if (outtype_ == Median ) {
-					*result = float(elemStats.median());
-				} else if (outtype_ == TrimmedMean ) {
-                    *result = float(elemStats.trimmedMean(sdevs_));
-                }
-			}
-			if (mIsZero(variance,mDefEpsF)) break;
+	const SamplePointSet& points = elements_[elem];
+	vals.erase();
+	for ( int ipnt=0; ipnt<points.size(); ipnt++ ) {
+		const float val = block[points[ipnt].x*blocklen + points[ipnt].y - dessampgate_.start + idx];
+		if ( !mIsUdf(val) )
+			vals += val;
+	}
+	const int sz = vals.size();
+	if ( sz < 2 )
+		return sz < 1 ? mUdf(float) : vals[0];
+
+	if ( outtype_ == Median ) {
+		std::vector<float>& vec = vals.vec();
+		const int mididx = sz / 2;
+		std::nth_element( vec.begin(), vec.begin()+mididx, vec.end() );
+		if ( sz%2 )
+			return vec[mididx];
+		return (vec[mididx] + *std::max_element(vec.begin(), vec.begin()+mididx)) / 2;
+	}
+
+	const double stdev = Math::Sqrt( var );
+	const double vmin = mean - sdevs_ * stdev;
+	const double vmax = mean + sdevs_ * stdev;
+	double sum = 0.0;
+	int count = 0;
+	for ( int ipnt=0; ipnt<sz; ipnt++ ) {
+		if ( vals[ipnt]>=vmin && vals[ipnt]<=vmax ) {
+			sum += vals[ipnt];
+			count++;
 		}
 	}
-	return minelem;
+	return count ? float(sum/count) : mUdf(float);
 }
 
 bool MLVFilter::computeData( const DataHolder& output, const BinID& relpos,
@@ -211,17 +231,103 @@ bool MLVFilter::computeData( const DataHolder& output, const BinID& relpos,
 
 	if ( inputdata_.isEmpty() ) return false;
 
-	wmStats::StatCalc<float> elemStats;
-	float value=0;
-	int elem=0;
+	// Gather the neighbourhood once as a contiguous (trace x z) block, padded by the sample gate
+	const int nrtrcs = trcpos_.size();
+	const int gatesz = dessampgate_.width() + 1;
+	const int blocklen = nrsamples + gatesz - 1;
+	TypeSet<float> block( nrtrcs*blocklen, mUdf(float) );
+	auto getval = [&]( const DataHolder& dh, int sampidx )
+			{ return getInputValue( dh, dataidx_, sampidx, z0 ); };
+	for ( int trcidx=0; trcidx<nrtrcs; trcidx++ )
+		wmGather::gatherTrace( inputdata_[trcidx], dataidx_, z0, dessampgate_.start, blocklen,
+				       block.arr() + trcidx*blocklen, getval, mUdf(float) );
+
+	// Flat block offsets of the element points and of the points entering and leaving each
+	// element window as it slides down the trace
+	const int nrelem = elements_.size();
+	TypeSet<int> offsets, enteroffs, leaveoffs;
+	TypeSet<int> offsidx( nrelem+1, 0 ), enteridx( nrelem+1, 0 ), leaveidx( nrelem+1, 0 );
+	for ( int elem=0; elem<nrelem; elem++ ) {
+		const SamplePointSet& points = elements_[elem];
+		for ( int ipnt=0; ipnt<points.size(); ipnt++ )
+			offsets += points[ipnt].x*blocklen + points[ipnt].y - dessampgate_.start;
+		const SamplePointSet& enter = enterpts_[elem];
+		for ( int ipnt=0; ipnt<enter.size(); ipnt++ )
+			enteroffs += enter[ipnt].x*blocklen + enter[ipnt].y - dessampgate_.start;
+		const SamplePointSet& leave = leavepts_[elem];
+		for ( int ipnt=0; ipnt<leave.size(); ipnt++ )
+			leaveoffs += leave[ipnt].x*blocklen + leave[ipnt].y - dessampgate_.start;
+		offsidx[elem+1] = offsets.size();
+		enteridx[elem+1] = enteroffs.size();
+		leaveidx[elem+1] = leaveoffs.size();
+	}
+
+	TypeSet<double> sums( nrelem, 0.0 ), sumsqs( nrelem, 0.0 );
+	TypeSet<int> counts( nrelem, 0 );
+	TypeSet<float> vals;
+	const float* blk = block.arr();
 	for ( int idx=0; idx<nrsamples; idx++ )
 	{
-		elem = findLeastVarianceElement( idx, z0, &value, elemStats );
-		if ( outtype_ == Element ) {
-			setOutputValue( output, 0, idx, z0, (float) elem );
-		} else {
-			setOutputValue( output, 0, idx, z0, value );
+		int minelem = 0;
+		double minvar = -1.0;
+		double minmean = mUdf(double);
+		bool foundflat = false;
+		for ( int elem=0; elem<nrelem; elem++ ) {
+			if ( offsidx[elem]==offsidx[elem+1] )
+				continue;
+
+			if ( idx==0 ) {
+				for ( int ipnt=offsidx[elem]; ipnt<offsidx[elem+1]; ipnt++ ) {
+					const float val = blk[offsets[ipnt]];
+					if ( mIsUdf(val) ) continue;
+					sums[elem] += val;
+					sumsqs[elem] += double(val)*val;
+					counts[elem]++;
+				}
+			} else {
+				for ( int ipnt=leaveidx[elem]; ipnt<leaveidx[elem+1]; ipnt++ ) {
+					const float val = blk[leaveoffs[ipnt]+idx-1];
+					if ( mIsUdf(val) ) continue;
+					sums[elem] -= val;
+					sumsqs[elem] -= double(val)*val;
+					counts[elem]--;
+				}
+				for ( int ipnt=enteridx[elem]; ipnt<enteridx[elem+1]; ipnt++ ) {
+					const float val = blk[enteroffs[ipnt]+idx];
+					if ( mIsUdf(val) ) continue;
+					sums[elem] += val;
+					sumsqs[elem] += double(val)*val;
+					counts[elem]++;
+				}
+			}
+
+			const int cnt = counts[elem];
+			const double mean = cnt ? sums[elem]/cnt : mUdf(double);
+			double variance = 0.0;
+			if ( cnt > 1 ) {
+				variance = (sumsqs[elem] - sums[elem]*mean) / (cnt-1);
+				if ( variance < 0.0 )
+					variance = 0.0;
+			}
+			if ( foundflat )
+				continue;
+			if ( variance<minvar || minvar<0 ) {
+				minvar = variance;
+				minelem = elem;
+				minmean = mean;
+			}
+			if ( mIsZero(variance,mDefEpsF) )
+				foundflat = true;
 		}
+
+		float value = mUdf(float);
+		if ( outtype_ == Element )
+			value = (float) minelem;
+		else if ( outtype_ == Average )
+			value = mIsUdf(minmean) ? mUdf(float) : float(minmean);
+		else if ( minvar >= 0.0 )
+			value = elementValue( minelem, blk, blocklen, idx, minmean, minvar, vals );
+		setOutputValue( output, 0, idx, z0, value );
 	}
 	return true;
 }
@@ -64,7 +64,8 @@ protected:
 	bool					getInputData(const BinID&,int zintv);
 	bool					computeData(const DataHolder&, const BinID& relpos, int z0, int nrsamples, int threadid) const;
 
-	int						findLeastVarianceElement( int idx, int z0, float* result , wmStats::StatCalc<float>& elemStats ) const;
+	float					elementValue( int elem, const float* block, int blocklen, int idx,
+										  double mean, double var, TypeSet<float>& vals ) const;
 	const BinID*			desStepout(int input,int output) const;
 	const Interval<int>*	desZSampMargin(int input,int output) const
 							{ return &dessampgate_; }
@@ -76,6 +77,8 @@ protected:
 	Interval<int>			dessampgate_;
 	TypeSet<BinID>			trcpos_;
 	TypeSet<SamplePointSet>	elements_;
+	TypeSet<SamplePointSet>	enterpts_;
+	TypeSet<SamplePointSet>	leavepts_;
 	int						centertrcidx_;
 	int						outtype_;
 	int						size_;
@@ -14,11 +14,21 @@
 #include "survgeom2d.h"
 #include "fourier.h"
 #include "odcomplex.h"
-#include "valseriesinterpol.h"
-#include "hilberttransform.h"
+#include "tracegather.h"
+
+#include <vector>
 
 namespace Attrib {
 
+// Half length of the phase rotation filter, as used by the HilbertTransform before
+static const int cHilbertHalfLen = 30;
+
+struct MistieApplier::Workspace
+{
+    std::vector<float>  trc_;
+    std::vector<int>    nrudf_;
+};
+
 mAttrDefCreateInstance(MistieApplier)
 
 void MistieApplier::initClass()
@@ -50,6 +60,9 @@ void MistieApplier::initClass()
 
 MistieApplier::MistieApplier( Desc& desc )
 : Provider( desc )
+, shift_(0.0f)
+, phase_(0.0f)
+, amp_(1.0f)
 {
     if ( !isOK() ) return;
     
@@ -58,13 +71,18 @@ MistieApplier::MistieApplier( Desc& desc )
     mGetBool( applyphase_, phaseStr() );
     mGetBool( applyamp_, ampStr() );
     
-    zmargin_ = Interval<int>( -30, 30 );
+    // the cubic shift interpolator reaches one sample before and two after
+    zmargin_ = Interval<int>( -cHilbertHalfLen-1, cHilbertHalfLen+2 );
     
     if (!corrections_.read( mistiefile_ )) {
         ErrMsg("MistieApplier::MistieApplier - error reading mistie correction file");
     }
+    makeCorrectionFilter();
 }
 
+MistieApplier::~MistieApplier()
+{}
+
 bool MistieApplier::getInputData( const BinID& relpos, int zintv )
 {
     data_ = inputs_[0]->getData( relpos, zintv );
@@ -92,6 +110,70 @@ void MistieApplier::prepareForComputeData()
         tmp += dname;
         ErrMsg(tmp);
     }
+    makeCorrectionFilter();
+}
+
+/*
+ The line's corrections are constant so they are combined into one filter, applied to the
+ input as out[idx] = sum filter_[jdx]*in[idx+filterstart_+jdx]:
+ - the shift as a whole sample offset and a cubic Lagrange interpolator for the fraction,
+   the same 4 point polynomial ValueSeriesInterpolator uses
+ - the phase rotation as cos(phase)*delta - sin(phase)*Hilbert, with the Hamming tapered
+   Hilbert filter of HilbertTransform
+ - the amplitude as a scale factor
+ Output samples stay undefined where any of the interpolator inputs, at
+ interpstart_ .. interpstart_+nrinterp_-1 into the filter, is undefined.
+*/
+void MistieApplier::makeCorrectionFilter()
+{
+    int ishift = 0;
+    TypeSet<float> interp( 1, 1.0f );
+    int interpoffs = 0;
+    if ( applyshift_ && !mIsZero(shift_,mDefEps) ) {
+        const double shift = -shift_/(refstep_* SI().zDomain().userFactor());
+        ishift = mNINT32( shift );
+        const double frac = shift - ishift;
+        if ( !mIsZero(frac,1e-4) ) {
+            ishift = (int) Math::Floor( shift );
+            const double x = shift - ishift;
+            interp.setSize( 4 );
+            interp[0] = float( -x*(x-1.0)*(x-2.0)/6.0 );
+            interp[1] = float( (x+1.0)*(x-1.0)*(x-2.0)/2.0 );
+            interp[2] = float( -(x+1.0)*x*(x-2.0)/2.0 );
+            interp[3] = float( (x+1.0)*x*(x-1.0)/6.0 );
+            interpoffs = -1;
+        }
+    }
+
+    int halflen = 0;
+    TypeSet<float> rotation( 1, 1.0f );
+    if ( applyphase_ && mIsEqual(phase_, 180.0, mDefEps) )
+        rotation[0] = -1.0f;
+    else if ( applyphase_ && !mIsZero(phase_, mDefEps) ) {
+        halflen = cHilbertHalfLen;
+        rotation.setSize( 2*halflen+1, 0.0f );
+        const double rfact = cos( Math::toRadians(phase_) );
+        const double ifact = sin( Math::toRadians(phase_) );
+        rotation[halflen] = float( rfact );
+        for ( int idx=1; idx<=halflen; idx+=2 ) {
+            const double taper = 0.54 + 0.46*cos( M_PI*idx/halflen );
+            const double hilb = taper * 2.0/(M_PI*idx);
+            // hilbert(x)[i] = sum hilb(j)*x[i-j], with hilb odd
+            rotation[halflen+idx] = float( ifact*hilb );
+            rotation[halflen-idx] = float( -ifact*hilb );
+        }
+    }
+
+    const float amp = applyamp_ && !mIsEqual(amp_, 1.0, mDefEps) ? amp_ : 1.0f;
+    const int nrinterp = interp.size();
+    filter_.setSize( rotation.size()+nrinterp-1, 0.0f );
+    for ( int irot=0; irot<rotation.size(); irot++ ) {
+        for ( int iint=0; iint<nrinterp; iint++ )
+            filter_[irot+iint] += amp * rotation[irot] * interp[iint];
+    }
+    filterstart_ = ishift + interpoffs - halflen;
+    interpstart_ = halflen;
+    nrinterp_ = nrinterp;
 }
 
 bool MistieApplier::computeData( const DataHolder& output, const BinID& relpos, int z0, int nrsamples, int threadid) const
@@ -99,56 +181,40 @@ bool MistieApplier::computeData( const DataHolder& output, const BinID& relpos,
     if ( !data_ )
         return false;
     
-    const int sz = zmargin_.width() + nrsamples;
-    
-    Array1DImpl<float> data(sz);
-    if (applyshift_ && !mIsZero(shift_,mDefEps)) {
-        ValueSeries<float>* dataseries = data_->series(dataidx_);
-        ValueSeriesInterpolator<float> interp( data_->nrsamples_-1 );
-        int offs = z0 - data_->z0_;
-        float shift = shift_/(refstep_* SI().zDomain().userFactor());
-        for (int idx=0; idx<sz; idx++) {
-            float pos = zmargin_.start + idx + offs - shift;
-            data.set(idx, interp.value( *dataseries, pos ));
-        }
-    } else {
-        for (int idx=0; idx<sz; idx++)
-            data.set(idx, getInputValue( *data_, dataidx_, zmargin_.start+idx, z0 ));
+    const int nrtaps = filter_.size();
+    const int sz = nrsamples + nrtaps - 1;
+    Workspace& ws = workspaces_.get( threadid );
+    ws.trc_.resize( sz );
+    ws.nrudf_.resize( sz+1 );
+    
+    auto getval = [&]( const DataHolder& dh, int sampidx )
+                  { return getInputValue( dh, dataidx_, sampidx, z0 ); };
+    wmGather::gatherTrace( data_, dataidx_, z0, filterstart_, sz, ws.trc_.data(), getval,
+                           mUdf(float) );
+    
+    // Undefined samples count as zero in the filter, nrudf_ tells where they are
+    float* trc = ws.trc_.data();
+    int* nrudf = ws.nrudf_.data();
+    nrudf[0] = 0;
+    for (int idx=0; idx<sz; idx++) {
+        const bool udf = mIsUdf(trc[idx]);
+        nrudf[idx+1] = nrudf[idx] + (udf ? 1 : 0);
+        if (udf)
+            trc[idx] = 0.0f;
     }
     
-    if (applyphase_ && mIsEqual(phase_, 180.0, mDefEps)) {
-        for (int idx=0; idx<sz; idx++) {
-            float val = data.get(idx);
-            data.set(idx, mIsUdf(val) ? val : -val);
-        }
-    } else if (applyphase_ && !mIsZero(phase_, mDefEps)) {
-        HilbertTransform ht;
-        ht.setInputInfo(Array1DInfoImpl(sz));
-        ht.setHalfLen( zmargin_.width()/2 );
-        ht.setCalcRange(0,0);
-        ht.setDir(true);
-        if (!ht.init())
-            return false;
-        Array1DImpl<float> idata(sz);
-        ht.transform( data, idata );
-        float rfact = cos(Math::toRadians(phase_));
-        float ifact = sin(Math::toRadians(phase_));
-        for (int idx=0; idx<sz; idx++) {
-            float val = data.get(idx);
-            float ival = idata.get(idx);
-            data.set(idx, mIsUdf(val)||mIsUdf(ival) ? mUdf(float) : val*rfact-ival*ifact);
-        }
-    } 
-    
-    if (applyamp_ && !mIsEqual(amp_, 1.0, mDefEps)) {
-        for (int idx=0; idx<sz; idx++) {
-            float val = data.get(idx);
-            data.set(idx, mIsUdf(val) ? val : val*amp_);
+    const float* filter = filter_.arr();
+    for (int idx=0; idx<nrsamples; idx++) {
+        const int interpidx = idx + interpstart_;
+        float outval = mUdf(float);
+        if (nrudf[interpidx+nrinterp_] == nrudf[interpidx]) {
+            const float* in = trc + idx;
+            outval = 0.0f;
+            for (int jdx=0; jdx<nrtaps; jdx++)
+                outval += filter[jdx] * in[jdx];
         }
+        setOutputValue( output, 0, idx, z0, outval );
     }
-    
-    for (int idx=0; idx<nrsamples; idx++)
-        setOutputValue( output, 0, idx, z0, data.get(idx-zmargin_.start) );
 
     return true;
 }
@@ -4,6 +4,7 @@
 #include "mistiemod.h"
 #include "attribprovider.h"
 #include "arrayndimpl.h"
+#include "perthread.h"
 
 #include "mistiecordata.h"
 
@@ -22,7 +23,7 @@ public:
     static const char*  mistieFileStr() { return "mistie_database"; }
     
 protected:
-                        ~MistieApplier() {}
+                        ~MistieApplier();
     static Provider*    createInstance(Desc&);
                     
     bool                allowParallelComputation() const { return true; }
@@ -32,6 +33,9 @@ protected:
     bool                computeData(const DataHolder&,const BinID& relpos, int z0,int nrsamples,int threadid) const;
     const Interval<int>* desZSampMargin(int input,int output) const { return &zmargin_; }
     
+    void                makeCorrectionFilter();
+    struct Workspace;
+    
     
     BufferString        mistiefile_;
     MistieCorrectionData corrections_;
@@ -46,6 +50,14 @@ protected:
     float               shift_;
     float               phase_;
     float               amp_;
+    
+    // Combined shift, phase and amplitude correction for the current line
+    TypeSet<float>      filter_;
+    int                 filterstart_;
+    int                 interpstart_;
+    int                 nrinterp_;
+    
+    wmThreads::PerThread<Workspace> workspaces_;
 };
 
 };
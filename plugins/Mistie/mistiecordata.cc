@@ -6,6 +6,12 @@
 #include "mistiedata.h"
 #include "phaseangle.h"
 
+#include "Eigen/Sparse"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 MistieCorrectionData::MistieCorrectionData()
 {}
 
@@ -191,237 +197,271 @@ void MistieCorrectionData::set( const char* name, float shift, float phase, floa
     }
 }
 
+namespace {
+
+// Misties above the quality cut as an integer indexed graph of ties between correction entries
+struct MistieTies
+{
+    TypeSet<int>	mistieidx_;
+    TypeSet<int>	idxA_;
+    TypeSet<int>	idxB_;
+    TypeSet<float>	wts_;
+
+    int			size() const	{ return mistieidx_.size(); }
+};
+
+}
+
+static void getTies( const MistieCorrectionData& cors, const MistieData& misties, float minQuality,
+		     MistieTies& ties )
+{
+    std::unordered_map<std::string,int> lineidx;
+    auto getIdx = [&]( const BufferString& nm )
+    {
+	auto it = lineidx.find( nm.buf() );
+	if ( it != lineidx.end() )
+	    return it->second;
+	const int idx = cors.getIndex( nm );
+	lineidx[nm.buf()] = idx;
+	return idx;
+    };
+
+    BufferString lineA, lineB;
+    for (int idx=0; idx<misties.size(); idx++) {
+	const float quality = misties.getQuality(idx);
+	if (quality<minQuality)
+	    continue;
+	misties.getLines(idx, lineA, lineB);
+	const int ilA = getIdx(lineA);
+	const int ilB = getIdx(lineB);
+	if (ilA<0 || ilB<0)
+	    continue;
+	ties.mistieidx_ += idx;
+	ties.idxA_ += ilA;
+	ties.idxB_ += ilB;
+	ties.wts_ += mMAX(quality, 1e-3f);
+    }
+}
+
+/*
+  Weighted least squares solution of obs = cor[idxA] - cor[idxB] over all ties, with the
+  corrections of fixed entries held at zero, by conjugate gradients on the normal equations. A small ridge term gives the minimum norm
+  solution for groups of lines that are not tied to a fixed line.
+*/
+static bool solveTies( const MistieTies& ties, const TypeSet<float>& obs, const BoolTypeSet& fixed,
+		       TypeSet<float>& sol )
+{
+    const int nrlines = fixed.size();
+    sol.setSize( nrlines, 0.f );
+    sol.setAll( 0.f );
+    TypeSet<int> solidx( nrlines, -1 );
+    int nrfree = 0;
+    for (int idx=0; idx<nrlines; idx++) {
+	if (!fixed[idx])
+	    solidx[idx] = nrfree++;
+    }
+    if (!nrfree)
+	return true;
+
+    std::vector<Eigen::Triplet<double>> trips;
+    trips.reserve( 4*ties.size() + nrfree );
+    Eigen::VectorXd rhs = Eigen::VectorXd::Zero( nrfree );
+    Eigen::VectorXd diag = Eigen::VectorXd::Zero( nrfree );
+    for (int idx=0; idx<ties.size(); idx++) {
+	const int iA = solidx[ties.idxA_[idx]];
+	const int iB = solidx[ties.idxB_[idx]];
+	if (ties.idxA_[idx]==ties.idxB_[idx] || mIsUdf(obs[idx]))
+	    continue;
+	const double wt = ties.wts_[idx];
+	const double wm = wt * obs[idx];
+	if (iA>=0) {
+	    diag[iA] += wt;
+	    rhs[iA] += wm;
+	}
+	if (iB>=0) {
+	    diag[iB] += wt;
+	    rhs[iB] -= wm;
+	}
+	if (iA>=0 && iB>=0) {
+	    trips.push_back( Eigen::Triplet<double>(iA, iB, -wt) );
+	    trips.push_back( Eigen::Triplet<double>(iB, iA, -wt) );
+	}
+    }
+    const double ridge = 1e-6 * mMAX(diag.maxCoeff(), 1.0);
+    for (int idx=0; idx<nrfree; idx++)
+	trips.push_back( Eigen::Triplet<double>(idx, idx, diag[idx]+ridge) );
+
+    Eigen::SparseMatrix<double> normal( nrfree, nrfree );
+    normal.setFromTriplets( trips.begin(), trips.end() );
+    Eigen::ConjugateGradient<Eigen::SparseMatrix<double>,Eigen::Lower|Eigen::Upper> solver;
+    solver.setTolerance( 1e-10 );
+    solver.setMaxIterations( mMAX(10*nrfree, 1000) );
+    solver.compute( normal );
+    if (solver.info()!=Eigen::Success)
+	return false;
+    const Eigen::VectorXd cor = solver.solve( rhs );
+    if (solver.info()!=Eigen::Success)
+	return false;
+
+    for (int idx=0; idx<nrlines; idx++) {
+	if (solidx[idx]>=0)
+	    sol[idx] = float(cor[solidx[idx]]);
+    }
+    return true;
+}
+
+static float rmsTies( const MistieTies& ties, const TypeSet<float>& obs, const TypeSet<float>& sol )
+{
+    double err = 0.0;
+    int nrgood = 0;
+    for (int idx=0; idx<ties.size(); idx++) {
+	if (mIsUdf(obs[idx]))
+	    continue;
+	const double diff = obs[idx] - sol[ties.idxA_[idx]] + sol[ties.idxB_[idx]];
+	err += diff*diff;
+	nrgood++;
+    }
+    return nrgood ? float(sqrt(err/nrgood)) : 0.f;
+}
+
+static void getFixed( const MistieCorrectionData& cors, const BufferStringSet& reference,
+		      BoolTypeSet& fixed )
+{
+    fixed.setSize( cors.size(), false );
+    for (int idx=0; idx<cors.size(); idx++)
+	fixed[idx] = reference.isPresent(cors.getDataName(idx));
+}
+
 float MistieCorrectionData::computeZCor( const MistieData& misties, const BufferStringSet& reference, float minQuality, int maxIter, float damping, float delta )
 {
     BufferString lineA, lineB;
-    float zdiff, errLast, err;
-    
     for (int idx=0; idx<misties.size(); idx++) {
         misties.getLines(idx, lineA, lineB);
         setZCor(lineA, 0.0);
         setZCor(lineB, 0.0);
     }
-    errLast = 0.0;
-    int nrGood = 0;
-    for (int idx=0; idx<misties.size(); idx++) {
-        if (misties.getQuality(idx)>=minQuality) {
-            zdiff = misties.getZMistieWith( *this, idx );
-            errLast += zdiff*zdiff;
-            nrGood++;
-        }
+
+    MistieTies ties;
+    getTies(*this, misties, minQuality, ties);
+    BoolTypeSet fixed;
+    getFixed(*this, reference, fixed);
+    TypeSet<float> obs, sol(size(), 0.f);
+    for (int idx=0; idx<ties.size(); idx++)
+	obs += misties.getZMistie(ties.mistieidx_[idx]);
+
+    BufferString logmsg("Mistie Z Correction Calculation - Initial RMS mistie: ");
+    logmsg += rmsTies(ties, obs, sol);
+    if (!solveTies(ties, obs, fixed, sol)) {
+	ErrMsg("MistieCorrectionData::computeZCor - least squares solution failed");
+	return mUdf(float);
     }
-    errLast = sqrt(errLast/(float)nrGood);
-    BufferString logmsg("Mistie Z Correction Calculation - Initial RMS mistie: "); logmsg += errLast;
-    int iter = 0;
-    float chg = 0.0;
-    TypeSet<float> est(size(), 0);
-    TypeSet<int> estcount(size(), 0);
-    do {
-        est.setAll(0.0);
-        estcount.setAll(0);
-        for (int idx=0; idx<misties.size(); idx++) {
-            if (misties.getQuality(idx)>=minQuality) {
-                misties.getLines(idx, lineA, lineB );
-                zdiff = misties.getZMistieWith( *this, idx );
-        
-                int ilA = getIndex(lineA);
-                int ilB = getIndex(lineB);
-                est[ilA] += zdiff;
-                estcount[ilA]++;
-                est[ilB] -= zdiff;
-                estcount[ilB]++;
-            }
-        }
-        for (int idx=0; idx<size(); idx++) {
-            if (reference.isPresent(getDataName(idx)))
-                setZCor(idx, 0.0);
-            else if (estcount[idx]!=0)
-                setZCor(idx, getZCor(idx)+damping*est[idx]/(float)estcount[idx]);
-        }
-        err=0.0;
-        for (int idx=0; idx<misties.size(); idx++) {
-            if (misties.getQuality(idx)>=minQuality) {
-                zdiff = misties.getZMistieWith( *this, idx );
-                err += zdiff*zdiff;
-            }
-        }
-        err = sqrt(err/(float)nrGood);
-        chg = fabs(errLast-err);
-        iter++;
-        errLast = err;
-    } while (chg > delta && iter < maxIter);
+    for (int idx=0; idx<size(); idx++)
+	setZCor(idx, sol[idx]);
 
-    logmsg += " Final RMS mistie: "; logmsg += err; logmsg += " Iterations: "; logmsg += iter;
+    const float err = rmsTies(ties, obs, sol);
+    logmsg += " Final RMS mistie: "; logmsg += err;
     UsrMsg(logmsg);
 
-    return errLast;    
+    return err;
 }
 
 float MistieCorrectionData::computePhaseCor( const MistieData& misties, const BufferStringSet& reference, float minQuality, int maxIter, float damping, float delta )
 {
     BufferString lineA, lineB;
-    float phasediff, errLast, err;
-    MistieData work(misties);
-    
-    for (int idx=0; idx<work.size(); idx++) {
+    for (int idx=0; idx<misties.size(); idx++) {
         misties.getLines(idx, lineA, lineB);
         setPhaseCor(lineA, 0.0);
         setPhaseCor(lineB, 0.0);
     }
-    errLast = 0.0;
-    int nrGood = 0;
-    for (int idx=0; idx<work.size(); idx++) {
-        if (misties.getQuality(idx)>=minQuality) {
-            phasediff = work.getPhaseMistieWith( *this, idx );
-            errLast += phasediff*phasediff;
-            nrGood++;
-        }
-    }
-    errLast = sqrt(errLast/(float)nrGood);
-    BufferString logmsg("Mistie Phase Correction Calculation - Initial RMS mistie: "); logmsg += errLast;
+
+    MistieTies ties;
+    getTies(*this, misties, minQuality, ties);
+    BoolTypeSet fixed;
+    getFixed(*this, reference, fixed);
+    TypeSet<float> obs, sol(size(), 0.f);
+    for (int idx=0; idx<ties.size(); idx++)
+	obs += misties.getPhaseMistie(ties.mistieidx_[idx]);
+
+    BufferString logmsg("Mistie Phase Correction Calculation - Initial RMS mistie: ");
+    logmsg += rmsTies(ties, obs, sol);
+    // Phase misties are only known modulo 360, unwrap them against the current solution and
+    // solve again until no tie changes
     int iter = 0;
-    float chg = 0.0;
-    TypeSet<float> est(size(), 0);
-    TypeSet<int> estcount(size(), 0);
-    do {
-        est.setAll(0.0);
-        estcount.setAll(0);
-        for (int idx=0; idx<work.size(); idx++) {
-            if (work.getQuality(idx)>=minQuality) {
-                work.getLines(idx, lineA, lineB );
-                phasediff = work.getPhaseMistieWith( *this, idx );
-                
-                int ilA = getIndex(lineA);
-                int ilB = getIndex(lineB);
-                est[ilA] += phasediff;
-                estcount[ilA]++;
-                est[ilB] -= phasediff;
-                estcount[ilB]++;
-            }
-        }
-        for (int idx=0; idx<size(); idx++) {
-            if (reference.isPresent(getDataName(idx)))
-                setPhaseCor(idx, 0.0);
-            else if (estcount[idx]!=0)
-                setPhaseCor(idx, getPhaseCor(idx) + damping*est[idx]/(float)estcount[idx]);
-        }
-        err=0.0;
-        for (int idx=0; idx<work.size(); idx++) {
-            if (misties.getQuality(idx)>=minQuality) {
-                phasediff = work.getPhaseMistieWith( *this, idx );
-                err += phasediff*phasediff;
-            }
-        }
-        for (int idx=0; idx<work.size();idx++) {
-            if (work.getQuality(idx)>=minQuality) {
-                work.getLines(idx, lineA, lineB );
-                phasediff = work.getPhaseMistie( idx );
-                
-                int ilA = getIndex(lineA);
-                int ilB = getIndex(lineB);
-                float diff = phasediff - (getPhaseCor(ilA)-getPhaseCor(ilB));
-                if (fabs(diff + 360)<fabs(diff) || fabs(diff-360)<fabs(diff))
-                    work.setPhaseMistie( idx, fabs(diff+360)<fabs(diff-360) ? phasediff+360 : phasediff-360 );
-            }
-        }
-        err = sqrt(err/(float)nrGood);
-        chg = fabs(errLast-err);
-        iter++;
-        errLast = err;
-    } while (chg > delta && iter < maxIter);
-    
+    bool changed = true;
+    while (changed && iter<mMAX(maxIter,1)) {
+	if (!solveTies(ties, obs, fixed, sol)) {
+	    ErrMsg("MistieCorrectionData::computePhaseCor - least squares solution failed");
+	    return mUdf(float);
+	}
+	iter++;
+	changed = false;
+	for (int idx=0; idx<ties.size(); idx++) {
+	    const float diff = obs[idx] - (sol[ties.idxA_[idx]]-sol[ties.idxB_[idx]]);
+	    if (fabs(diff + 360)<fabs(diff) || fabs(diff-360)<fabs(diff)) {
+		obs[idx] += fabs(diff+360)<fabs(diff-360) ? 360 : -360;
+		changed = true;
+	    }
+	}
+    }
+    for (int idx=0; idx<size(); idx++)
+	setPhaseCor(idx, sol[idx]);
+
+    const float err = rmsTies(ties, obs, sol);
     logmsg += " Final RMS mistie: "; logmsg += err; logmsg += " Iterations: "; logmsg += iter;
     UsrMsg(logmsg);
-    
-    return errLast;    
-}
 
+    return err;
+}
 
 float MistieCorrectionData::computeAmpCor( const MistieData& misties, const BufferStringSet& reference, float minQuality, int maxIter, float damping, float delta )
 {
     BufferString lineA, lineB;
-    float ampdiff, errLast, err;
-    
-    ampdiff = 0.0;
-    int count = 0;
     for (int idx=0; idx<misties.size(); idx++) {
         misties.getLines(idx, lineA, lineB);
-        if (reference.isPresent(lineA)) {
-            ampdiff += log10(misties.getAmpMistie(idx));
-            count++;
-        } else if (reference.isPresent(lineB)) {
-            ampdiff -= log10(misties.getAmpMistie(idx));
-            count++;
-        }
+        setAmpCor(lineA, 1.0);
+        setAmpCor(lineB, 1.0);
     }
-    if (count) 
-        ampdiff = pow(10, -ampdiff/(float)count);
-    else
-        ampdiff = 1.0;
-        
-    for (int idx=0; idx<misties.size(); idx++) {
-        misties.getLines(idx, lineA, lineB);
-        if (reference.isPresent(lineA) || reference.isPresent(lineB)) {
-            setAmpCor(lineA, 1.0);
-            setAmpCor(lineB, 1.0);
-        } else {
-            setAmpCor(lineA, ampdiff);
-            setAmpCor(lineB, ampdiff);
-        }
+
+    MistieTies ties;
+    getTies(*this, misties, minQuality, ties);
+    BoolTypeSet fixed;
+    getFixed(*this, reference, fixed);
+    // Amplitude misties are solved in log10 so the corrections multiply
+    TypeSet<float> obs, sol(size(), 0.f);
+    for (int idx=0; idx<ties.size(); idx++) {
+	const float amp = misties.getAmpMistie(ties.mistieidx_[idx]);
+	obs += !mIsUdf(amp) && amp>0.f ? log10(amp) : mUdf(float);
     }
-        
-    errLast = 0.0;
-    int nrGood = 0;
-    for (int idx=0; idx<misties.size(); idx++) {
-        if (misties.getQuality(idx)>=minQuality) {
-            ampdiff = misties.getAmpMistieWith( *this, idx )-1.0;
-            errLast += ampdiff*ampdiff;
-            nrGood++;
-        }
+
+    double err = 0.0;
+    int nrgood = 0;
+    for (int idx=0; idx<ties.size(); idx++) {
+	if (mIsUdf(obs[idx]))
+	    continue;
+	const double diff = misties.getAmpMistie(ties.mistieidx_[idx]) - 1.0;
+	err += diff*diff;
+	nrgood++;
     }
-    errLast = sqrt(errLast/(float)nrGood);
-    BufferString logmsg("Mistie Amplitude Correction Calculation - Initial RMS mistie: "); logmsg += errLast;
-    int iter = 0;
-    float chg = 0.0;
-    TypeSet<float> est(size(), 0);
-    TypeSet<int> estcount(size(), 0);
-    do {
-        est.setAll(0.0);
-        estcount.setAll(0);
-        for (int idx=0; idx<misties.size(); idx++) {
-            if (misties.getQuality(idx)>=minQuality) {
-                misties.getLines(idx, lineA, lineB );
-                ampdiff = log10(misties.getAmpMistieWith( *this, idx ));
-                
-                int ilA = getIndex(lineA);
-                int ilB = getIndex(lineB);
-                est[ilA] += ampdiff;
-                estcount[ilA]++;
-                est[ilB] -= ampdiff;
-                estcount[ilB]++;
-            }
-        }
-        for (int idx=0; idx<size(); idx++) {
-            if (reference.isPresent(getDataName(idx)))
-                setAmpCor(idx, 1.0);
-            else if (estcount[idx]!=0)
-                setAmpCor(idx, getAmpCor(idx)*pow(10,damping*est[idx]/(float)estcount[idx]));
-        }
-        err=0.0;
-        for (int idx=0; idx<misties.size(); idx++) {
-            if (misties.getQuality(idx)>=minQuality) {
-                ampdiff = misties.getAmpMistieWith( *this, idx ) - 1.0;
-                err += ampdiff*ampdiff;
-            }
-        }
-        err = sqrt(err/(float)nrGood);
-        chg = fabs(errLast-err);
-        iter++;
-        errLast = err;
-    } while (chg > delta && iter < maxIter);
-    
-    logmsg += " Final RMS mistie: "; logmsg += err; logmsg += " Iterations: "; logmsg += iter;
+    BufferString logmsg("Mistie Amplitude Correction Calculation - Initial RMS mistie: ");
+    logmsg += nrgood ? float(sqrt(err/nrgood)) : 0.f;
+    if (!solveTies(ties, obs, fixed, sol)) {
+	ErrMsg("MistieCorrectionData::computeAmpCor - least squares solution failed");
+	return mUdf(float);
+    }
+    for (int idx=0; idx<size(); idx++)
+	setAmpCor(idx, pow(10, sol[idx]));
+
+    err = 0.0;
+    for (int idx=0; idx<ties.size(); idx++) {
+	if (mIsUdf(obs[idx]))
+	    continue;
+	const double amp = misties.getAmpMistie(ties.mistieidx_[idx]);
+	const double diff = amp / getAmpCor(ties.idxA_[idx]) * getAmpCor(ties.idxB_[idx]) - 1.0;
+	err += diff*diff;
+    }
+    const float rms = nrgood ? float(sqrt(err/nrgood)) : 0.f;
+    logmsg += " Final RMS mistie: "; logmsg += rms;
     UsrMsg(logmsg);
-    
-    return errLast;    
+
+    return rms;
 }
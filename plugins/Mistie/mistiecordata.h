@@ -39,6 +39,8 @@ public:
     bool            get( const char* dataname, float& shift, float& phase, float& amp ) const;
     void            set( const char* dataname, float shift, float phase, float amp );
     
+    // Least squares corrections over the tie network, weighted by quality with the reference lines held fixed.
+    // maxIter only limits the phase unwrapping passes, damping and delta are no longer used.
     float           computeZCor( const MistieData& misties, const BufferStringSet& reference, float minQuality=0.5, int maxIter=20, float damping=0.75, float delta=0.01 );
     float           computePhaseCor( const MistieData& misties, const BufferStringSet& reference, float minQuality=0.5, int maxIter=20, float damping=0.75, float delta=0.001 );
     float           computeAmpCor( const MistieData& misties, const BufferStringSet& reference, float minQuality=0.5, int maxIter=20, float damping=0.75, float delta=0.001 );
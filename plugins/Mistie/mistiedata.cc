@@ -1,9 +1,23 @@
 #include "mistiedata.h"
 
+#include "filepath.h"
 #include "od_iostream.h"
 
 #include "mistiecordata.h"
 
+#include <cstring>
+
+static const char* sBinMagic = "MISTIEB1";
+
+size_t MistieData::TieKeyHash::operator()( const TieKey& key ) const
+{
+    size_t hash = std::hash<int>()( key.lineA_ );
+    hash = hash*31 + std::hash<int>()( key.trcA_ );
+    hash = hash*31 + std::hash<int>()( key.lineB_ );
+    hash = hash*31 + std::hash<int>()( key.trcB_ );
+    return hash;
+}
+
 MistieData::MistieData()
 {}
 
@@ -16,8 +30,11 @@ MistieData& MistieData::operator=(const MistieData& d)
 {
     if (&d != this) {
         erase();
-        dataA_ = d.dataA_;
-        dataB_ = d.dataB_;
+        linenames_ = d.linenames_;
+        lineids_ = d.lineids_;
+        tieidx_ = d.tieidx_;
+        lineA_ = d.lineA_;
+        lineB_ = d.lineB_;
         trcA_ = d.trcA_;
         trcB_ = d.trcB_;
         pos_ = d.pos_;
@@ -31,7 +48,37 @@ MistieData& MistieData::operator=(const MistieData& d)
 
 int MistieData::size() const
 {
-    return dataA_.size();
+    return lineA_.size();
+}
+
+int MistieData::getLineID( const char* linenm )
+{
+    auto it = lineids_.find( linenm );
+    if (it != lineids_.end())
+        return it->second;
+
+    const int id = linenames_.size();
+    linenames_.add( linenm );
+    lineids_[linenm] = id;
+    return id;
+}
+
+int MistieData::findLineID( const char* linenm ) const
+{
+    auto it = lineids_.find( linenm );
+    return it != lineids_.end() ? it->second : -1;
+}
+
+MistieData::TieKey MistieData::tieKey( int lineA, int trcA, int lineB, int trcB )
+{
+    // A tie and its reverse are the same intersection
+    const bool swap = lineB<lineA || (lineB==lineA && trcB<trcA);
+    TieKey key;
+    key.lineA_ = swap ? lineB : lineA;
+    key.trcA_ = swap ? trcB : trcA;
+    key.lineB_ = swap ? lineA : lineB;
+    key.trcB_ = swap ? trcA : trcB;
+    return key;
 }
 
 bool MistieData::read( const char* filename, bool merge, bool replace )
@@ -41,6 +88,13 @@ bool MistieData::read( const char* filename, bool merge, bool replace )
     od_istream strm(filename);
     if (!strm.isOK())
         return false;
+
+    char magic[8];
+    if (strm.getBin(magic, sizeof(magic)) && !strncmp(magic, sBinMagic, sizeof(magic)))
+        return readBinary(strm, merge, replace);
+    // A text file shorter than the magic leaves the stream at eof
+    strm.stdStream().clear();
+    strm.setReadPosition(0);
     
     BufferString buf;
     strm.getLine(buf);
@@ -62,14 +116,22 @@ bool MistieData::read( const char* filename, bool merge, bool replace )
 }
 
 bool MistieData::write( const char* filename ) const
+{
+    return write( filename, FilePath(filename).extension()==binExtStr() );
+}
+
+bool MistieData::write( const char* filename, bool binary ) const
 {
     od_ostream strm(filename);
     if (!strm.isOK())
         return false;
+
+    if (binary)
+        return writeBinary(strm);
     
     strm << "\"LineA\"\t\"TrcA\"\t\"LineB\"\t\"TrcB\"\t\"X\"\t\"Y\"\t\"Zdiff\"\t\"PhaseDiff\"\t\"AmpDiff\"\t\"Quality\"\n";
     for (int idx=0; idx<size(); idx++)
-        strm << dataA_.get(idx) <<'\t'<<trcA_[idx]<<'\t'<<dataB_.get(idx)<<'\t'<<trcB_[idx]<<'\t'
+        strm << linenames_.get(lineA_[idx]) <<'\t'<<trcA_[idx]<<'\t'<<linenames_.get(lineB_[idx])<<'\t'<<trcB_[idx]<<'\t'
              <<pos_[idx].x<<'\t'<<pos_[idx].y<<'\t'<<zdiff_[idx]<<'\t'<<phasediff_[idx]<<'\t'<<ampdiff_[idx]<<'\t'<<quality_[idx]<<'\n';
              
     if (!strm.isOK())
@@ -77,11 +139,107 @@ bool MistieData::write( const char* filename ) const
    return true; 
 }
 
+/*
+  Binary layout, native byte order: magic, nrlines (int32), per line name length (int32)
+  and characters, nrties (int32), then one array per column: lineA, trcA, lineB, trcB
+  (int32 line ids and trace numbers), x, y (double), zdiff, phasediff, ampdiff, quality (float).
+*/
+bool MistieData::writeBinary( od_ostream& strm ) const
+{
+    strm.addBin( sBinMagic, 8 );
+    const od_int32 nrlines = linenames_.size();
+    strm.addBin( &nrlines, sizeof(od_int32) );
+    for (int idx=0; idx<nrlines; idx++) {
+        const BufferString& nm = linenames_.get(idx);
+        const od_int32 len = nm.size();
+        strm.addBin( &len, sizeof(od_int32) );
+        strm.addBin( nm.buf(), len );
+    }
+
+    const od_int32 nrties = size();
+    strm.addBin( &nrties, sizeof(od_int32) );
+    if (nrties) {
+        TypeSet<double> xs(nrties, 0.0), ys(nrties, 0.0);
+        for (int idx=0; idx<nrties; idx++) {
+            xs[idx] = pos_[idx].x;
+            ys[idx] = pos_[idx].y;
+        }
+        strm.addBin( lineA_.arr(), nrties*sizeof(int) );
+        strm.addBin( trcA_.arr(), nrties*sizeof(int) );
+        strm.addBin( lineB_.arr(), nrties*sizeof(int) );
+        strm.addBin( trcB_.arr(), nrties*sizeof(int) );
+        strm.addBin( xs.arr(), nrties*sizeof(double) );
+        strm.addBin( ys.arr(), nrties*sizeof(double) );
+        strm.addBin( zdiff_.arr(), nrties*sizeof(float) );
+        strm.addBin( phasediff_.arr(), nrties*sizeof(float) );
+        strm.addBin( ampdiff_.arr(), nrties*sizeof(float) );
+        strm.addBin( quality_.arr(), nrties*sizeof(float) );
+    }
+    return strm.isOK();
+}
+
+bool MistieData::readBinary( od_istream& strm, bool merge, bool replace )
+{
+    od_int32 nrlines = 0;
+    if (!strm.getBin(&nrlines, sizeof(od_int32)) || nrlines<0)
+        return false;
+    BufferStringSet names;
+    for (int idx=0; idx<nrlines; idx++) {
+        od_int32 len = 0;
+        if (!strm.getBin(&len, sizeof(od_int32)) || len<0)
+            return false;
+        BufferString nm;
+        nm.setMinBufSize( len+1 );
+        if (len && !strm.getBin(nm.getCStr(), len))
+            return false;
+        nm.getCStr()[len] = '\0';
+        names.add( nm );
+    }
+
+    od_int32 nrties = 0;
+    if (!strm.getBin(&nrties, sizeof(od_int32)) || nrties<0)
+        return false;
+    if (!nrties)
+        return true;
+
+    TypeSet<int> lineA(nrties, 0), trcA(nrties, 0), lineB(nrties, 0), trcB(nrties, 0);
+    TypeSet<double> xs(nrties, 0.0), ys(nrties, 0.0);
+    TypeSet<float> zdiff(nrties, 0.f), phasediff(nrties, 0.f), ampdiff(nrties, 0.f), quality(nrties, 0.f);
+    if (!strm.getBin(lineA.arr(), nrties*sizeof(int)) || !strm.getBin(trcA.arr(), nrties*sizeof(int))
+        || !strm.getBin(lineB.arr(), nrties*sizeof(int)) || !strm.getBin(trcB.arr(), nrties*sizeof(int))
+        || !strm.getBin(xs.arr(), nrties*sizeof(double)) || !strm.getBin(ys.arr(), nrties*sizeof(double))
+        || !strm.getBin(zdiff.arr(), nrties*sizeof(float)) || !strm.getBin(phasediff.arr(), nrties*sizeof(float))
+        || !strm.getBin(ampdiff.arr(), nrties*sizeof(float)) || !strm.getBin(quality.arr(), nrties*sizeof(float)))
+        return false;
+
+    TypeSet<int> ids(nrlines, -1);
+    for (int idx=0; idx<nrlines; idx++)
+        ids[idx] = getLineID( names.get(idx) );
+    for (int idx=0; idx<nrties; idx++) {
+        if (!ids.validIdx(lineA[idx]) || !ids.validIdx(lineB[idx]))
+            return false;
+        const int ilA = ids[lineA[idx]];
+        const int ilB = ids[lineB[idx]];
+        auto it = tieidx_.find( tieKey(ilA, trcA[idx], ilB, trcB[idx]) );
+        if (it != tieidx_.end()) {
+            if (replace)
+                set(it->second, zdiff[idx], phasediff[idx], ampdiff[idx], quality[idx]);
+            continue;
+        }
+        addEntry( ilA, trcA[idx], ilB, trcB[idx], Coord(xs[idx], ys[idx]),
+                  zdiff[idx], phasediff[idx], ampdiff[idx], quality[idx] );
+    }
+    return true;
+}
+
 void MistieData::erase()
 {
-    dataA_.erase();
+    linenames_.erase();
+    lineids_.clear();
+    tieidx_.clear();
+    lineA_.erase();
     trcA_.erase();
-    dataB_.erase();
+    lineB_.erase();
     trcB_.erase();
     pos_.erase();
     zdiff_.erase();
@@ -90,42 +248,45 @@ void MistieData::erase()
     quality_.erase();
 }
 
-void MistieData::add( const MistieData& other )
+void MistieData::addEntry( int lineA, int trcA, int lineB, int trcB, Coord pos,
+                           float zdiff, float phasediff, float ampdiff, float quality )
 {
-    for (int idx=0; idx<other.size(); idx++) {
-        dataA_.add(other.dataA_.get(idx));
-        trcA_ += other.trcA_[idx];
-        dataB_.add(other.dataB_.get(idx));
-        trcB_ += other.trcB_[idx];
-        pos_ += other.pos_[idx];
-        zdiff_ += other.zdiff_[idx];
-        phasediff_ += other.phasediff_[idx];
-        ampdiff_ += other.ampdiff_[idx];
-        quality_ += other.quality_[idx];
-    }
-}
-    
-bool MistieData::add( const char* dataA, int trcA, const char* dataB, int trcB, Coord pos, float zdiff, float phasediff, float ampdiff, float quality, bool replace )
-{
-    for (int idx=0; idx<size(); idx++) {
-        if ((dataA_.get(idx)==dataA && dataB_.get(idx)==dataB && trcA_[idx]==trcA && trcB_[idx]==trcB) 
-            || (dataA_.get(idx)==dataB && dataB_.get(idx)==dataA && trcA_[idx]==trcB && trcB_[idx]==trcA)) {
-            if (replace) {
-                set(idx, zdiff, phasediff, ampdiff, quality); 
-                return true;
-            }
-            return false;
-        }
-    }
-    dataA_.add(dataA);
+    tieidx_.emplace( tieKey(lineA, trcA, lineB, trcB), size() );
+    lineA_ += lineA;
     trcA_ += trcA;
-    dataB_.add(dataB);
+    lineB_ += lineB;
     trcB_ += trcB;
     pos_ += pos;
     zdiff_ += zdiff;
     phasediff_ += phasediff;
     ampdiff_ += ampdiff;
     quality_ += quality;
+}
+
+void MistieData::add( const MistieData& other )
+{
+    TypeSet<int> ids(other.linenames_.size(), -1);
+    for (int idx=0; idx<ids.size(); idx++)
+        ids[idx] = getLineID( other.linenames_.get(idx) );
+    for (int idx=0; idx<other.size(); idx++)
+        addEntry( ids[other.lineA_[idx]], other.trcA_[idx], ids[other.lineB_[idx]], other.trcB_[idx],
+                  other.pos_[idx], other.zdiff_[idx], other.phasediff_[idx], other.ampdiff_[idx],
+                  other.quality_[idx] );
+}
+    
+bool MistieData::add( const char* dataA, int trcA, const char* dataB, int trcB, Coord pos, float zdiff, float phasediff, float ampdiff, float quality, bool replace )
+{
+    const int ilA = getLineID( dataA );
+    const int ilB = getLineID( dataB );
+    auto it = tieidx_.find( tieKey(ilA, trcA, ilB, trcB) );
+    if (it != tieidx_.end()) {
+        if (replace) {
+            set(it->second, zdiff, phasediff, ampdiff, quality); 
+            return true;
+        }
+        return false;
+    }
+    addEntry( ilA, trcA, ilB, trcB, pos, zdiff, phasediff, ampdiff, quality );
     
     return true;
 }
@@ -135,6 +296,16 @@ bool MistieData::add( const char* dataA, int trcA, const char* dataB, int trcB,
     return add( dataA, trcA, dataB, trcB, pos, 0.0, 0.0, 1.0, 1.0);
 }
 
+int MistieData::indexOf( const char* dataA, int trcA, const char* dataB, int trcB ) const
+{
+    const int ilA = findLineID( dataA );
+    const int ilB = findLineID( dataB );
+    if (ilA<0 || ilB<0)
+        return -1;
+    auto it = tieidx_.find( tieKey(ilA, trcA, ilB, trcB) );
+    return it != tieidx_.end() ? it->second : -1;
+}
+
 float MistieData::getZMistie( int idx ) const
 {
     return zdiff_[idx];
@@ -198,19 +369,22 @@ Coord MistieData::getPos( int idx ) const
 
 void MistieData::getAllLines( BufferStringSet& lnms ) const
 {
-    BufferString lineA, lineB;
+    BoolTypeSet used(linenames_.size(), false);
     for (int idx=0; idx<size(); idx++) {
-        getLines(idx, lineA, lineB);
-        lnms.addIfNew(lineA);
-        lnms.addIfNew(lineB);
+        used[lineA_[idx]] = true;
+        used[lineB_[idx]] = true;
+    }
+    for (int idx=0; idx<linenames_.size(); idx++) {
+        if (used[idx])
+            lnms.addIfNew(linenames_.get(idx));
     }
 }
 
 bool MistieData::get( int idx, BufferString& dataA, BufferString& dataB, float& zdiff, float& phasediff, float& ampdiff ) const
 {
     if (idx>=0 && idx<size()) {
-        dataA = dataA_.get(idx);
-        dataB = dataB_.get(idx);
+        dataA = linenames_.get(lineA_[idx]);
+        dataB = linenames_.get(lineB_[idx]);
         zdiff = zdiff_[idx];
         phasediff = phasediff_[idx];
         ampdiff = ampdiff_[idx];
@@ -222,9 +396,9 @@ bool MistieData::get( int idx, BufferString& dataA, BufferString& dataB, float&
 bool MistieData::get( int idx, BufferString& dataA, int& trcA, BufferString& dataB, int& trcB, Coord& pos, float& zdiff, float& phasediff, float& ampdiff, float& quality ) const
 {
     if (idx>=0 && idx<size()) {
-        dataA = dataA_.get(idx);
+        dataA = linenames_.get(lineA_[idx]);
         trcA = trcA_[idx];
-        dataB = dataB_.get(idx);
+        dataB = linenames_.get(lineB_[idx]);
         trcB = trcB_[idx];
         pos = pos_[idx];
         zdiff = zdiff_[idx];
@@ -239,9 +413,9 @@ bool MistieData::get( int idx, BufferString& dataA, int& trcA, BufferString& dat
 bool MistieData::get( int idx, BufferString& dataA, int& trcA, BufferString& dataB, int& trcB) const
 {
     if (idx>=0 && idx<size()) {
-        dataA = dataA_.get(idx);
+        dataA = linenames_.get(lineA_[idx]);
         trcA = trcA_[idx];
-        dataB = dataB_.get(idx);
+        dataB = linenames_.get(lineB_[idx]);
         trcB = trcB_[idx];
         return true;
     }
@@ -251,8 +425,8 @@ bool MistieData::get( int idx, BufferString& dataA, int& trcA, BufferString& dat
 bool MistieData::getLines( int idx, BufferString& dataA, BufferString& dataB ) const
 {
     if (idx>=0 && idx<size()) {
-        dataA = dataA_.get(idx);
-        dataB = dataB_.get(idx);
+        dataA = linenames_.get(lineA_[idx]);
+        dataB = linenames_.get(lineB_[idx]);
         return true;
     }
     return false;
@@ -289,10 +463,14 @@ bool MistieData::setPhaseMistie( int idx, float phasediff )
 bool MistieData::set( int idx, const char* dataA, int trcA, const char* dataB, int trcB, Coord pos, float zdiff, float phasediff, float ampdiff, float quality )
 {
     if (idx>=0 && idx<size()) {
-        dataA_.get(idx) = dataA;
+        auto it = tieidx_.find( tieKey(lineA_[idx], trcA_[idx], lineB_[idx], trcB_[idx]) );
+        if (it != tieidx_.end() && it->second==idx)
+            tieidx_.erase( it );
+        lineA_[idx] = getLineID( dataA );
         trcA_[idx] = trcA;
-        dataB_.get(idx) = dataB;
+        lineB_[idx] = getLineID( dataB );
         trcB_[idx] = trcB;
+        tieidx_.emplace( tieKey(lineA_[idx], trcA, lineB_[idx], trcB), idx );
         pos_[idx] = pos;
         zdiff_[idx] = zdiff;
         phasediff_[idx] = phasediff;
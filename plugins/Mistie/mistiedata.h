@@ -6,7 +6,13 @@
 #include "typeset.h"
 #include "coord.h"
 
+#include <string>
+#include <unordered_map>
+
 class MistieCorrectionData;
+class od_istream;
+class od_ostream;
+
 mExpClass(Mistie) MistieData
 {
 public:
@@ -19,9 +25,13 @@ public:
     static const char* extStr()     { return "mistie"; }
     static const char* filtStr()    { return "*.mistie"; }
     static const char* defDirStr()  { return "Misc"; }
+    static const char* binExtStr()  { return "mistieb"; }
+    static const char* binFiltStr() { return "*.mistieb"; }
     
+    // read detects the binary format, write uses it when the file has the binExtStr extension
     bool            read( const char* filename, bool merge=false, bool replace=false );
     bool            write( const char* filename ) const;
+    bool            write( const char* filename, bool binary ) const;
     int             size() const;
     void            erase();
     
@@ -29,6 +39,7 @@ public:
     bool            add( const char* dataA, int trcA, const char* dataB, int trcB, Coord pos, 
                          float zdiff, float phasediff, float ampdiff , float quality, bool replace=false );
     bool            add( const char* dataA, int trcA, const char* dataB, int trcB, Coord pos );
+    int             indexOf( const char* dataA, int trcA, const char* dataB, int trcB ) const;
 
     float           getZMistie( int idx ) const;
     float           getZMistieWith( const MistieCorrectionData& corrections, int idx ) const;
@@ -54,15 +65,38 @@ public:
     bool            set( int idx, float zdiff, float phasediff, float ampdiff, float quality );
     
 protected:
-    BufferStringSet     dataA_;
+    struct TieKey
+    {
+        int     lineA_, trcA_, lineB_, trcB_;
+        bool    operator==( const TieKey& oth ) const
+                { return lineA_==oth.lineA_ && trcA_==oth.trcA_ && lineB_==oth.lineB_ && trcB_==oth.trcB_; }
+    };
+    struct TieKeyHash
+    {
+        size_t  operator()( const TieKey& ) const;
+    };
+
+    BufferStringSet     linenames_;
+    std::unordered_map<std::string,int>         lineids_;
+    std::unordered_map<TieKey,int,TieKeyHash>   tieidx_;
+
+    TypeSet<int>        lineA_;
     TypeSet<int>        trcA_;
-    BufferStringSet     dataB_;
+    TypeSet<int>        lineB_;
     TypeSet<int>        trcB_;
     TypeSet<Coord>      pos_;
     TypeSet<float>      zdiff_;
     TypeSet<float>      phasediff_;
     TypeSet<float>      ampdiff_;
     TypeSet<float>      quality_;
+
+    int                 getLineID( const char* );
+    int                 findLineID( const char* ) const;
+    static TieKey       tieKey( int lineA, int trcA, int lineB, int trcB );
+    void                addEntry( int lineA, int trcA, int lineB, int trcB, Coord pos,
+                                  float zdiff, float phasediff, float ampdiff, float quality );
+    bool                readBinary( od_istream&, bool merge, bool replace );
+    bool                writeBinary( od_ostream& ) const;
 };
 
 #endif
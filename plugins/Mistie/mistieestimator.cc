@@ -26,6 +26,7 @@ MistieEstimatorFromSeismic::MistieEstimatorFromSeismic(const IOObj* ioobj, Line2
     , maxshift_(maxshift)
     , ioobj_(ioobj)
     , allest_(allEst)
+    , trccache_(ioobj,window,true)
 {
     BufferString lineA, lineB;
     int trcA, trcB;
@@ -64,6 +65,26 @@ uiString MistieEstimatorFromSeismic::uiNrDoneText() const
     return tr("Intersections done");
 }
 
+bool MistieEstimatorFromSeismic::doPrepare( int nrthreads )
+{
+    BufferString lineA, lineB;
+    int trcnrA, trcnrB;
+    trccache_.clear();
+    for (int idx=0; idx<misties_.size(); idx++) {
+	if (!misties_.get(idx, lineA, trcnrA, lineB, trcnrB))
+	    continue;
+	trccache_.add(Survey::GM().getGeomID(lineA), trcnrA);
+	trccache_.add(Survey::GM().getGeomID(lineB), trcnrB);
+    }
+    if (!trccache_.execute()) {
+	ErrMsg("MistieEstimatorFromSeismic::doPrepare - reading intersection traces failed");
+	return false;
+    }
+    correlator_.setNrThreads(nrthreads);
+    correlator_.clearCache();
+    return true;
+}
+
 bool MistieEstimatorFromSeismic::doWork( od_int64 start, od_int64 stop, int threadid )
 {
     BufferString lineA, lineB;
@@ -82,20 +103,32 @@ bool MistieEstimatorFromSeismic::doWork( od_int64 start, od_int64 stop, int thre
             ErrMsg(tmp);
             continue;
         }
-        if (get2DTrc(lineA, trcnrA, trcA) && get2DTrc(lineB, trcnrB, trcB)) {
-            if (trcA.info().sampling.step > trcB.info().sampling.step) {
+        const SeisTrc* cachedA = get2DTrc(lineA, trcnrA);
+        const SeisTrc* cachedB = get2DTrc(lineB, trcnrB);
+        if (cachedA && cachedB) {
+            const SeisTrc* useA = cachedA;
+            const SeisTrc* useB = cachedB;
+            if (cachedA->info().sampling.step > cachedB->info().sampling.step) {
+                trcA = *cachedA;
                 trcA.info().pick = 0.0;
-                SeisTrc* tmp = trcA.getRelTrc( window_, trcB.info().sampling.step );
+                SeisTrc* tmp = trcA.getRelTrc( window_, cachedB->info().sampling.step );
                 trcA = *tmp;
-            } else if (trcA.info().sampling.step < trcB.info().sampling.step) {
+                delete tmp;
+                useA = &trcA;
+            } else if (cachedA->info().sampling.step < cachedB->info().sampling.step) {
+                trcB = *cachedB;
                 trcB.info().pick = 0.0;
-                SeisTrc* tmp = trcB.getRelTrc( window_, trcA.info().sampling.step );
+                SeisTrc* tmp = trcB.getRelTrc( window_, cachedA->info().sampling.step );
                 trcB = *tmp;
+                delete tmp;
+                useB = &trcB;
             }
             if (allest_)
-		computeMistie( trcA, trcB, maxshift_, zdiff, phasediff, ampdiff, quality );
+		correlator_.compute( *useA, *useB, maxshift_, zdiff, phasediff, ampdiff, quality,
+				     threadid, useA==cachedA, useB==cachedB );
 	    else
-		computeMistie( trcA, trcB, maxshift_, zdiff, quality );
+		correlator_.compute( *useA, *useB, maxshift_, zdiff, quality,
+				     threadid, useA==cachedA, useB==cachedB );
 
         } else {
             BufferString tmp("MistieEstimatorFromSeismic::doWork - could not get trace data for: ");
@@ -107,26 +140,15 @@ bool MistieEstimatorFromSeismic::doWork( od_int64 start, od_int64 stop, int thre
     return true;
 }
 
-bool MistieEstimatorFromSeismic::get2DTrc( BufferString line, int trcnr, SeisTrc& trc )
+const SeisTrc* MistieEstimatorFromSeismic::get2DTrc( BufferString line, int trcnr ) const
 {
-    Pos::GeomID geomid = Survey::GM().getGeomID(line);
-    
-    Seis::RangeSelData range;
-    range.setZRange(window_);
-    range.cubeSampling().hsamp_.setInlRange(Interval<int>(0,0));
-    range.cubeSampling().hsamp_.setCrlRange(Interval<int>(trcnr, trcnr));
-    range.setGeomID(geomid);
-    
-    SeisTrcReader rdr(ioobj_);
-    rdr.setSelData(range.clone());
-    rdr.prepareWork();
-    rdr.get(trc);
-
-    return (!trc.isNull());
+    const SeisTrc* trc = trccache_.find(Survey::GM().getGeomID(line), trcnr);
+    return trc && !trc->isNull() ? trc : nullptr;
 }
 
 bool MistieEstimatorFromSeismic::doFinish( bool success )
 {
+    correlator_.clearCache();
     return true;
 }
 
@@ -9,6 +9,8 @@
 
 #include "mistiemod.h"
 #include "mistiedata.h"
+#include "mistietrccache.h"
+#include "trcanalysis.h"
 
 class Line2DInterSectionSet;
 class SeisTrc;
@@ -35,11 +37,14 @@ protected:
     bool			allest_;
     Threads::Lock               lock_;
     int                         counter_;
+    MistieTrcCache		trccache_;
+    MistieCorrelator		correlator_;
     
+    virtual bool	doPrepare(int) override;
     virtual bool        doWork(od_int64 start, od_int64 stop, int threadis) override;
     virtual bool        doFinish(bool success) override;
     
-    bool        get2DTrc( BufferString line, int trcnr, SeisTrc& trc );
+    const SeisTrc*	get2DTrc( BufferString line, int trcnr ) const;
 };
 
 mExpClass(Mistie) MistieEstimatorFromHorizon : public ParallelTask
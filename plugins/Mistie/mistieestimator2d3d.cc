@@ -118,6 +118,8 @@ MistieEstimatorFromSeismic2D3D::MistieEstimatorFromSeismic2D3D(const IOObj* ioob
     , selranges_(selranges)
     , trcstep_(trcstep)
     , allest_(allEst)
+    , trccache2d_(ioobj2D,window,true)
+    , trccache3d_(ioobj3D,window,false)
 {
     BufferString lineA, lineB;
     int trcA = 0;
@@ -152,6 +154,60 @@ uiString MistieEstimatorFromSeismic2D3D::uiNrDoneText() const
     return tr("Lines done");
 }
 
+void MistieEstimatorFromSeismic2D3D::getTrcNrs( int trc1, int trc2, TypeSet<int>& trcnums ) const
+{
+    trcnums.erase();
+    StepInterval<int> traces(trc1, trc2, trcstep_);
+    if (traces.nrSteps()>=1) {
+        for (int it=0; it<traces.nrSteps(); it++)
+            trcnums += traces.atIndex(it);
+    } else
+        trcnums += traces.center();
+}
+
+bool MistieEstimatorFromSeismic2D3D::doPrepare( int nrthreads )
+{
+    BufferString lineA, lineB;
+    int trc1, trc2;
+    TypeSet<int> trcnums;
+    trccache2d_.clear();
+    trccache3d_.clear();
+    for (int idx=0; idx<misties_.size(); idx++) {
+	if (!misties_.get(idx, lineA, trc1, lineB, trc2))
+	    continue;
+	const Pos::GeomID geomid = Survey::GM().getGeomID(lineB);
+	getTrcNrs(trc1, trc2, trcnums);
+	for (int it=0; it<trcnums.size(); it++)
+	    trccache2d_.add(geomid, trcnums[it]);
+    }
+    if (!trccache2d_.execute()) {
+	ErrMsg("MistieEstimator2D3D::doPrepare - reading 2D intersection traces failed");
+	return false;
+    }
+
+    for (int idx=0; idx<misties_.size(); idx++) {
+	if (!misties_.get(idx, lineA, trc1, lineB, trc2))
+	    continue;
+	const Pos::GeomID geomid = Survey::GM().getGeomID(lineB);
+	getTrcNrs(trc1, trc2, trcnums);
+	for (int it=0; it<trcnums.size(); it++) {
+	    const SeisTrc* trcB = trccache2d_.find(geomid, trcnums[it]);
+	    if (!trcB)
+		continue;
+	    Coord pos(trcB->info().getValue(SeisTrcInfo::CoordX), trcB->info().getValue(SeisTrcInfo::CoordY));
+	    IdxPair bid = SI().binID2Coord().transformBack(pos);
+	    trccache3d_.add(BinID(bid.first, bid.second));
+	}
+    }
+    if (!trccache3d_.execute()) {
+	ErrMsg("MistieEstimator2D3D::doPrepare - reading 3D intersection traces failed");
+	return false;
+    }
+    correlator_.setNrThreads(nrthreads);
+    correlator_.clearCache();
+    return true;
+}
+
 bool MistieEstimatorFromSeismic2D3D::doWork( od_int64 start, od_int64 stop, int threadid )
 {
     BufferString lineA, lineB;
@@ -170,33 +226,41 @@ bool MistieEstimatorFromSeismic2D3D::doWork( od_int64 start, od_int64 stop, int
             ErrMsg(tmp);
             continue;
         }
-        StepInterval<int> traces(trc1, trc2, trcstep_);
         TypeSet<int> trcnums;
-        if (traces.nrSteps()>=1) {
-            for (int it=0; it<traces.nrSteps(); it++)
-                trcnums += traces.atIndex(it);
-        } else
-            trcnums += traces.center();
+        getTrcNrs(trc1, trc2, trcnums);
         int count = 0;
         for (int it=0; it<trcnums.size(); it++) {
-            if(get2DTrc(lineB, trcnums[it], trcB)) {
-                Coord pos(trcB.info().getValue(SeisTrcInfo::CoordX), trcB.info().getValue(SeisTrcInfo::CoordY));
+            const SeisTrc* cachedB = get2DTrc(lineB, trcnums[it]);
+            if (cachedB) {
+                Coord pos(cachedB->info().getValue(SeisTrcInfo::CoordX), cachedB->info().getValue(SeisTrcInfo::CoordY));
                 IdxPair bid = SI().binID2Coord().transformBack(pos);
-                if (get3DTrc(bid.first, bid.second, trcA)) {
-                    if (trcA.info().sampling.step > trcB.info().sampling.step) {
+                const SeisTrc* cachedA = get3DTrc(bid.first, bid.second);
+                if (cachedA) {
+                    const SeisTrc* useA = cachedA;
+                    const SeisTrc* useB = cachedB;
+                    if (cachedA->info().sampling.step > cachedB->info().sampling.step) {
+                        trcA = *cachedA;
                         trcA.info().pick = 0.0;
-                        SeisTrc* tmp = trcA.getRelTrc( window_, trcB.info().sampling.step );
+                        SeisTrc* tmp = trcA.getRelTrc( window_, cachedB->info().sampling.step );
                         trcA = *tmp;
-                    } else if (trcA.info().sampling.step < trcB.info().sampling.step) {
+                        delete tmp;
+                        useA = &trcA;
+                    } else if (cachedA->info().sampling.step < cachedB->info().sampling.step) {
+                        trcB = *cachedB;
                         trcB.info().pick = 0.0;
-                        SeisTrc* tmp = trcB.getRelTrc( window_, trcA.info().sampling.step );
+                        SeisTrc* tmp = trcB.getRelTrc( window_, cachedA->info().sampling.step );
                         trcB = *tmp;
+                        delete tmp;
+                        useB = &trcB;
                     }
                     float zd = 0.0;
                     float pd = 0.0;
                     float ad = 1.0;
                     float q = 0.0;
-		    if (allest_ ? computeMistie( trcA, trcB, maxshift_, zd, pd, ad, q ) : computeMistie( trcA, trcB, maxshift_, zd, q )) {
+                    const bool cacheA = useA==cachedA;
+                    const bool cacheB = useB==cachedB;
+		    if (allest_ ? correlator_.compute( *useA, *useB, maxshift_, zd, pd, ad, q, threadid, cacheA, cacheB )
+				: correlator_.compute( *useA, *useB, maxshift_, zd, q, threadid, cacheA, cacheB )) {
                         count++;
                         zdiff += zd;
                         cPhasediff +=  std::complex<float>(cos(Math::toRadians(pd)),sin(Math::toRadians(pd)));
@@ -226,41 +290,21 @@ bool MistieEstimatorFromSeismic2D3D::doWork( od_int64 start, od_int64 stop, int
     return true;
 }
 
-bool MistieEstimatorFromSeismic2D3D::get2DTrc( BufferString line, int trcnr, SeisTrc& trc )
+const SeisTrc* MistieEstimatorFromSeismic2D3D::get2DTrc( BufferString line, int trcnr ) const
 {
-    Pos::GeomID geomid = Survey::GM().getGeomID(line);
-    
-    Seis::RangeSelData range;
-    range.setZRange(window_);
-    range.cubeSampling().hsamp_.setInlRange(Interval<int>(0,0));
-    range.cubeSampling().hsamp_.setCrlRange(Interval<int>(trcnr, trcnr));
-    range.setGeomID(geomid);
-    
-    SeisTrcReader rdr(ioobj2d_);
-    rdr.setSelData(range.clone());
-    rdr.prepareWork();
-    rdr.get(trc);
-
-    return (!trc.isNull());
+    const SeisTrc* trc = trccache2d_.find(Survey::GM().getGeomID(line), trcnr);
+    return trc && !trc->isNull() ? trc : nullptr;
 }
 
-bool MistieEstimatorFromSeismic2D3D::get3DTrc( int inl, int crl, SeisTrc& trc )
+const SeisTrc* MistieEstimatorFromSeismic2D3D::get3DTrc( int inl, int crl ) const
 {
-    Seis::RangeSelData range;
-    range.setZRange(window_);
-    range.cubeSampling().hsamp_.setInlRange(Interval<int>(inl, inl));
-    range.cubeSampling().hsamp_.setCrlRange(Interval<int>(crl, crl));
-    
-    SeisTrcReader rdr(ioobj3d_);
-    rdr.setSelData(range.clone());
-    rdr.prepareWork();
-    rdr.get(trc);
-    
-    return (!trc.isNull());
+    const SeisTrc* trc = trccache3d_.find(BinID(inl, crl));
+    return trc && !trc->isNull() ? trc : nullptr;
 }
 
 bool MistieEstimatorFromSeismic2D3D::doFinish( bool success )
 {
+    correlator_.clearCache();
     return true;
 }
 
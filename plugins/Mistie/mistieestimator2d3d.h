@@ -9,6 +9,8 @@
 
 #include "mistiemod.h"
 #include "mistiedata.h"
+#include "mistietrccache.h"
+#include "trcanalysis.h"
 
 class BendPoints;
 class IOObj;
@@ -69,12 +71,17 @@ protected:
     bool			allest_;
     Threads::Lock               lock_;
     int                         counter_;
+    MistieTrcCache		trccache2d_;
+    MistieTrcCache		trccache3d_;
+    MistieCorrelator		correlator_;
     
+    bool	doPrepare(int nrthreads);
     bool        doWork(od_int64 start, od_int64 stop, int threadis);
     bool        doFinish(bool success);
     
-    bool        get2DTrc( BufferString line, int trcnr, SeisTrc& trc );
-    bool        get3DTrc( int inl, int crl, SeisTrc& trc );
+    void	getTrcNrs( int trc1, int trc2, TypeSet<int>& trcnums ) const;
+    const SeisTrc*	get2DTrc( BufferString line, int trcnr ) const;
+    const SeisTrc*	get3DTrc( int inl, int crl ) const;
 };
 
 mExpClass(Mistie) MistieEstimatorFromHorizon2D3D : public ParallelTask
@@ -0,0 +1,160 @@
+#include "mistietrccache.h"
+
+#include "binid.h"
+#include "ioobj.h"
+#include "seisread.h"
+#include "seisselectionimpl.h"
+#include "seistrc.h"
+
+#include <algorithm>
+
+MistieTrcCache::LineTrcs::~LineTrcs()
+{
+    deepErase( trcs_ );
+}
+
+MistieTrcCache::MistieTrcCache( const IOObj* ioobj, ZGate window, bool is2d )
+    : ioobj_(ioobj)
+    , window_(window)
+    , is2d_(is2d)
+{}
+
+MistieTrcCache::~MistieTrcCache()
+{}
+
+void MistieTrcCache::clear()
+{
+    lines_.erase();
+    linekeys_.clear();
+}
+
+void MistieTrcCache::add( Pos::GeomID geomid, int trcnr )
+{
+    addTrc( geomid, trcnr );
+}
+
+void MistieTrcCache::add( const BinID& bid )
+{
+    addTrc( bid.inl(), bid.crl() );
+}
+
+const SeisTrc* MistieTrcCache::find( Pos::GeomID geomid, int trcnr ) const
+{
+    return findTrc( geomid, trcnr );
+}
+
+const SeisTrc* MistieTrcCache::find( const BinID& bid ) const
+{
+    return findTrc( bid.inl(), bid.crl() );
+}
+
+void MistieTrcCache::addTrc( int linekey, int trcnr )
+{
+    auto it = std::lower_bound( linekeys_.begin(), linekeys_.end(), linekey );
+    const int lidx = mCast(int, it - linekeys_.begin());
+    if ( it==linekeys_.end() || *it!=linekey ) {
+	LineTrcs* line = new LineTrcs;
+	line->linekey_ = linekey;
+	linekeys_.insert( it, linekey );
+	lines_.insertAt( line, lidx );
+    }
+    lines_[lidx]->trcnrs_.push_back( trcnr );
+}
+
+const SeisTrc* MistieTrcCache::findTrc( int linekey, int trcnr ) const
+{
+    auto lit = std::lower_bound( linekeys_.begin(), linekeys_.end(), linekey );
+    if ( lit==linekeys_.end() || *lit!=linekey )
+	return nullptr;
+
+    const LineTrcs* line = lines_[mCast(int, lit - linekeys_.begin())];
+    const std::vector<int>& trcnrs = line->trcnrs_;
+    auto tit = std::lower_bound( trcnrs.begin(), trcnrs.end(), trcnr );
+    if ( tit==trcnrs.end() || *tit!=trcnr || !line->trcs_.size() )
+	return nullptr;
+
+    return line->trcs_[mCast(int, tit - trcnrs.begin())];
+}
+
+od_int64 MistieTrcCache::nrIterations() const
+{
+    return lines_.size();
+}
+
+uiString MistieTrcCache::uiMessage() const
+{
+    return tr("Reading intersection traces");
+}
+
+uiString MistieTrcCache::uiNrDoneText() const
+{
+    return tr("Lines done");
+}
+
+bool MistieTrcCache::doPrepare( int nrthreads )
+{
+    if ( !ioobj_ )
+	return false;
+
+    for ( int idx=0; idx<lines_.size(); idx++ ) {
+	LineTrcs& line = *lines_[idx];
+	std::vector<int>& trcnrs = line.trcnrs_;
+	std::sort( trcnrs.begin(), trcnrs.end() );
+	trcnrs.erase( std::unique(trcnrs.begin(), trcnrs.end()), trcnrs.end() );
+	deepErase( line.trcs_ );
+	for ( size_t itrc=0; itrc<trcnrs.size(); itrc++ )
+	    line.trcs_ += nullptr;
+    }
+    return true;
+}
+
+bool MistieTrcCache::doWork( od_int64 start, od_int64 stop, int threadid )
+{
+    for ( int idx=mCast(int,start); idx<=stop && shouldContinue(); idx++, addToNrDone(1) ) {
+	if ( !readLine(*lines_[idx]) ) {
+	    BufferString tmp("MistieTrcCache::doWork - could not read traces for line: ");
+	    tmp += lines_[idx]->linekey_;
+	    ErrMsg(tmp);
+	}
+    }
+    return true;
+}
+
+bool MistieTrcCache::readLine( LineTrcs& line ) const
+{
+    const std::vector<int>& trcnrs = line.trcnrs_;
+    if ( trcnrs.empty() )
+	return true;
+
+    Seis::RangeSelData range;
+    range.setZRange( window_ );
+    range.cubeSampling().hsamp_.setCrlRange( Interval<int>(trcnrs.front(), trcnrs.back()) );
+    if ( is2d_ ) {
+	range.cubeSampling().hsamp_.setInlRange( Interval<int>(0,0) );
+	range.setGeomID( line.linekey_ );
+    } else
+	range.cubeSampling().hsamp_.setInlRange( Interval<int>(line.linekey_, line.linekey_) );
+
+    SeisTrcReader rdr( ioobj_ );
+    rdr.setSelData( range.clone() );
+    if ( !rdr.prepareWork() )
+	return false;
+
+    const int nrtrcs = mCast(int, trcnrs.size());
+    int nrfound = 0;
+    SeisTrc trc;
+    while ( nrfound<nrtrcs && rdr.get(trc) ) {
+	const int trcnr = is2d_ ? trc.info().trcNr() : trc.info().binID().crl();
+	auto it = std::lower_bound( trcnrs.begin(), trcnrs.end(), trcnr );
+	if ( it==trcnrs.end() || *it!=trcnr )
+	    continue;
+
+	const int tidx = mCast(int, it - trcnrs.begin());
+	if ( line.trcs_[tidx] || trc.isNull() )
+	    continue;
+
+	line.trcs_.replace( tidx, new SeisTrc(trc) );
+	nrfound++;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef mistietrccache_h
+#define mistietrccache_h
+
+#include "paralleltask.h"
+#include "ranges.h"
+#include "survgeom.h"
+
+#include "mistiemod.h"
+
+#include <vector>
+
+class IOObj;
+class SeisTrc;
+class BinID;
+
+/*!
+\brief Reads the traces needed at mistie intersections with one sequential pass per line.
+
+Traces are first planned with add(), then execute() sorts the plan by line and trace number
+and reads every line with a single SeisTrcReader, keeping only the planned traces within the
+z window. Lines are spread over the worker threads, each thread using its own reader. After
+execution the cache is read only and find() can be called from any thread.
+
+Lines are identified by GeomID for 2D data and by inline number for 3D data.
+*/
+
+mExpClass(Mistie) MistieTrcCache : public ParallelTask
+{ mODTextTranslationClass(MistieTrcCache)
+public:
+			MistieTrcCache(const IOObj*, ZGate window, bool is2d);
+			~MistieTrcCache();
+
+    void		add(Pos::GeomID, int trcnr);
+    void		add(const BinID&);
+    void		clear();
+
+    const SeisTrc*	find(Pos::GeomID, int trcnr) const;
+    const SeisTrc*	find(const BinID&) const;
+
+    int			nrLines() const		{ return lines_.size(); }
+
+    od_int64		nrIterations() const override;
+    uiString		uiMessage() const override;
+    uiString		uiNrDoneText() const override;
+
+protected:
+    struct LineTrcs
+    {
+			~LineTrcs();
+
+	int			linekey_;
+	std::vector<int>	trcnrs_;
+	ObjectSet<SeisTrc>	trcs_;
+    };
+
+    const IOObj*		ioobj_;
+    ZGate			window_;
+    bool			is2d_;
+    ManagedObjectSet<LineTrcs>	lines_;
+    std::vector<int>		linekeys_;
+
+    void		addTrc(int linekey, int trcnr);
+    const SeisTrc*	findTrc(int linekey, int trcnr) const;
+    bool		readLine(LineTrcs&) const;
+
+    bool		doPrepare(int nrthreads) override;
+    bool		doWork(od_int64 start, od_int64 stop, int threadid) override;
+};
+
+#endif
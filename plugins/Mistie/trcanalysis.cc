@@ -5,108 +5,226 @@
 
 #include "unsupported/Eigen/FFT"
 
-bool computeMistie(const SeisTrc& trcA, const SeisTrc& trcB, float maxshift, float& zdiff, float& phasediff, float& ampdiff, float&  quality)
+#include <complex>
+#include <vector>
+
+struct MistieCorrelator::Spectrum
 {
-    Eigen::FFT<double> fft;
-    int n = trcA.size();
-    int nfft = 2*n;
-    float dt = trcA.info().sampling.step;
-    
-    Eigen::VectorXd A, B;
-    A.setZero(nfft);
-    B.setZero(nfft);
-    for (int idt=0; idt<n; idt++) {
-        float valA = mIsUdf(trcA.get(idt,0)) ? 0.0 : trcA.get(idt,0);
-        float valB = mIsUdf(trcB.get(idt,0)) ? 0.0 : trcB.get(idt,0);
-        A(idt) = valA;
-        B(idt) = valB;
-    }
-    double sumAA = A.head(n).norm();
-    double sumBB = B.head(n).norm();
-    if (mIsZero(sumAA, mDefEps) || mIsZero(sumBB, mDefEps)) {
-        zdiff = 0.0;
-        phasediff = 0.0;
-        ampdiff = 1.0;
-        quality = 0.0;
-        return false;
+    std::vector<std::complex<double>>	vals_;
+    double				norm_ = 0.0;
+    int					nfft_ = 0;
+};
+
+struct MistieCorrelator::Workspace
+{
+    Workspace()
+    {
+	fft_.SetFlag( Eigen::FFT<double>::HalfSpectrum );
     }
-    ampdiff = sumBB/sumAA;
-    
-    Eigen::VectorXcd Af, Bf, CCf, AS;
-    Eigen::VectorXd CC, H;
-    H.setConstant(nfft, 2.0);
-    H(0) = 1.0;
-    H(n) = 1.0;
-    H.segment(n+1, n-1) *= 0.0;
-    fft.fwd(Af,A);
-    fft.fwd(Bf,B);
-    CCf = (Bf.array() * Eigen::conj(Af.array()) * H.array()).matrix();
-    fft.inv(AS,CCf);
-    CC = Eigen::abs2(AS.array()).sqrt().matrix();
-    Eigen::MatrixXd::Index maxIndex;
-    int maxlag = maxshift/dt;
-    CC.segment(maxlag,nfft-2*maxlag) *= 0.0;
-    CC.maxCoeff(&maxIndex);
-    int il = maxIndex-1;
-    int ir = maxIndex+1;
-    if (maxIndex==0)
-        il = nfft-1;
-    else if (maxIndex==nfft-1)
-        ir = 0;
-    float cp = (CC(il)-CC(ir))/(2.0*CC(il)-4.0*CC(maxIndex)+2.0*CC(ir));
-    quality = (CC(maxIndex) - 0.25 * (CC(il) - CC(ir)) * cp)/(sumAA*sumBB);
-    quality = quality > 1.0 ? 1.0 : quality;
-    zdiff = (maxIndex < n ? float(maxIndex)+cp : float(maxIndex-nfft)+cp)*dt*SI().showZ2UserFactor();;
-    float p0 = std::arg(AS(maxIndex));
-    float p1 = cp>=0.0 ? std::arg(AS(ir)) : std::arg(AS(il));
-    p1 = p1-p0>M_PI ? p1-M_2PI : p1-p0<-M_PI ? p1+M_2PI : p1;
-    phasediff = Math::toDegrees(cp>=0.0 ? (p1-p0)*cp+p0 :(p0-p1)*cp+p0) ;   
-    return true;
+
+    Eigen::FFT<double>		fft_;
+    std::vector<double>		trc_;
+    std::vector<std::complex<double>>	spec_;
+    std::vector<std::complex<double>>	ccf_;
+    std::vector<std::complex<double>>	as_;
+    std::vector<double>		cc_;
+    Spectrum			tmpA_;
+    Spectrum			tmpB_;
+};
+
+MistieCorrelator::MistieCorrelator( int nrthreads )
+    : maxcachesize_(256*1024*1024)
+{
+    setNrThreads( nrthreads );
 }
 
-bool computeMistie(const SeisTrc& trcA, const SeisTrc& trcB, float maxshift, float& zdiff, float&  quality)
+MistieCorrelator::~MistieCorrelator()
+{}
+
+void MistieCorrelator::setNrThreads( int nrthreads )
+{
+    nrthreads = mMAX(nrthreads, 1);
+    while ( workspaces_.size() < nrthreads )
+	workspaces_ += new Workspace;
+    while ( workspaces_.size() > nrthreads )
+	workspaces_.removeSingle( workspaces_.size()-1 );
+}
+
+void MistieCorrelator::setMaxCacheSize( od_int64 nrbytes )
+{
+    Threads::Locker lckr( cachelock_ );
+    maxcachesize_ = nrbytes;
+}
+
+void MistieCorrelator::clearCache()
 {
-    Eigen::FFT<double> fft;
-    int n = trcA.size();
-    int nfft = 2*n;
-    float dt = trcA.info().sampling.step;
-
-    Eigen::VectorXd A, B;
-    A.setZero(nfft);
-    B.setZero(nfft);
-    for (int idt=0; idt<n; idt++) {
-	float valA = mIsUdf(trcA.get(idt,0)) ? 0.0 : trcA.get(idt,0);
-	float valB = mIsUdf(trcB.get(idt,0)) ? 0.0 : trcB.get(idt,0);
-	A(idt) = valA;
-	B(idt) = valB;
+    Threads::Locker lckr( cachelock_ );
+    specidx_.clear();
+    spectra_.erase();
+    cachesize_ = 0;
+}
+
+int MistieCorrelator::fftSize( int nrsamples )
+{
+    int nfft = 2;
+    while ( nfft < 2*nrsamples )
+	nfft *= 2;
+    return nfft;
+}
+
+const MistieCorrelator::Spectrum* MistieCorrelator::getSpectrum( Workspace& ws, const SeisTrc& trc,
+								int nfft, bool cache, Spectrum& tmp )
+{
+    const SpecKey key( &trc, nfft );
+    if ( cache ) {
+	Threads::Locker lckr( cachelock_ );
+	auto it = specidx_.find( key );
+	if ( it != specidx_.end() )
+	    return spectra_[it->second];
+    }
+
+    const int n = trc.size();
+    ws.trc_.assign( nfft, 0.0 );
+    double sumsq = 0.0;
+    for ( int idt=0; idt<n; idt++ ) {
+	const float val = trc.get( idt, 0 );
+	if ( mIsUdf(val) )
+	    continue;
+	ws.trc_[idt] = val;
+	sumsq += double(val) * double(val);
     }
-    double sumAA = A.head(n).norm();
-    double sumBB = B.head(n).norm();
-    if (mIsZero(sumAA, mDefEps) || mIsZero(sumBB, mDefEps)) {
-	zdiff = 0.0;
-	quality = 0.0;
+    ws.fft_.fwd( ws.spec_, ws.trc_ );
+
+    tmp.nfft_ = nfft;
+    tmp.norm_ = Math::Sqrt( sumsq );
+    tmp.vals_.assign( ws.spec_.begin(), ws.spec_.end() );
+
+    if ( !cache )
+	return &tmp;
+
+    const od_int64 nrbytes = tmp.vals_.size() * sizeof(std::complex<double>);
+    Threads::Locker lckr( cachelock_ );
+    auto it = specidx_.find( key );
+    if ( it != specidx_.end() )
+	return spectra_[it->second];
+    if ( cachesize_ + nrbytes > maxcachesize_ )
+	return &tmp;
+
+    Spectrum* spec = new Spectrum( tmp );
+    specidx_[key] = spectra_.size();
+    spectra_ += spec;
+    cachesize_ += nrbytes;
+    return spec;
+}
+
+bool MistieCorrelator::compute( const SeisTrc& trcA, const SeisTrc& trcB, float maxshift,
+				float& zdiff, float& phasediff, float& ampdiff, float& quality,
+				int threadid, bool cacheA, bool cacheB )
+{
+    return correlate( trcA, trcB, maxshift, true, zdiff, phasediff, ampdiff, quality,
+		      threadid, cacheA, cacheB );
+}
+
+bool MistieCorrelator::compute( const SeisTrc& trcA, const SeisTrc& trcB, float maxshift,
+				float& zdiff, float& quality,
+				int threadid, bool cacheA, bool cacheB )
+{
+    float phasediff, ampdiff;
+    return correlate( trcA, trcB, maxshift, false, zdiff, phasediff, ampdiff, quality,
+		      threadid, cacheA, cacheB );
+}
+
+bool MistieCorrelator::correlate( const SeisTrc& trcA, const SeisTrc& trcB, float maxshift,
+				  bool analytic, float& zdiff, float& phasediff,
+				  float& ampdiff, float& quality, int threadid,
+				  bool cacheA, bool cacheB )
+{
+    zdiff = 0.0;
+    phasediff = 0.0;
+    ampdiff = 1.0;
+    quality = 0.0;
+
+    const int n = mMAX(trcA.size(), trcB.size());
+    if ( n < 2 || !workspaces_.validIdx(threadid) )
+	return false;
+
+    Workspace& ws = *workspaces_[threadid];
+    const int nfft = fftSize( n );
+    const int half = nfft/2;
+    const float dt = trcA.info().sampling.step;
+
+    const Spectrum* Af = getSpectrum( ws, trcA, nfft, cacheA, ws.tmpA_ );
+    const Spectrum* Bf = getSpectrum( ws, trcB, nfft, cacheB, ws.tmpB_ );
+    const double sumAA = Af->norm_;
+    const double sumBB = Bf->norm_;
+    if (mIsZero(sumAA, mDefEps) || mIsZero(sumBB, mDefEps))
 	return false;
+
+    if ( analytic ) {
+	// Cross spectrum with the negative frequencies zeroed gives the analytic correlation
+	ws.ccf_.assign( nfft, std::complex<double>(0.0, 0.0) );
+	for ( int idx=0; idx<=half; idx++ ) {
+	    const double wt = idx==0 || idx==half ? 1.0 : 2.0;
+	    ws.ccf_[idx] = wt * Bf->vals_[idx] * std::conj( Af->vals_[idx] );
+	}
+	ws.fft_.inv( ws.as_, ws.ccf_ );
+	ws.cc_.resize( nfft );
+	for ( int idx=0; idx<nfft; idx++ )
+	    ws.cc_[idx] = std::abs( ws.as_[idx] );
+    } else {
+	ws.ccf_.resize( half+1 );
+	for ( int idx=0; idx<=half; idx++ )
+	    ws.ccf_[idx] = Bf->vals_[idx] * std::conj( Af->vals_[idx] );
+	ws.fft_.inv( ws.cc_, ws.ccf_, nfft );
     }
 
-    Eigen::VectorXcd Af, Bf, CCf, AS;
-    Eigen::VectorXd CC, H;
-    fft.fwd(Af,A);
-    fft.fwd(Bf,B);
-    CCf = (Bf.array() * Eigen::conj(Af.array())).matrix();
-    fft.inv(CC,CCf);
-    Eigen::MatrixXd::Index maxIndex;
+    std::vector<double>& CC = ws.cc_;
     int maxlag = maxshift/dt;
-    CC.segment(maxlag,nfft-2*maxlag) *= 0.0;
-    CC.maxCoeff(&maxIndex);
+    maxlag = mMIN(mMAX(maxlag, 0), half);
+    for ( int idx=maxlag; idx<nfft-maxlag; idx++ )
+	CC[idx] = 0.0;
+    int maxIndex = 0;
+    for ( int idx=1; idx<nfft; idx++ ) {
+	if ( CC[idx] > CC[maxIndex] )
+	    maxIndex = idx;
+    }
     int il = maxIndex-1;
     int ir = maxIndex+1;
     if (maxIndex==0)
 	il = nfft-1;
     else if (maxIndex==nfft-1)
 	ir = 0;
-    float cp = (CC(il)-CC(ir))/(2.0*CC(il)-4.0*CC(maxIndex)+2.0*CC(ir));
-    quality = (CC(maxIndex) - 0.25 * (CC(il) - CC(ir)) * cp)/(sumAA*sumBB);
+    float cp = (CC[il]-CC[ir])/(2.0*CC[il]-4.0*CC[maxIndex]+2.0*CC[ir]);
+    quality = (CC[maxIndex] - 0.25 * (CC[il] - CC[ir]) * cp)/(sumAA*sumBB);
     quality = quality > 1.0 ? 1.0 : quality;
-    zdiff = (maxIndex < n ? float(maxIndex)+cp : float(maxIndex-nfft)+cp)*dt*SI().showZ2UserFactor();;
+    zdiff = (maxIndex < half ? float(maxIndex)+cp : float(maxIndex-nfft)+cp)*dt*SI().showZ2UserFactor();
+    if ( !analytic )
+	return true;
+
+    ampdiff = sumBB/sumAA;
+    float p0 = std::arg(ws.as_[maxIndex]);
+    float p1 = cp>=0.0 ? std::arg(ws.as_[ir]) : std::arg(ws.as_[il]);
+    p1 = p1-p0>M_PI ? p1-M_2PI : p1-p0<-M_PI ? p1+M_2PI : p1;
+    phasediff = Math::toDegrees(cp>=0.0 ? (p1-p0)*cp+p0 :(p0-p1)*cp+p0) ;
     return true;
 }
+
+// The free functions share one correlator per calling thread, so FFT plans and scratch
+// vectors are kept between calls. Nothing is cached, callers that want the spectrum cache
+// need their own MistieCorrelator.
+static MistieCorrelator& threadCorrelator()
+{
+    static thread_local MistieCorrelator correlator;
+    return correlator;
+}
+
+bool computeMistie(const SeisTrc& trcA, const SeisTrc& trcB, float maxshift, float& zdiff, float& phasediff, float& ampdiff, float&  quality)
+{
+    return threadCorrelator().compute( trcA, trcB, maxshift, zdiff, phasediff, ampdiff,
+				       quality );
+}
+
+bool computeMistie(const SeisTrc& trcA, const SeisTrc& trcB, float maxshift, float& zdiff, float&  quality)
+{
+    return threadCorrelator().compute( trcA, trcB, maxshift, zdiff, quality );
+}
@@ -1,9 +1,72 @@
 #ifndef trcanalysis_h
 #define trcanalysis_h
 
+#include "mistiemod.h"
+#include "manobjectset.h"
+#include "threadlock.h"
+
+#include <map>
+
 class SeisTrc;
 
+// Use one MistieCorrelator per calling thread, without the spectrum cache
 bool    computeMistie(const SeisTrc& trcA, const SeisTrc& trcB, float maxshift, float& zdiff, float& phasediff, float& ampdiff, float&  quality);
 bool    computeMistie(const SeisTrc& trcA, const SeisTrc& trcB, float maxshift, float& zdiff, float&  quality);
 
+/*!
+\brief Reusable FFT cross-correlation engine for mistie estimation.
+
+Each worker thread gets its own workspace holding an FFT object, which keeps its plans per
+length, and the scratch vectors, so nothing is allocated once the sizes have been seen.
+Traces are zero padded to a power of two of at least twice their length and only half
+spectra are used.
+
+Spectra of traces flagged as cacheable are kept, keyed on the trace address and FFT length,
+so a trace taking part in several intersections is only transformed once. A cacheable trace
+must stay alive and unchanged until clearCache() or destruction. The cache stops growing at
+maxCacheSize() bytes.
+*/
+
+mExpClass(Mistie) MistieCorrelator
+{
+public:
+			MistieCorrelator(int nrthreads=1);
+			~MistieCorrelator();
+
+    void		setNrThreads(int);
+    int			nrThreads() const	{ return workspaces_.size(); }
+
+    void		setMaxCacheSize(od_int64 nrbytes);
+    od_int64		maxCacheSize() const	{ return maxcachesize_; }
+    void		clearCache();
+
+    bool		compute(const SeisTrc& trcA, const SeisTrc& trcB, float maxshift,
+				float& zdiff, float& phasediff, float& ampdiff, float& quality,
+				int threadid=0, bool cacheA=false, bool cacheB=false);
+    bool		compute(const SeisTrc& trcA, const SeisTrc& trcB, float maxshift,
+				float& zdiff, float& quality,
+				int threadid=0, bool cacheA=false, bool cacheB=false);
+
+    static int		fftSize(int nrsamples);
+
+protected:
+    struct Spectrum;
+    struct Workspace;
+    typedef std::pair<const SeisTrc*,int> SpecKey;
+
+    ManagedObjectSet<Workspace>	workspaces_;
+    ManagedObjectSet<Spectrum>	spectra_;
+    std::map<SpecKey,int>	specidx_;
+    od_int64			cachesize_ = 0;
+    od_int64			maxcachesize_;
+    Threads::Lock		cachelock_;
+
+    const Spectrum*	getSpectrum(Workspace&, const SeisTrc&, int nfft,
+				    bool cache, Spectrum& tmp);
+    bool		correlate(const SeisTrc& trcA, const SeisTrc& trcB, float maxshift,
+				  bool analytic, float& zdiff, float& phasediff,
+				  float& ampdiff, float& quality, int threadid,
+				  bool cacheA, bool cacheB);
+};
+
 #endif
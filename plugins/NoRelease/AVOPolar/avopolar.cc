@@ -9,6 +9,7 @@
 #include "survinfo.h"
 #include <math.h>
 #include "arrayndimpl.h"
+#include "tracegather.h"
 #include "errmsg.h"
 #include "bufstring.h"
 
@@ -185,23 +186,17 @@ bool AVOPolar::computeDataNormal( const DataHolder& output, const BinID& relpos,
 {
     const int sz = sampgateBG_.width() + nrsamples;
     const int ntraces = trcpos_.size();
+    auto getintercept = [&](const DataHolder& dh, int sampidx)
+                        { return getInputValue(dh, intercept_idx_, sampidx, z0); };
+    auto getgradient = [&](const DataHolder& dh, int sampidx)
+                        { return getInputValue(dh, gradient_idx_, sampidx, z0); };
     Array2DImpl<float> intercept(ntraces, sz);
-    for (int trcidx=0; trcidx<ntraces; trcidx++) {
-        const DataHolder* data = intercept_[trcidx];
-        for (int idx=0; idx<sz; idx++) {
-            float val = getInputValue(*data, intercept_idx_, sampgateBG_.start+idx, z0);
-            intercept.set(trcidx, idx, mIsUdf(val)?0.0f:val);
-        }
-    }
+    wmGather::gatherTraces(intercept_, intercept_idx_, z0, sampgateBG_.start, sz,
+                           intercept.getData(), sz, getintercept);
     
     Array2DImpl<float> gradient(ntraces, sz);
-    for (int trcidx=0; trcidx<ntraces; trcidx++) {
-        const DataHolder* data = gradient_[trcidx];
-        for (int idx=0; idx<sz; idx++) {
-            float val = getInputValue(*data, gradient_idx_, sampgateBG_.start+idx, z0);
-            gradient.set(trcidx, idx, mIsUdf(val)?0.0f:val);
-        }
-    }
+    wmGather::gatherTraces(gradient_, gradient_idx_, z0, sampgateBG_.start, sz,
+                           gradient.getData(), sz, getgradient);
     Array1DImpl<float> result(0);
     computeBackgroundAngle( intercept, gradient, result );
     for (int idx=0; idx<nrsamples; idx++)
@@ -255,23 +250,17 @@ bool AVOPolar::computeDataEigen( const DataHolder& output, const BinID& relpos,
 {
     const int sz = sampgateBG_.width() + nrsamples;
     const int ntraces = trcpos_.size();
+    auto getintercept = [&](const DataHolder& dh, int sampidx)
+                        { return getInputValue(dh, intercept_idx_, sampidx, z0); };
+    auto getgradient = [&](const DataHolder& dh, int sampidx)
+                        { return getInputValue(dh, gradient_idx_, sampidx, z0); };
     Eigen::ArrayXXd A(sz, ntraces);
-    for (int trcidx=0; trcidx<ntraces; trcidx++) {
-        const DataHolder* data = intercept_[trcidx];
-        for (int idx=0; idx<sz; idx++) {
-            float val = getInputValue(*data, intercept_idx_, sampgateBG_.start+idx, z0);
-            A(idx, trcidx) = mIsUdf(val)?0.0f:val;
-        }
-    }
+    wmGather::gatherTraces(intercept_, intercept_idx_, z0, sampgateBG_.start, sz,
+                           A.data(), sz, getintercept);
     
     Eigen::ArrayXXd B(sz, ntraces);
-    for (int trcidx=0; trcidx<ntraces; trcidx++) {
-        const DataHolder* data = gradient_[trcidx];
-        for (int idx=0; idx<sz; idx++) {
-            float val = getInputValue(*data, gradient_idx_, sampgateBG_.start+idx, z0);
-            B(idx, trcidx) = mIsUdf(val)?0.0f:val;
-        }
-    }
+    wmGather::gatherTraces(gradient_, gradient_idx_, z0, sampgateBG_.start, sz,
+                           B.data(), sz, getgradient);
     
     Eigen::ArrayXd A2 = A.square().rowwise().sum();
     Eigen::ArrayXd B2 = B.square().rowwise().sum();
@@ -297,24 +286,18 @@ bool AVOPolar::computeDataArrayFire( const DataHolder& output, const BinID& relp
 {
     const int sz = sampgateBG_.width() + nrsamples;
     const int ntraces = trcpos_.size();
+    auto getintercept = [&](const DataHolder& dh, int sampidx)
+                        { return getInputValue(dh, intercept_idx_, sampidx, z0); };
+    auto getgradient = [&](const DataHolder& dh, int sampidx)
+                        { return getInputValue(dh, gradient_idx_, sampidx, z0); };
     
     double* buffer = new double[ sz * ntraces];
-    for (int trcidx=0; trcidx<ntraces; trcidx++) {
-        const DataHolder* data = intercept_[trcidx];
-        for (int idx=0; idx<sz; idx++) {
-            float val = getInputValue(*data, intercept_idx_, sampgateBG_.start+idx, z0);
-            buffer[idx+trcidx*sz] = mIsUdf(val)?0.0:val;
-        }
-    }
+    wmGather::gatherTraces(intercept_, intercept_idx_, z0, sampgateBG_.start, sz,
+                           buffer, sz, getintercept);
     af::array A( sz, ntraces, buffer );
     
-    for (int trcidx=0; trcidx<ntraces; trcidx++) {
-        const DataHolder* data = gradient_[trcidx];
-        for (int idx=0; idx<sz; idx++) {
-            float val = getInputValue(*data, gradient_idx_, sampgateBG_.start+idx, z0);
-            buffer[idx+trcidx*sz] = mIsUdf(val)?0.0:val;
-        }
-    }
+    wmGather::gatherTraces(gradient_, gradient_idx_, z0, sampgateBG_.start, sz,
+                           buffer, sz, getgradient);
     af::array B( sz,ntraces, buffer );
     delete [] buffer;
     
@@ -17,20 +17,28 @@
  -*/ 
 #include "Eigen/Core"
 
+#include <vector>
+
 namespace windowedOpsEigen{
-    
-void sum( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output )
+
+// Window sums from a prefix sum, O(n) whatever the window size
+inline void sum( const Eigen::ArrayXd& input, const int winSize, Eigen::ArrayXd& output )
 {
     int sz = input.size();
     output.resize(sz);
     int halfWinSize = (winSize-1)/2;
     
+    std::vector<double> prefix(sz+1);
+    prefix[0] = 0.0;
+    for (int idx=0; idx<sz; idx++)
+        prefix[idx+1] = prefix[idx] + input(idx);
+    
     for (int idx=0; idx<sz; idx++) {
         int beg = idx-halfWinSize;
         beg = beg<0 ? 0: beg;
-        int n = winSize;
-        n = beg+n>=sz ? sz-beg : n;
-        output(idx) = input.segment(beg,n).sum();
+        int end = beg + winSize;
+        end = end>sz ? sz : end;
+        output(idx) = prefix[end] - prefix[beg];
     }
 } 
 
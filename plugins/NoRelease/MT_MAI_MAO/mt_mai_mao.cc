@@ -9,6 +9,7 @@
 #include "survinfo.h"
 #include <math.h>
 #include "arrayndimpl.h"
+#include "tracegather.h"
 #include "errmsg.h"
 #include "bufstring.h"
 
@@ -165,33 +166,24 @@ bool MT_MAI_MAO::computeData( const DataHolder& output, const BinID& relpos, int
         
         const int sz = sampgate_.width() + nrsamples;
         const int ntraces = trcpos_.size();
+        auto getinput1 = [&](const DataHolder& dh, int sampidx)
+                        { return getInputValue(dh, input_1_idx_, sampidx, z0); };
+        auto getinput2 = [&](const DataHolder& dh, int sampidx)
+                        { return getInputValue(dh, input_2_idx_, sampidx, z0); };
+        auto getinput3 = [&](const DataHolder& dh, int sampidx)
+                        { return getInputValue(dh, input_3_idx_, sampidx, z0); };
         
         Array2DImpl<float> inp1(ntraces, sz);
-        for (int trcidx=0; trcidx<ntraces; trcidx++) {
-            const DataHolder* data = input_1_[trcidx];
-            for (int idx=0; idx<sz; idx++) {
-                float val = getInputValue(*data, input_1_idx_, sampgate_.start+idx, z0);
-                inp1.set(trcidx, idx, mIsUdf(val)?0.0f:val);
-            }
-        }
+        wmGather::gatherTraces(input_1_, input_1_idx_, z0, sampgate_.start, sz,
+                               inp1.getData(), sz, getinput1);
         
         Array2DImpl<float> inp2(ntraces, sz);
-        for (int trcidx=0; trcidx<ntraces; trcidx++) {
-            const DataHolder* data = input_2_[trcidx];
-            for (int idx=0; idx<sz; idx++) {
-                float val = getInputValue(*data, input_2_idx_, sampgate_.start+idx, z0);
-                inp2.set(trcidx, idx, mIsUdf(val)?0.0f:val);
-            }
-        }
+        wmGather::gatherTraces(input_2_, input_2_idx_, z0, sampgate_.start, sz,
+                               inp2.getData(), sz, getinput2);
         
         Array2DImpl<float> inp3(ntraces, sz);   // Add more/less as required
-        for (int trcidx=0; trcidx<ntraces; trcidx++) {
-            const DataHolder* data = input_3_[trcidx];
-            for (int idx=0; idx<sz; idx++) {
-                float val = getInputValue(*data, input_3_idx_, sampgate_.start+idx, z0);
-                inp3.set(trcidx, idx, mIsUdf(val)?0.0f:val);
-            }
-        }
+        wmGather::gatherTraces(input_3_, input_3_idx_, z0, sampgate_.start, sz,
+                               inp3.getData(), sz, getinput3);
         
         Array1DImpl<float> result(0);
         if (isOutputEnabled(Outputs::Output_1)) {
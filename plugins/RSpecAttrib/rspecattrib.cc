@@ -19,6 +19,7 @@
 
 #include "rspecattrib.h"
 #include <complex>
+#include <vector>
 #include "eigenfilt.h"
 
 #include "attribdataholder.h"
@@ -160,12 +161,96 @@ void rspec4single(const Eigen::ArrayXd& input, double dt, double omega, double f
     spec =  abs(work);
 }
     
+/*
+ * Bank of fixed order complex recursive filters with real input, one filter per frequency,
+ *   y[i] = sum_k num[k] x[i-k] - sum_j den[j] y[i-1-j],  k<NB, j<NA
+ * as EigenFilter::iirfilt. All frequencies are stepped together one sample at a time with
+ * coefficients and state stored frequency fastest, real and imaginary parts apart, so the
+ * inner loops over frequency vectorize. Only the last NA outputs of each filter are kept,
+ * in a ring indexed by sample number.
+ */
+template <int NB, int NA>
+class RecursiveFilterBank
+{
+public:
+    RecursiveFilterBank( int nf )
+        : nf_(nf)
+        , numr_(NB*nf), numi_(NB*nf), denr_(NA*nf), deni_(NA*nf)
+        , yr_(NA*nf, 0.0), yi_(NA*nf, 0.0)
+        , outr_(nf), outi_(nf)
+    {}
+
+    void setCoeffs( int ifreq, const std::complex<double>* num, const std::complex<double>* den )
+    {
+        for (int k=0; k<NB; k++) {
+            numr_[k*nf_+ifreq] = num[k].real();
+            numi_[k*nf_+ifreq] = num[k].imag();
+        }
+        for (int j=0; j<NA; j++) {
+            denr_[j*nf_+ifreq] = den[j].real();
+            deni_[j*nf_+ifreq] = den[j].imag();
+        }
+    }
+
+    // Advance all filters to sample isamp, x[k] being the input at isamp-k
+    void step( int isamp, const double* x )
+    {
+        double* outr = outr_.data();
+        double* outi = outi_.data();
+        for (int ifreq=0; ifreq<nf_; ifreq++) {
+            outr[ifreq] = 0.0;
+            outi[ifreq] = 0.0;
+        }
+        for (int k=0; k<NB; k++) {
+            const double* nr = numr_.data() + k*nf_;
+            const double* ni = numi_.data() + k*nf_;
+            const double xk = x[k];
+            for (int ifreq=0; ifreq<nf_; ifreq++) {
+                outr[ifreq] += nr[ifreq]*xk;
+                outi[ifreq] += ni[ifreq]*xk;
+            }
+        }
+        for (int j=0; j<NA; j++) {
+            const int slot = ((isamp-1-j)%NA + NA) % NA;
+            const double* dr = denr_.data() + j*nf_;
+            const double* di = deni_.data() + j*nf_;
+            const double* yr = yr_.data() + slot*nf_;
+            const double* yi = yi_.data() + slot*nf_;
+            for (int ifreq=0; ifreq<nf_; ifreq++) {
+                outr[ifreq] -= dr[ifreq]*yr[ifreq] - di[ifreq]*yi[ifreq];
+                outi[ifreq] -= dr[ifreq]*yi[ifreq] + di[ifreq]*yr[ifreq];
+            }
+        }
+        const int slot = isamp % NA;
+        std::copy( outr_.begin(), outr_.end(), yr_.begin()+slot*nf_ );
+        std::copy( outi_.begin(), outi_.end(), yi_.begin()+slot*nf_ );
+    }
+
+    const double*   real() const    { return outr_.data(); }
+    const double*   imag() const    { return outi_.data(); }
+
+protected:
+    int                 nf_;
+    std::vector<double> numr_, numi_, denr_, deni_;
+    std::vector<double> yr_, yi_;
+    std::vector<double> outr_, outi_;
+};
+
+/*
+ * Reassigned recursive spectrum. The spectrum filter w, its time derivative filter w_d and
+ * time weighted filter w_t are run as three filter banks over all frequencies in one pass
+ * down the trace and each sample's energy |w| is added straight to its reassigned time and
+ * frequency in spec.
+ */
 void rrspec4(const Eigen::ArrayXd& input, double dt, double fstep, const Eigen::ArrayXd& freq, Eigen::ArrayXXd& spec)
 {
     int ns = input.size();
     int nf = freq.size();
     spec.resize(ns,nf);
     spec.setZero();
+    if (ns==0 || nf==0)
+        return;
+
     double sigma_p = (sqrt(fstep)*6)/(sqrt(2*M_PI*dt)*27.0*exp(-3.0));
     double sigma_pT = sigma_p*dt;
     double sigma_pT2 = sigma_pT*sigma_pT;
@@ -174,16 +259,8 @@ void rrspec4(const Eigen::ArrayXd& input, double dt, double fstep, const Eigen::
     double sigma_p4T3 = sigma_p*sigma_pT3;
     double sigma_p4T5 = dt*sigma_pT4;
     
-    Eigen::ArrayXcd num(4), dnum(4);
-    Eigen::ArrayXcd den(4), dden(4);
-    Eigen::ArrayXcd tnum(5);
-    Eigen::ArrayXcd tden(5);
-    Eigen::ArrayXcd cinput = input;
-    Eigen::ArrayXcd tmp(ns);
-    Eigen::ArrayXXcd w(ns, nf);
-    Eigen::ArrayXXcd w_d(ns, nf);
-    Eigen::ArrayXXcd w_t(ns, nf);
-    
+    RecursiveFilterBank<4,4> wbank(nf), wdbank(nf);
+    RecursiveFilterBank<5,5> wtbank(nf);
     for (int ifreq=0; ifreq<nf; ifreq++) {
         double omega_p = 2.0*M_PI*freq[ifreq];
         std::complex<double> p(-sigma_p, omega_p);
@@ -193,32 +270,46 @@ void rrspec4(const Eigen::ArrayXd& input, double dt, double fstep, const Eigen::
         std::complex<double> a3 = a2*a;
         std::complex<double> a4 = a3*a;
             
-        num << 0.0, sigma_pT4*a/6.0, sigma_pT4*a2*2.0/3.0, sigma_pT4*a3/6.0;
-        den << -4.0*a, 6.0*a2, -4.0*a3, a4;
-        dnum << 0.0, sigma_p4T3*a*(3.0+pT)/6.0, sigma_p4T3*a2*pT*2.0/3.0, -sigma_p4T3*a3*(3.0-pT)/6.0;
-        dden = den;
-        tnum << 0.0, sigma_p4T5*a/6.0, sigma_p4T5*a2*11.0/6.0, sigma_p4T5*a3*11.0/6.0, sigma_p4T5*a4/6.0;
-        tden << -5.0*a, 10.0*a2, -10.0*a3, 5.0*a4, -a4*a;
-        EigenFilter::iirfilt(cinput, num, den, tmp);
-        w.col(ifreq) = tmp;
-        EigenFilter::iirfilt(cinput, dnum, dden, tmp);
-        w_d.col(ifreq) = tmp;
-        EigenFilter::iirfilt(cinput, tnum, tden, tmp);
-        w_t.col(ifreq) = tmp;
+        const std::complex<double> num[] = { 0.0, sigma_pT4*a/6.0, sigma_pT4*a2*2.0/3.0, sigma_pT4*a3/6.0 };
+        const std::complex<double> den[] = { -4.0*a, 6.0*a2, -4.0*a3, a4 };
+        const std::complex<double> dnum[] = { 0.0, sigma_p4T3*a*(3.0+pT)/6.0, sigma_p4T3*a2*pT*2.0/3.0, -sigma_p4T3*a3*(3.0-pT)/6.0 };
+        const std::complex<double> tnum[] = { 0.0, sigma_p4T5*a/6.0, sigma_p4T5*a2*11.0/6.0, sigma_p4T5*a3*11.0/6.0, sigma_p4T5*a4/6.0 };
+        const std::complex<double> tden[] = { -5.0*a, 10.0*a2, -10.0*a3, 5.0*a4, -a4*a };
+        wbank.setCoeffs( ifreq, num, den );
+        wdbank.setCoeffs( ifreq, dnum, den );
+        wtbank.setCoeffs( ifreq, tnum, tden );
     }
-    Eigen::ArrayXXd rtfr = abs(w);
-    w += std::complex<double>(mDefEps, mDefEps);
-    w_t /= w;
-    w_d /= w;
-    double f0 = freq[0];
+
+    const double f0 = freq[0];
+    double x[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
     for (int idx=0; idx<ns; idx++) {
+        for (int k=4; k>0; k--)
+            x[k] = x[k-1];
+        x[0] = input[idx];
+        wbank.step( idx, x );
+        wdbank.step( idx, x );
+        wtbank.step( idx, x );
+
+        const double* wr = wbank.real();
+        const double* wi = wbank.imag();
+        const double* wdr = wdbank.real();
+        const double* wdi = wdbank.imag();
+        const double* wtr = wtbank.real();
+        const double* wti = wtbank.imag();
         for (int ifreq=0; ifreq<nf; ifreq++) {
-            int that = idx-mNINT32(real(w_t(idx, ifreq))/dt);
+            const double rtfr = sqrt(wr[ifreq]*wr[ifreq] + wi[ifreq]*wi[ifreq]);
+            const double cr = wr[ifreq]+mDefEps;
+            const double ci = wi[ifreq]+mDefEps;
+            const double norm = cr*cr + ci*ci;
+            const double tshift = (wtr[ifreq]*cr + wti[ifreq]*ci)/norm;
+            const double omega = (wdi[ifreq]*cr - wdr[ifreq]*ci)/norm;
+
+            int that = idx-mNINT32(tshift/dt);
             that = mMIN(mMAX(that, 0), ns-1);
             
-            int fhat = mNINT32((imag(w_d(idx,ifreq))/M_2PI - f0)/fstep);
+            int fhat = mNINT32((omega/M_2PI - f0)/fstep);
             fhat = mMIN(mMAX(fhat, 0), nf-1);
-            spec(that, fhat) += rtfr(idx, ifreq);
+            spec(that, fhat) += rtfr;
         }
     }
 }
@@ -41,6 +41,7 @@ static const char* outputstr[] =
     "Crossplot Angle",
 	"Crossplot Deviation",
 	"AVO Class",
+	"Fluid, Lithology and Class",
     0
 };
 
@@ -95,7 +96,7 @@ void uiAVOAttrib::actionSel( CallBacker* )
     intercept_devfld_->display( outval==AVOAttrib::CrossplotAngle || outval==AVOAttrib::CrossplotDeviation );
 	gradient_devfld_->display( outval==AVOAttrib::CrossplotAngle || outval==AVOAttrib::CrossplotDeviation );
 	correlationfld_->display( outval==AVOAttrib::CrossplotDeviation );
-	class2fld_->display( outval==AVOAttrib::AVOClass );
+	class2fld_->display( outval==AVOAttrib::AVOClass || outval==AVOAttrib::FluidLithClass );
 }
 
 
@@ -144,7 +145,7 @@ bool uiAVOAttrib::getParameters( Desc& desc )
 		mSetFloat( AVOAttrib::gradient_devStr(), gradient_devfld_->getFValue() );
 		mSetFloat( AVOAttrib::correlationStr(), correlationfld_->getFValue() );
 	}
-	if ( outval == AVOAttrib::AVOClass )
+	if ( outval == AVOAttrib::AVOClass || outval == AVOAttrib::FluidLithClass )
 		mSetFloat( AVOAttrib::class2Str(), class2fld_->getFValue() );
 
     return true;
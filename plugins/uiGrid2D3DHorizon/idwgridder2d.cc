@@ -5,15 +5,17 @@
 
 #include "nanoflann_extra.h"
 
+#include <algorithm>
 
-mDefParallelCalc2Pars( IDWGlobalInterpolator, od_static_tr("IDWGlobalInterpolator","IDW global interpolation"),
-		       const wmIDWGridder2D*, interp, Threads::Lock, lock )
+
+mDefParallelCalc1Par( IDWGlobalInterpolator, od_static_tr("IDWGlobalInterpolator","IDW global interpolation"),
+		       const wmIDWGridder2D*, interp )
 mDefParallelCalcBody( 
 const TypeSet<Coord>& locs_ = interp_->binLocs_;
 const TypeSet<float>& vals_ = interp_->vals_;
 const TrcKeySampling& hs_ = interp_->hs_;
 Array2DImpl<float>* grid_ = interp_->grid_;
-TypeSet<od_int64> interpidx_ = interp_->interpidx_;
+const TypeSet<od_int64>& interpidx_ = interp_->interpidx_;
 ,
 Task::Control state = getState();
 if (state==Task::Stop)
@@ -43,18 +45,17 @@ for (int i=0; i<locs_.size(); i++) {
 }
 
 float fval = mIsZero(wgtsum, mDefEpsD) ? mUdf(float) : val/wgtsum;
-Threads::Locker lckr( lock_ );
 grid_->set(ix, iy, fval);
 , )
 
-mDefParallelCalc3Pars( IDWKNNInterpolator, od_static_tr("IDWKNNInterpolator","IDW KNN interpolation "),
-		       const wmIDWGridder2D*, interp, CoordKDTree&, index, Threads::Lock, lock )
+mDefParallelCalc2Pars( IDWKNNInterpolator, od_static_tr("IDWKNNInterpolator","IDW KNN interpolation "),
+		       const wmIDWGridder2D*, interp, CoordKDTree&, index )
 mDefParallelCalcBody(
 const TypeSet<Coord>& locs_ = interp_->binLocs_;
 const TypeSet<float>& vals_ = interp_->vals_;
 const TrcKeySampling& hs_ = interp_->hs_;
 Array2DImpl<float>* grid_ = interp_->grid_;
-TypeSet<od_int64> interpidx_ = interp_->interpidx_;
+const TypeSet<od_int64>& interpidx_ = interp_->interpidx_;
 std::vector<size_t> resindex(interp_->maxpoints_);
 std::vector<Pos::Ordinate_Type> distsq(interp_->maxpoints_);
 Pos::Ordinate_Type pt[2];
@@ -92,20 +93,196 @@ for (int i=0; i<nrpoints; i++) {
 }
 
 float fval = mIsZero(wgtsum, mDefEpsD) ? mUdf(float) : val/wgtsum;
-Threads::Locker lckr( lock_ );
+grid_->set(ix, iy, fval);
+, )
+
+/*
+  Binary kd-tree over the data points for approximate global IDW. Each node keeps the
+  centroid, the number of points, the sum of the values and the first moment of the
+  values about the centroid. A node far enough from the grid node, relative to its
+  extent, is summed as one weight at its centroid with a first order correction for
+  the value distribution, giving O(log M) work per grid node instead of O(M).
+*/
+
+class IDWTree
+{
+public:
+    IDWTree( const TypeSet<Coord>& locs, const TypeSet<float>& vals, float tolerance )
+    {
+	// tolerance is the error relative to the data value range, the opening
+	// criterion theta^2 = 2.5*tolerance keeps it within the tolerance also for
+	// clustered data with a trend
+	theta2_ = mMIN( 2.5*tolerance, 0.25 );
+	const int nrpts = locs.size();
+	TypeSet<int> order( nrpts, 0 );
+	for (int idx=0; idx<nrpts; idx++)
+	    order[idx] = idx;
+
+	if (nrpts>0)
+	    buildNode( locs, vals, order, 0, nrpts );
+
+	pos_.setSize( nrpts, Coord() );
+	vals_.setSize( nrpts, 0.0 );
+	for (int idx=0; idx<nrpts; idx++) {
+	    pos_[idx] = locs[order[idx]];
+	    vals_[idx] = vals[order[idx]];
+	}
+    }
+
+    bool getSums( const Coord& gridPos, const wmGridder2D* interp, double& val,
+		  double& wgtsum ) const
+    {
+	val = wgtsum = 0.0;
+	if (nodes_.isEmpty())
+	    return false;
+
+	const wmFaultIndex2D& faults = interp->faultIndex();
+	const bool hasfaults = !faults.isEmpty();
+	int stack[cMaxDepth];
+	int nrstack = 0;
+	stack[nrstack++] = 0;
+	while (nrstack>0) {
+	    const Node& node = nodes_[stack[--nrstack]];
+	    const double ux = node.cx_ - gridPos.x;
+	    const double uy = node.cy_ - gridPos.y;
+	    const double d = ux*ux + uy*uy;
+	    if (node.rsq_<theta2_*d && (!hasfaults || !faults.mayCross(
+			Interval<double>(mMIN(node.xrg_.start,gridPos.x), mMAX(node.xrg_.stop,gridPos.x)),
+			Interval<double>(mMIN(node.yrg_.start,gridPos.y), mMAX(node.yrg_.stop,gridPos.y))))) {
+		const double wgt = 1.0 / (d+0.001);
+		wgtsum += node.nrpts_ * wgt;
+		val += node.sumval_*wgt - 2.0*wgt*wgt*(ux*node.momx_ + uy*node.momy_);
+		continue;
+	    }
+
+	    if (node.child1_<0) {
+		for (int idx=node.start_; idx<node.stop_; idx++) {
+		    if (hasfaults && interp->faultBetween(gridPos, pos_[idx]))
+			continue;
+
+		    const double wgt = 1.0 / (pos_[idx].sqHorDistTo(gridPos)+0.001);
+		    val += vals_[idx] * wgt;
+		    wgtsum += wgt;
+		}
+		continue;
+	    }
+
+	    stack[nrstack++] = node.child2_;
+	    stack[nrstack++] = node.child1_;
+	}
+	return true;
+    }
+
+protected:
+    struct Node
+    {
+	Interval<double>	xrg_;
+	Interval<double>	yrg_;
+	double			cx_, cy_;
+	double			rsq_;
+	double			nrpts_;
+	double			sumval_;
+	double			momx_, momy_;
+	int			start_, stop_;
+	int			child1_ = -1;
+	int			child2_ = -1;
+    };
+
+    static const int	cLeafSize = 8;
+    static const int	cMaxDepth = 128;
+
+    int buildNode( const TypeSet<Coord>& locs, const TypeSet<float>& vals,
+		   TypeSet<int>& order, int start, int stop )
+    {
+	Node node;
+	node.start_ = start;
+	node.stop_ = stop;
+	node.xrg_.start = node.xrg_.stop = locs[order[start]].x;
+	node.yrg_.start = node.yrg_.stop = locs[order[start]].y;
+	double sumx = 0.0, sumy = 0.0, sumval = 0.0;
+	for (int idx=start; idx<stop; idx++) {
+	    const Coord& pos = locs[order[idx]];
+	    node.xrg_.include( pos.x );
+	    node.yrg_.include( pos.y );
+	    sumx += pos.x;
+	    sumy += pos.y;
+	    sumval += vals[order[idx]];
+	}
+	node.nrpts_ = stop - start;
+	node.cx_ = sumx / node.nrpts_;
+	node.cy_ = sumy / node.nrpts_;
+	node.sumval_ = sumval;
+	node.momx_ = node.momy_ = node.rsq_ = 0.0;
+	for (int idx=start; idx<stop; idx++) {
+	    const Coord& pos = locs[order[idx]];
+	    const double dx = pos.x - node.cx_;
+	    const double dy = pos.y - node.cy_;
+	    node.momx_ += vals[order[idx]] * dx;
+	    node.momy_ += vals[order[idx]] * dy;
+	    node.rsq_ = mMAX(node.rsq_, dx*dx+dy*dy);
+	}
+
+	const int nodeidx = nodes_.size();
+	nodes_ += node;
+	if (stop-start<=cLeafSize)
+	    return nodeidx;
+
+	// Split at the median of the widest dimension
+	const int mid = (start+stop) / 2;
+	const bool alongx = node.xrg_.width()>=node.yrg_.width();
+	std::nth_element( order.arr()+start, order.arr()+mid, order.arr()+stop,
+			  [&locs,alongx]( int a, int b )
+			  { return alongx ? locs[a].x<locs[b].x : locs[a].y<locs[b].y; } );
+	const int child1 = buildNode( locs, vals, order, start, mid );
+	const int child2 = buildNode( locs, vals, order, mid, stop );
+	nodes_[nodeidx].child1_ = child1;
+	nodes_[nodeidx].child2_ = child2;
+	return nodeidx;
+    }
+
+    TypeSet<Node>	nodes_;
+    TypeSet<Coord>	pos_;
+    TypeSet<double>	vals_;
+    double		theta2_;
+};
+
+mDefParallelCalc2Pars( IDWTreeInterpolator, od_static_tr("IDWTreeInterpolator","IDW approximate global interpolation"),
+		       const wmIDWGridder2D*, interp, const IDWTree&, tree )
+mDefParallelCalcBody(
+const TrcKeySampling& hs_ = interp_->hs_;
+Array2DImpl<float>* grid_ = interp_->grid_;
+const TypeSet<od_int64>& interpidx_ = interp_->interpidx_;
+,
+Task::Control state = getState();
+if (state==Task::Stop)
+    break;
+else if (state==Task::Pause) {
+    while (getState()==Task::Pause)
+	Threads::sleep(1);
+}
+
+BinID gridBid = hs_.atIndex(interpidx_[idx]);
+int ix = hs_.inlIdx(gridBid.inl());
+int iy = hs_.crlIdx(gridBid.crl());
+Coord gridPos(gridBid.inl(), gridBid.crl());
+double val = 0.0;
+double wgtsum = 0.0;
+tree_.getSums(gridPos, interp_, val, wgtsum);
+
+float fval = mIsZero(wgtsum, mDefEpsD) ? mUdf(float) : val/wgtsum;
 grid_->set(ix, iy, fval);
 , )
 
 typedef std::vector<std::pair<size_t,Pos::Ordinate_Type>> RadiusResultSet;
 
-mDefParallelCalc3Pars( IDWLocalInterpolator, od_static_tr("IDWLocalInterpolator","IDW local interpolation"),
-		       const wmIDWGridder2D*, interp, CoordKDTree&, index, Threads::Lock, lock )
+mDefParallelCalc2Pars( IDWLocalInterpolator, od_static_tr("IDWLocalInterpolator","IDW local interpolation"),
+		       const wmIDWGridder2D*, interp, CoordKDTree&, index )
 mDefParallelCalcBody( 
 const TypeSet<Coord>& locs_ = interp_->binLocs_;
 const TypeSet<float>& vals_ = interp_->vals_;
 const TrcKeySampling& hs_ = interp_->hs_;
 Array2DImpl<float>* grid_ = interp_->grid_;
-TypeSet<od_int64> interpidx_ = interp_->interpidx_;
+const TypeSet<od_int64>& interpidx_ = interp_->interpidx_;
 RadiusResultSet result;
 Pos::Ordinate_Type srsq = interp_->searchradius_/(SI().inlDistance()+SI().crlDistance())*2.0;
 srsq *= srsq;
@@ -134,7 +311,6 @@ pt[1] = y;
 
 int nrpoints = index_.radiusSearch(&pt[0], srsq, result, params);
 if (nrpoints == 0) {
-    Threads::Locker lckr( lock_ );
     grid_->set(ix, iy, mUdf(float));
     continue;
 }
@@ -165,38 +341,53 @@ for (int i=0; i<usePos.size(); i++) {
 }
 
 float fval = mIsZero(wgtsum, mDefEpsD) ? mUdf(float) : val/wgtsum;
-Threads::Locker lckr( lock_ );
 grid_->set(ix, iy, fval);
 , )
 
 
 
+const char* wmIDWGridder2D::sKeyTolerance()	{ return "Tolerance"; }
+
 wmIDWGridder2D::wmIDWGridder2D()
+    : tolerance_(mUdf(float))
 {}
 
+bool wmIDWGridder2D::usePar(const IOPar& par)
+{
+    tolerance_ = mUdf(float);
+    par.get(sKeyTolerance(), tolerance_);
+    return wmGridder2D::usePar(par);
+}
+
 bool wmIDWGridder2D::executeGridding(TaskRunner* tr)
 {
     localInterp();
     const CoordTypeSetAdaptor coords( binLocs_ );
     CoordKDTree index( 2, coords );
-    Threads::Lock lock;
 
-    if ( mIsUdf(maxpoints_) && mIsUdf(searchradius_) ) {
-	IDWGlobalInterpolator interp( interpidx_.size(), this, lock );
+    if ( mIsUdf(maxpoints_) && mIsUdf(searchradius_) && !mIsUdf(tolerance_) ) {
+	const IDWTree tree( binLocs_, vals_, tolerance_ );
+	IDWTreeInterpolator interp( interpidx_.size(), this, tree );
+	if (tr)
+	    return TaskRunner::execute( tr, interp );
+	else
+	    interp.execute();
+    } else if ( mIsUdf(maxpoints_) && mIsUdf(searchradius_) ) {
+	IDWGlobalInterpolator interp( interpidx_.size(), this );
 	if (tr)
 	    return TaskRunner::execute( tr, interp );
 	else
 	    interp.execute();
     } else if ( !mIsUdf(maxpoints_) && mIsUdf(searchradius_) ) {
 	index.buildIndex();
-	IDWKNNInterpolator interp( interpidx_.size(), this, index, lock );
+	IDWKNNInterpolator interp( interpidx_.size(), this, index );
 	if (tr)
 	    return TaskRunner::execute( tr, interp );
 	else
 	    interp.execute();
     } else {
 	index.buildIndex();
-	IDWLocalInterpolator interp( interpidx_.size(), this, index, lock );
+	IDWLocalInterpolator interp( interpidx_.size(), this, index );
 	if (tr)
 	    return TaskRunner::execute( tr, interp );
 	else
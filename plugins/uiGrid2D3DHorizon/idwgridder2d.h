@@ -5,6 +5,7 @@
 
 class IDWGlobalInterpolator;
 class IDWLocalInterpolator;
+class IDWTreeInterpolator;
 
 class wmIDWGridder2D : public wmGridder2D
 { mODTextTranslationClass(wmIDWGridder2D);
@@ -12,11 +13,17 @@ public:
     friend class IDWGlobalInterpolator;
     friend class IDWKNNInterpolator;
     friend class IDWLocalInterpolator;
+    friend class IDWTreeInterpolator;
     
     wmIDWGridder2D();
     
     bool	executeGridding(TaskRunner*);
+    bool	usePar(const IOPar&);
+
+    static const char*	sKeyTolerance();
+
 protected:
+    float	tolerance_;
     
 };
 
@@ -86,21 +86,85 @@ protected:
 
 typedef std::vector<std::pair<size_t,Pos::Ordinate_Type>> RadiusResultSet;
 
+// Grid nodes to interpolate bucketed on square tiles of tilesize_ x tilesize_ nodes
+struct LTPSTiles
+{
+    TypeSet<int>	first_;
+    TypeSet<od_int64>	nodes_;
+};
+
+// Fit the local thin-plate spline through the binned points, weights in W
+static void solveLTPS( const wmLTPSGridder2D* interp, const AzimuthBinner& az, double srsq,
+		       Eigen::VectorXd& W, double& meanVal )
+{
+    const int nrpoints = az.size();
+    Eigen::MatrixXd M(nrpoints, nrpoints);
+    Eigen::VectorXd V(nrpoints);
+    const TypeSet<Coord>& usePos = az.posset();
+    const TypeSet<float>& useVal = az.valset();
+    for (int ii=0; ii<nrpoints; ii++) {
+	Coord loc(usePos[ii]);
+	V[ii] = useVal[ii];
+	for (int ij=ii; ij<nrpoints; ij++) {
+	    Coord q(usePos[ij]);
+	    double rsq = loc.sqHorDistTo(q)/srsq;
+	    M(ii,ij) = M(ij,ii) = interp->basis( rsq );
+	}
+    }
+    meanVal = V.mean();
+    V = V.array() - meanVal;
+
+    // The normal equations are symmetric positive definite, so LDLT is enough
+    Eigen::MatrixXd A = Eigen::MatrixXd::Identity(nrpoints,nrpoints) * 0.01;
+    A.selfadjointView<Eigen::Lower>().rankUpdate( M );
+    Eigen::VectorXd B = M * V;
+    W = A.selfadjointView<Eigen::Lower>().ldlt().solve(B);
+}
+
+// Local thin-plate spline value at one grid node from its own support points
+static bool interpolateNode( const wmLTPSGridder2D* interp, CoordKDTree& index,
+			     const TypeSet<Coord>& locs, const TypeSet<float>& vals,
+			     int maxpoints, double srsq, RadiusResultSet& result,
+			     const Coord& gridPos, double& val )
+{
+    nanoflann::SearchParams params;
+    Pos::Ordinate_Type pt[2] = { gridPos.x, gridPos.y };
+    int nrpoints = index.radiusSearch(&pt[0], srsq, result, params);
+
+    AzimuthBinner az( gridPos, 8, maxpoints );
+    for (int i=0; i<nrpoints; i++) {
+	Coord locPos(locs[result[i].first]);
+	az.addPoint( interp, locPos, vals[result[i].first], result[i].second/srsq );
+	if ( az.isFull() )
+	    break;
+    }
 
-mDefParallelCalc3Pars( LTPSInterpolator, od_static_tr("LTPSInterpolator","Local Thin-plate Spline interpolation"),
-		       const wmLTPSGridder2D*, interp, CoordKDTree&, index, Threads::Lock, lock )
+    if ( az.nrDataSectors() < 5)
+	return false;
+
+    Eigen::VectorXd W;
+    double meanVal;
+    solveLTPS( interp, az, srsq, W, meanVal );
+
+    const TypeSet<double>& useDSQ = az.dsqset();
+    val = meanVal;
+    for (int ii=0; ii<az.size(); ii++)
+	val += W[ii] * interp->basis(useDSQ[ii]);
+
+    return true;
+}
+
+mDefParallelCalc2Pars( LTPSInterpolator, od_static_tr("LTPSInterpolator","Local Thin-plate Spline interpolation"),
+		       const wmLTPSGridder2D*, interp, CoordKDTree&, index )
 mDefParallelCalcBody(
 const TypeSet<Coord>& locs_ = interp_->binLocs_;
 const TypeSet<float>& vals_ = interp_->vals_;
 const TrcKeySampling& hs_ = interp_->hs_;
 Array2DImpl<float>* grid_ = interp_->grid_;
-TypeSet<od_int64> interpidx_ = interp_->interpidx_;
+const TypeSet<od_int64>& interpidx_ = interp_->interpidx_;
 RadiusResultSet result;
 Pos::Ordinate_Type srsq = interp_->searchradius_/(SI().inlDistance()+SI().crlDistance())*2.0;
 srsq *= srsq;
-nanoflann::SearchParams params;
-Pos::Ordinate_Type pt[2];
-BufferString tmp;
 ,
 Task::Control state = getState();
 if (state==Task::Stop)
@@ -113,61 +177,142 @@ else if (state==Task::Pause) {
 BinID gridBid = hs_.atIndex(interpidx_[idx]);
 int ix = hs_.inlIdx(gridBid.inl());
 int iy = hs_.crlIdx(gridBid.crl());
-double x = gridBid.inl();
-double y = gridBid.crl();
-Coord gridPos(x, y);
-pt[0] = x;
-pt[1] = y;
-int nrpoints = index_.radiusSearch(&pt[0], srsq, result, params);
-
-AzimuthBinner az( gridPos, 8, interp_->maxpoints_ );
+Coord gridPos(gridBid.inl(), gridBid.crl());
+double val;
+if (!interpolateNode(interp_, index_, locs_, vals_, interp_->maxpoints_, srsq, result,
+		     gridPos, val))
+    continue;
+
+val += grid_->get(ix,iy);
+grid_->set(ix, iy, (float)val);
+, )
+
+/*
+  One spline per tile: the support points are binned around the tile centre out to
+  the search radius plus the half diagonal of the tile, so every node in the tile has
+  its search radius covered, and the spline is evaluated at every node of the tile.
+  Tiles within a search radius of a fault fall back to one spline per node.
+*/
+
+mDefParallelCalc3Pars( LTPSTileInterpolator, od_static_tr("LTPSTileInterpolator","Tiled Local Thin-plate Spline interpolation"),
+		       const wmLTPSGridder2D*, interp, CoordKDTree&, index, const LTPSTiles&, tiles )
+mDefParallelCalcBody(
+const TypeSet<Coord>& locs_ = interp_->binLocs_;
+const TypeSet<float>& vals_ = interp_->vals_;
+const TrcKeySampling& hs_ = interp_->hs_;
+Array2DImpl<float>* grid_ = interp_->grid_;
+RadiusResultSet result;
+Pos::Ordinate_Type srsq = interp_->searchradius_/(SI().inlDistance()+SI().crlDistance())*2.0;
+srsq *= srsq;
+const double radius = Math::Sqrt(srsq);
+nanoflann::SearchParams params;
+Pos::Ordinate_Type pt[2];
+Eigen::VectorXd W;
+,
+Task::Control state = getState();
+if (state==Task::Stop)
+    break;
+else if (state==Task::Pause) {
+    while (getState()==Task::Pause)
+	Threads::sleep(1);
+}
+
+const int firstnode = tiles_.first_[idx];
+const int stopnode = tiles_.first_[idx+1];
+if (firstnode==stopnode)
+    continue;
+
+BinID gridBid = hs_.atIndex(tiles_.nodes_[firstnode]);
+Interval<double> inlrg(gridBid.inl(), gridBid.inl());
+Interval<double> crlrg(gridBid.crl(), gridBid.crl());
+for (int inode=firstnode+1; inode<stopnode; inode++) {
+    gridBid = hs_.atIndex(tiles_.nodes_[inode]);
+    inlrg.include(gridBid.inl());
+    crlrg.include(gridBid.crl());
+}
+
+const bool pernode = interp_->faultIndex().mayCross(
+				Interval<double>(inlrg.start-radius, inlrg.stop+radius),
+				Interval<double>(crlrg.start-radius, crlrg.stop+radius));
+if (pernode) {
+    for (int inode=firstnode; inode<stopnode; inode++) {
+	gridBid = hs_.atIndex(tiles_.nodes_[inode]);
+	const int ix = hs_.inlIdx(gridBid.inl());
+	const int iy = hs_.crlIdx(gridBid.crl());
+	double val;
+	if (interpolateNode(interp_, index_, locs_, vals_, interp_->maxpoints_, srsq, result,
+			    Coord(gridBid.inl(), gridBid.crl()), val))
+	    grid_->set(ix, iy, (float)(val+grid_->get(ix,iy)));
+    }
+    continue;
+}
+
+const Coord centre(inlrg.center(), crlrg.center());
+const double tilerad = radius + 0.5*Math::Sqrt(inlrg.width()*inlrg.width() + crlrg.width()*crlrg.width());
+pt[0] = centre.x;
+pt[1] = centre.y;
+int nrpoints = index_.radiusSearch(&pt[0], tilerad*tilerad, result, params);
+
+AzimuthBinner az( centre, 8, wmLTPSGridder2D::cTileSectorFactor*interp_->maxpoints_ );
 for (int i=0; i<nrpoints; i++) {
     Coord locPos(locs_[result[i].first]);
     az.addPoint( interp_, locPos, vals_[result[i].first], result[i].second/srsq );
     if ( az.isFull() )
 	break;
 }
-
-nrpoints = az.size();
-
-if ( az.nrDataSectors() < 5)
+if (az.nrDataSectors() < 5)
     continue;
 
-Eigen::MatrixXd M = Eigen::MatrixXd::Zero(nrpoints, nrpoints);
-Eigen::VectorXd V = Eigen::VectorXd::Zero(nrpoints);
-Eigen::ArrayXd  dsq(nrpoints);
+double meanVal;
+solveLTPS( interp_, az, srsq, W, meanVal );
 
+// Each node still needs data in 5 of its 8 sectors within the search radius
 const TypeSet<Coord>& usePos = az.posset();
-const TypeSet<float>& useVal = az.valset();
-const TypeSet<double>& useDSQ = az.dsqset();
-for (int ii=0; ii<nrpoints; ii++) {
-    Coord loc(usePos[ii]);
-    dsq[ii] = interp_->basis(useDSQ[ii]);
-    V[ii] = useVal[ii];
-    for (int ij=ii; ij<nrpoints; ij++) {
-	Coord q(usePos[ij]);
-	double rsq = loc.sqHorDistTo(q)/srsq;
-	M(ii,ij) = M(ij,ii) = interp_->basis( rsq );
+const double sectorsize = M_2PI/8.0;
+for (int inode=firstnode; inode<stopnode; inode++) {
+    gridBid = hs_.atIndex(tiles_.nodes_[inode]);
+    const Coord gridPos(gridBid.inl(), gridBid.crl());
+    double val = meanVal;
+    int sectors = 0;
+    for (int ii=0; ii<usePos.size(); ii++) {
+	const double rsq = usePos[ii].sqHorDistTo(gridPos)/srsq;
+	if (rsq>=1.0)
+	    continue;
+
+	const Coord diff = usePos[ii] - gridPos;
+	double ang = atan2(diff.y, diff.x);
+	ang += ang<0.0 ? M_2PI: 0;
+	sectors |= 1 << mMIN(int(ang/sectorsize), 7);
+	val += W[ii] * interp_->basis(rsq);
     }
-}
-double meanVal = V.mean();
-V = V.array() - meanVal;
 
-Eigen::MatrixXd A = M.transpose() * M + 0.01 * Eigen::MatrixXd::Identity(nrpoints,nrpoints);
-Eigen::VectorXd B = M.transpose() * V;
-Eigen::VectorXd W = A.colPivHouseholderQr().solve(B);
+    int nrsectors = 0;
+    for (int isect=0; isect<8; isect++)
+	nrsectors += (sectors>>isect) & 1;
+    if (nrsectors<5)
+	continue;
 
-double val = (W.array() * dsq).sum() + meanVal;
-
-Threads::Locker lckr( lock_ );
-val += grid_->get(ix,iy);
-grid_->set(ix, iy, (float)val);
+    const int ix = hs_.inlIdx(gridBid.inl());
+    const int iy = hs_.crlIdx(gridBid.crl());
+    grid_->set(ix, iy, (float)(val+grid_->get(ix,iy)));
+}
 , )
 
 
+const char* wmLTPSGridder2D::sKeyTileSize()	{ return "TileSize"; }
+
 wmLTPSGridder2D::wmLTPSGridder2D()
+    : tilesize_(1)
 {}
 
+bool wmLTPSGridder2D::usePar(const IOPar& par)
+{
+    tilesize_ = 1;
+    par.get(sKeyTileSize(), tilesize_);
+    tilesize_ = mMAX(tilesize_, 1);
+    return wmGridder2D::usePar(par);
+}
+
 bool wmLTPSGridder2D::executeGridding(TaskRunner* tr)
 {
     localInterp();
@@ -175,9 +320,39 @@ bool wmLTPSGridder2D::executeGridding(TaskRunner* tr)
 
     const CoordTypeSetAdaptor coords( binLocs_ );
     CoordKDTree nfindex( 2, coords );
-    Threads::Lock lock;
     nfindex.buildIndex();
-    LTPSInterpolator interp( interpidx_.size(), this, nfindex, lock );
+    if (tilesize_<=1) {
+	LTPSInterpolator interp( interpidx_.size(), this, nfindex );
+	if (tr)
+	    return TaskRunner::execute( tr, interp );
+	else
+	    interp.execute();
+
+	return true;
+    }
+
+    LTPSTiles tiles;
+    const int nrtileinl = (hs_.nrInl()+tilesize_-1) / tilesize_;
+    const int nrtilecrl = (hs_.nrCrl()+tilesize_-1) / tilesize_;
+    const int nrtiles = nrtileinl * nrtilecrl;
+    TypeSet<int> tileidx(interpidx_.size(), 0);
+    tiles.first_.setSize(nrtiles+1, 0);
+    for (od_int64 idx=0; idx<interpidx_.size(); idx++) {
+	BinID gridBid = hs_.atIndex(interpidx_[idx]);
+	const int ix = hs_.inlIdx(gridBid.inl());
+	const int iy = hs_.crlIdx(gridBid.crl());
+	tileidx[idx] = (ix/tilesize_)*nrtilecrl + iy/tilesize_;
+	tiles.first_[tileidx[idx]+1]++;
+    }
+    for (int itile=0; itile<nrtiles; itile++)
+	tiles.first_[itile+1] += tiles.first_[itile];
+
+    tiles.nodes_.setSize(interpidx_.size(), 0);
+    TypeSet<int> tilepos(tiles.first_);
+    for (od_int64 idx=0; idx<interpidx_.size(); idx++)
+	tiles.nodes_[tilepos[tileidx[idx]]++] = interpidx_[idx];
+
+    LTPSTileInterpolator interp( nrtiles, this, nfindex, tiles );
     if (tr)
 	return TaskRunner::execute( tr, interp );
     else
@@ -25,15 +25,24 @@ class wmLTPSGridder2D : public wmGridder2D
 {
 public:
     friend class LTPSInterpolator;
+    friend class LTPSTileInterpolator;
     wmLTPSGridder2D();
     ~wmLTPSGridder2D() {}
     
     bool	executeGridding(TaskRunner*);
+    bool	usePar(const IOPar&);
     double	basis( double r ) const;
 
+    static const char*	sKeyTileSize();
+
+    // Points per sector of a tile support set, relative to maxpoints_ for one node
+    static const int	cTileSectorFactor = 2;
+
 protected:
     void	calcResidual();
 
+    int		tilesize_;
+
 };
 
 inline double wmLTPSGridder2D::basis( double rsq ) const
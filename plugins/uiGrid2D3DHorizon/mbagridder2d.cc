@@ -1,6 +1,325 @@
 #include "mbagridder2d.h"
-#include "mba.hpp"
-#include <array>
+
+#include "paralleltask.h"
+#include "math2.h"
+
+// Uniform cubic B-spline basis functions
+static inline void bsplineWeights( double s, double* wts )
+{
+    const double s2 = s*s;
+    const double s3 = s2*s;
+    const double t = 1.0 - s;
+    wts[0] = t*t*t/6.0;
+    wts[1] = (3.0*s3 - 6.0*s2 + 4.0)/6.0;
+    wts[2] = (-3.0*s3 + 3.0*s2 + 3.0*s + 1.0)/6.0;
+    wts[3] = s3/6.0;
+}
+
+wmMBASurface2D::wmMBASurface2D( const TypeSet<Coord>& locs, const TypeSet<float>& vals,
+				const Interval<double>& xrg, const Interval<double>& yrg,
+				int maxlevels, int initialsize )
+    : locs_(locs)
+    , xrg_(xrg)
+    , yrg_(yrg)
+    , maxlevels_(mMAX(maxlevels,1))
+    , gridsize_(mMAX(initialsize,2))
+    , eps_(0.0)
+    , nx_(0)
+    , ny_(0)
+    , level_(0)
+    , fitting_(true)
+    , pointidx_(0)
+    , maxres_(0.0)
+    , nrdone_(0)
+{
+    xrg_.sort();
+    yrg_.sort();
+    if (xrg_.width()<=0.0)
+	xrg_.stop = xrg_.start + 1.0;
+    if (yrg_.width()<=0.0)
+	yrg_.stop = yrg_.start + 1.0;
+
+    // Points outside the domain take no part, marked by an undefined residual
+    res_.setSize(locs_.size(), mUdf(double));
+    for (int idx=0; idx<locs_.size(); idx++) {
+	if (xrg_.includes(locs_[idx].x,false) && yrg_.includes(locs_[idx].y,false)) {
+	    res_[idx] = vals[idx];
+	    eps_ = mMAX(eps_, fabs(vals[idx]));
+	}
+    }
+    eps_ *= 1e-8;
+    totalnr_ = od_int64(2*maxlevels_+1) * locs_.size();
+}
+
+uiString wmMBASurface2D::uiMessage() const
+{
+    return tr("Multilevel B-spline approximation, level %1").arg(level_);
+}
+
+uiString wmMBASurface2D::uiNrDoneText() const
+{
+    return tr("Points done");
+}
+
+void wmMBASurface2D::getWeights( bool forx, double pos, int& first, double* wts ) const
+{
+    const Interval<double>& rg = forx ? xrg_ : yrg_;
+    const int nrcells = (forx ? nx_ : ny_) - 3;
+    double u = (pos-rg.start)/rg.width()*nrcells;
+    u = u<0.0 ? 0.0 : u>nrcells ? nrcells : u;
+    first = mMIN((int)Math::Floor(u), nrcells-1);
+    bsplineWeights(u-first, wts);
+}
+
+double wmMBASurface2D::getValue( double x, double y ) const
+{
+    int ix, iy;
+    double wx[4], wy[4];
+    getWeights(true, x, ix, wx);
+    getWeights(false, y, iy, wy);
+    double val = 0.0;
+    for (int k=0; k<4; k++) {
+	const double* row = latticeRow(ix+k) + iy;
+	val += wx[k] * (wy[0]*row[0] + wy[1]*row[1] + wy[2]*row[2] + wy[3]*row[3]);
+    }
+    return val;
+}
+
+void wmMBASurface2D::fitLinear()
+{
+    // Least squares plane through the points, coordinates relative to the domain centre
+    const double xc = xrg_.center();
+    const double yc = yrg_.center();
+    double sxx = 0.0, sxy = 0.0, syy = 0.0, sx = 0.0, sy = 0.0, n = 0.0;
+    double sv = 0.0, sxv = 0.0, syv = 0.0;
+    for (int idx=0; idx<locs_.size(); idx++) {
+	if (mIsUdf(res_[idx]))
+	    continue;
+
+	const double x = locs_[idx].x - xc;
+	const double y = locs_[idx].y - yc;
+	const double v = res_[idx];
+	n += 1.0;
+	sx += x;
+	sy += y;
+	sxx += x*x;
+	sxy += x*y;
+	syy += y*y;
+	sv += v;
+	sxv += x*v;
+	syv += y*v;
+    }
+
+    double a = n>0.0 ? sv/n : 0.0;
+    double b = 0.0, c = 0.0;
+    const double det = n*(sxx*syy-sxy*sxy) - sx*(sx*syy-sxy*sy) + sy*(sx*sxy-sxx*sy);
+    if (n>=3.0 && fabs(det)>1e-12*mMAX(n*sxx*syy,1e-300)) {
+	a = (sv*(sxx*syy-sxy*sxy) - sx*(sxv*syy-sxy*syv) + sy*(sxv*sxy-sxx*syv))/det;
+	b = (n*(sxv*syy-sxy*syv) - sv*(sx*syy-sxy*sy) + sy*(sx*syv-sxv*sy))/det;
+	c = (n*(sxx*syv-sxv*sxy) - sx*(sx*syv-sxv*sy) + sv*(sx*sxy-sxx*sy))/det;
+    }
+
+    // Cubic B-splines reproduce a plane from its values at the control points
+    nx_ = ny_ = gridsize_ + 2;
+    phi_.setSize(nx_*ny_, 0.0);
+    const double hx = xrg_.width()/(gridsize_-1);
+    const double hy = yrg_.width()/(gridsize_-1);
+    for (int ix=0; ix<nx_; ix++) {
+	for (int iy=0; iy<ny_; iy++) {
+	    const double x = xrg_.start + (ix-1)*hx - xc;
+	    const double y = yrg_.start + (iy-1)*hy - yc;
+	    phi_[ix*ny_+iy] = a + b*x + c*y;
+	}
+    }
+
+    maxres_ = 0.0;
+    for (int idx=0; idx<locs_.size(); idx++) {
+	if (mIsUdf(res_[idx]))
+	    continue;
+
+	res_[idx] -= a + b*(locs_[idx].x-xc) + c*(locs_[idx].y-yc);
+	maxres_ = mMAX(maxres_, fabs(res_[idx]));
+    }
+}
+
+void wmMBASurface2D::refine()
+{
+    // Cubic B-spline subdivision from spacing h to h/2, first along x then along y
+    const int oldnx = nx_;
+    const int oldny = ny_;
+    gridsize_ = 2*gridsize_ - 1;
+    nx_ = ny_ = gridsize_ + 2;
+    TypeSet<double> tmp(nx_*oldny, 0.0);
+    for (int ix=0; ix<nx_; ix++) {
+	const int c = ix/2;
+	for (int iy=0; iy<oldny; iy++) {
+	    const double* p = phi_.arr() + c*oldny + iy;
+	    tmp[ix*oldny+iy] = ix%2==0 ? 0.5*(p[0]+p[oldny])
+				       : 0.125*(p[0]+6.0*p[oldny]+p[2*oldny]);
+	}
+    }
+
+    phi_.setSize(nx_*ny_, 0.0);
+    for (int ix=0; ix<nx_; ix++) {
+	const double* p = tmp.arr() + ix*oldny;
+	double* q = phi_.arr() + ix*ny_;
+	for (int iy=0; iy<ny_; iy++) {
+	    const int c = iy/2;
+	    q[iy] = iy%2==0 ? 0.5*(p[c]+p[c+1]) : 0.125*(p[c]+6.0*p[c+1]+p[c+2]);
+	}
+    }
+}
+
+void wmMBASurface2D::startLevel()
+{
+    if (level_>1)
+	refine();
+
+    delta_.setSize(nx_*ny_, 0.0);
+    omega_.setSize(nx_*ny_, 0.0);
+    for (int idx=0; idx<nx_*ny_; idx++)
+	delta_[idx] = omega_[idx] = 0.0;
+
+    fitting_ = true;
+    pointidx_ = 0;
+    maxres_ = 0.0;
+}
+
+void wmMBASurface2D::fitChunk( int start, int stop )
+{
+    for (int idx=start; idx<stop; idx++) {
+	if (mIsUdf(res_[idx]))
+	    continue;
+
+	int ix, iy;
+	double wx[4], wy[4];
+	getWeights(true, locs_[idx].x, ix, wx);
+	getWeights(false, locs_[idx].y, iy, wy);
+	double sumw2 = 0.0;
+	for (int k=0; k<4; k++)
+	    for (int l=0; l<4; l++)
+		sumw2 += wx[k]*wx[k]*wy[l]*wy[l];
+
+	const double r = res_[idx]/sumw2;
+	for (int k=0; k<4; k++) {
+	    double* delta = delta_.arr() + (ix+k)*ny_ + iy;
+	    double* omega = omega_.arr() + (ix+k)*ny_ + iy;
+	    for (int l=0; l<4; l++) {
+		const double w = wx[k]*wy[l];
+		const double w2 = w*w;
+		delta[l] += w2*w*r;
+		omega[l] += w2;
+	    }
+	}
+    }
+}
+
+void wmMBASurface2D::updateResiduals( int start, int stop )
+{
+    for (int idx=start; idx<stop; idx++) {
+	if (mIsUdf(res_[idx]))
+	    continue;
+
+	int ix, iy;
+	double wx[4], wy[4];
+	getWeights(true, locs_[idx].x, ix, wx);
+	getWeights(false, locs_[idx].y, iy, wy);
+	double val = 0.0;
+	for (int k=0; k<4; k++) {
+	    const double* row = delta_.arr() + (ix+k)*ny_ + iy;
+	    val += wx[k] * (wy[0]*row[0] + wy[1]*row[1] + wy[2]*row[2] + wy[3]*row[3]);
+	}
+	res_[idx] -= val;
+	maxres_ = mMAX(maxres_, fabs(res_[idx]));
+    }
+}
+
+int wmMBASurface2D::nextStep()
+{
+    const int nrpts = locs_.size();
+    if (level_==0) {
+	fitLinear();
+	nrdone_ += nrpts;
+	if (maxres_<=eps_)
+	    return Finished();
+
+	level_ = 1;
+	startLevel();
+	return MoreToDo();
+    }
+
+    const int stop = mMIN(pointidx_+cChunkSize, nrpts);
+    if (fitting_) {
+	fitChunk(pointidx_, stop);
+	nrdone_ += stop - pointidx_;
+	pointidx_ = stop;
+	if (pointidx_<nrpts)
+	    return MoreToDo();
+
+	// This level's lattice, kept in delta_
+	for (int idx=0; idx<nx_*ny_; idx++)
+	    delta_[idx] = omega_[idx]>0.0 ? delta_[idx]/omega_[idx] : 0.0;
+
+	fitting_ = false;
+	pointidx_ = 0;
+	return MoreToDo();
+    }
+
+    updateResiduals(pointidx_, stop);
+    nrdone_ += stop - pointidx_;
+    pointidx_ = stop;
+    if (pointidx_<nrpts)
+	return MoreToDo();
+
+    for (int idx=0; idx<nx_*ny_; idx++)
+	phi_[idx] += delta_[idx];
+
+    if (level_>=maxlevels_ || maxres_<=eps_) {
+	delta_.erase();
+	omega_.erase();
+	return Finished();
+    }
+
+    level_++;
+    startLevel();
+    return MoreToDo();
+}
+
+
+mDefParallelCalc2Pars( MBAEvaluator, od_static_tr("MBAEvaluator","Multilevel B-spline evaluation"),
+		       const wmMBAGridder2D*, interp, const wmMBASurface2D&, surface )
+mDefParallelCalcBody(
+const TrcKeySampling& hs_ = interp_->hs_;
+Array2DImpl<float>* grid_ = interp_->grid_;
+const int nrcrl = hs_.nrCrl();
+const int nrlatcrl = surface_.latticeSize(false);
+TypeSet<int> crlfirst(nrcrl, 0);
+TypeSet<double> crlwts(4*nrcrl, 0.0);
+for (int iy=0; iy<nrcrl; iy++)
+    surface_.getWeights(false, hs_.start_.crl()+iy*hs_.step_.crl(), crlfirst[iy], crlwts.arr()+4*iy);
+TypeSet<double> row(nrlatcrl, 0.0);
+,
+// Nodes left undefined by prepareForGridding are the ones not in interpidx_
+int first;
+double wx[4];
+surface_.getWeights(true, hs_.start_.inl()+idx*hs_.step_.inl(), first, wx);
+const double* p0 = surface_.latticeRow(first);
+const double* p1 = surface_.latticeRow(first+1);
+const double* p2 = surface_.latticeRow(first+2);
+const double* p3 = surface_.latticeRow(first+3);
+for (int il=0; il<nrlatcrl; il++)
+    row[il] = wx[0]*p0[il] + wx[1]*p1[il] + wx[2]*p2[il] + wx[3]*p3[il];
+
+for (int iy=0; iy<nrcrl; iy++) {
+    if (mIsUdf(grid_->get(idx,iy)))
+	continue;
+
+    const double* w = crlwts.arr() + 4*iy;
+    const double* r = row.arr() + crlfirst[iy];
+    grid_->set(idx, iy, (float)(w[0]*r[0] + w[1]*r[1] + w[2]*r[2] + w[3]*r[3]));
+}
+, )
+
 
 wmMBAGridder2D::wmMBAGridder2D()
 : maxlevels_(10)
@@ -17,26 +336,20 @@ bool wmMBAGridder2D::prepareForGridding()
 
 bool wmMBAGridder2D::executeGridding(TaskRunner* tr)
 {
-    std::vector<mba::point<2>> binLocs(binLocs_.size());
-    std::vector<float> vals(binLocs_.size());
-    for (int idx=0; idx<binLocs_.size(); idx++) {
-	binLocs[idx] = mba::point<2>{{binLocs_[idx].x, binLocs_[idx].y}};
-	vals[idx] = vals_[idx];
-    }
+    const Interval<double> xrg(hs_.start_.inl(), hs_.stop_.inl());
+    const Interval<double> yrg(hs_.start_.crl(), hs_.stop_.crl());
+    wmMBASurface2D surface(binLocs_, vals_, xrg, yrg, maxlevels_);
+    if (tr) {
+	if (!TaskRunner::execute( tr, surface ))
+	    return false;
+    } else if (!surface.execute())
+	return false;
+
+    MBAEvaluator interp( hs_.nrInl(), this, surface );
+    if (tr)
+	return TaskRunner::execute( tr, interp );
+    else
+	interp.execute();
 
-    mba::point<2> lo = {{ double(hs_.start_.inl()), double(hs_.start_.crl()) }};
-    mba::point<2> hi = {{ double(hs_.stop_.inl()), double(hs_.stop_.crl()) }};
-    
-    mba::index<2> grid = {{ 2, 2 }};
-    
-    mba::MBA<2> interp(lo, hi, grid, binLocs, vals, maxlevels_);
-    
-    for (od_int64 idx=0; idx<interpidx_.size(); idx++) {
-	BinID gridBid = hs_.atIndex(interpidx_[idx]);
-	int ix = hs_.inlIdx(gridBid.inl());
-	int iy = hs_.crlIdx(gridBid.crl());
-	grid_->set(ix, iy, interp(mba::point<2>{{(double)gridBid.inl(), (double)gridBid.crl()}}));
-    }
     return true;
 }
-
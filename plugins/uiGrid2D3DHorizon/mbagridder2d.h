@@ -2,10 +2,79 @@
 #define mbagridder2d_h
 
 #include "wmgridder2d.h"
+#include "task.h"
+
+class MBAEvaluator;
+
+/*!\brief Multilevel B-spline approximation of scattered points on a 2D domain.
+
+  A linear least squares fit is followed by one cubic B-spline approximation of the
+  residuals per level, the lattice spacing halving every level. The coarser levels are
+  refined into the finer lattice, which is exact for cubic B-splines, so the surface is
+  one dense control lattice and can be evaluated separably on a regular grid.
+
+  Building is a SequentialTask working through the points in chunks, so it reports
+  progress and can be cancelled.
+*/
+
+class wmMBASurface2D : public SequentialTask
+{ mODTextTranslationClass(wmMBASurface2D);
+public:
+			wmMBASurface2D(const TypeSet<Coord>& locs,
+				       const TypeSet<float>& vals,
+				       const Interval<double>& xrg,
+				       const Interval<double>& yrg,
+				       int maxlevels, int initialsize=2);
+
+    od_int64		nrDone() const		{ return nrdone_; }
+    od_int64		totalNr() const		{ return totalnr_; }
+    uiString		uiMessage() const;
+    uiString		uiNrDoneText() const;
+
+    double		getValue(double x,double y) const;
+    void		getWeights(bool forx,double pos,int& first,double* wts) const;
+    int			latticeSize(bool forx) const	{ return forx ? nx_ : ny_; }
+    const double*	latticeRow(int ix) const	{ return phi_.arr() + ix*ny_; }
+
+protected:
+
+    int			nextStep();
+    void		startLevel();
+    void		fitChunk(int start,int stop);
+    void		updateResiduals(int start,int stop);
+    void		refine();
+    void		fitLinear();
+
+    static const int	cChunkSize = 100000;
+
+    const TypeSet<Coord>&	locs_;
+    TypeSet<double>		res_;
+    Interval<double>		xrg_;
+    Interval<double>		yrg_;
+    int				maxlevels_;
+    int				gridsize_;
+    double			eps_;
+
+    int				nx_;
+    int				ny_;
+    TypeSet<double>		phi_;
+    TypeSet<double>		delta_;
+    TypeSet<double>		omega_;
+
+    int				level_;
+    bool			fitting_;
+    int				pointidx_;
+    double			maxres_;
+    od_int64			nrdone_;
+    od_int64			totalnr_;
+};
+
 
 class wmMBAGridder2D : public wmGridder2D
 {
 public:
+    friend class MBAEvaluator;
+
     wmMBAGridder2D();
     ~wmMBAGridder2D() {}
     
@@ -19,4 +88,3 @@ protected:
 };
 
 #endif
-
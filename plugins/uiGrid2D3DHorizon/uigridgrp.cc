@@ -14,6 +14,8 @@
 #include "emioobjinfo.h"
 #include "emhorizon3d.h"
 #include "wmgridder2d.h"
+#include "idwgridder2d.h"
+#include "ltpsgridder2d.h"
 #include "uipolygonparsel.h"
 #include "uicompoundparsel.h"
 
@@ -243,6 +245,12 @@ uiIDW::uiIDW( uiParent* p )
     maxpointsfld_->setWithCheck( true );
     maxpointsfld_->setChecked( true );
     maxpointsfld_->attach(alignedBelow, searchradiusfld_);
+
+    tolerancefld_ = new uiGenInput( this, tr("Global approximation tolerance"),
+				    FloatInpSpec(0.001f) );
+    tolerancefld_->setWithCheck( true );
+    tolerancefld_->setChecked( false );
+    tolerancefld_->attach(alignedBelow, maxpointsfld_);
 }
 
 bool uiIDW::fillPar( IOPar& par ) const
@@ -267,6 +275,16 @@ bool uiIDW::fillPar( IOPar& par ) const
 	par.set( wmGridder2D::sKeyMaxPoints(), npoints );
     }
 
+    if ( tolerancefld_->isChecked() ) {
+	const float tolerance = tolerancefld_->getFValue(0);
+	if ( tolerance<=0 )
+	{
+	    uiMSG().error( tr("Approximation tolerance must be positive") );
+	    return false;
+	}
+	par.set( wmIDWGridder2D::sKeyTolerance(), tolerance );
+    }
+
     return true;
 }
 
@@ -289,6 +307,15 @@ void uiIDW::usePar( const IOPar& par )
 	maxpointsfld_->setChecked(false);
 	maxpointsfld_->setValue(50);
     }
+
+    float tolerance;
+    if (par.get(wmIDWGridder2D::sKeyTolerance(), tolerance)) {
+	tolerancefld_->setValue(tolerance);
+	tolerancefld_->setChecked(true);
+    } else {
+	tolerancefld_->setChecked(false);
+	tolerancefld_->setValue(0.001f);
+    }
 }
 
 uiLTPS::uiLTPS(uiParent* p)
@@ -299,6 +326,9 @@ uiLTPS::uiLTPS(uiParent* p)
 
     maxpointsfld_ = new uiGenInput( this, tr("Maximum points per sector"), IntInpSpec(4) );
     maxpointsfld_->attach(alignedBelow, searchradiusfld_);
+
+    tilesizefld_ = new uiGenInput( this, tr("Tile size (grid nodes)"), IntInpSpec(1) );
+    tilesizefld_->attach(alignedBelow, maxpointsfld_);
 }
 
 bool uiLTPS::fillPar(IOPar& par) const
@@ -319,6 +349,14 @@ bool uiLTPS::fillPar(IOPar& par) const
     }
     par.set( wmGridder2D::sKeyMaxPoints(), npoints );
 
+    const int tilesize = tilesizefld_->getIntValue(0);
+    if ( tilesize<=0 )
+    {
+	uiMSG().error( tr("Tile size must be positive") );
+	return false;
+    }
+    par.set( wmLTPSGridder2D::sKeyTileSize(), tilesize );
+
     return true;
 }
 
@@ -331,6 +369,10 @@ void uiLTPS::usePar(const IOPar& par)
     int npoints = 4;
     par.get(wmGridder2D::sKeyMaxPoints(), npoints);
     maxpointsfld_->setValue(npoints);
+
+    int tilesize = 1;
+    par.get(wmLTPSGridder2D::sKeyTileSize(), tilesize);
+    tilesizefld_->setValue(tilesize);
 }
 
 uiMBA::uiMBA(uiParent* p)
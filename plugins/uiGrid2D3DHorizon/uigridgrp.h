@@ -67,6 +67,7 @@ public:
 protected:
     uiGenInput*         searchradiusfld_;
     uiGenInput*         maxpointsfld_;
+    uiGenInput*         tolerancefld_;
 };
 
 
@@ -81,6 +82,7 @@ public:
 protected:
     uiGenInput*         searchradiusfld_;
     uiGenInput*         maxpointsfld_;
+    uiGenInput*         tilesizefld_;
 };    
 
 class uiMBA : public ui2D3DInterpol
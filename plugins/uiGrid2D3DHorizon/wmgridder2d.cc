@@ -354,6 +354,7 @@ bool wmGridder2D::loadData()
     }
     
     faultpoly_.erase();
+    faultindex_.erase();
     for (int idx=0; idx<faultpolyID_.size(); idx++) {
         ODPolygon<Pos::Ordinate_Type>* fault = new ODPolygon<Pos::Ordinate_Type>();
         PtrMan<IOObj> ioobj = IOM().get(faultpolyID_[idx]);
@@ -380,6 +381,7 @@ bool wmGridder2D::loadData()
           fault->setClosed( false );
         faultpoly_ += fault;
     }
+    faultindex_.build(faultpoly_);
     return true;
 }
 
@@ -425,11 +427,7 @@ bool wmGridder2D::isUncropped( Coord pos ) const
 
 bool wmGridder2D::inFaultHeave(Coord pos) const
 {
-    for (int idx=0; idx<faultpoly_.size(); idx++) {
-        if (faultpoly_[idx]->isClosed() && faultpoly_[idx]->isInside(pos, false, mDefEpsD))
-            return true;
-    }
-    return false;
+    return faultindex_.inHeave(pos);
 }
 
 bool wmGridder2D::segmentsIntersect( Coord s1p1, Coord s1p2, Coord s2p1, Coord s2p2 )
@@ -452,13 +450,232 @@ bool wmGridder2D::segmentsIntersect( Coord s1p1, Coord s1p2, Coord s2p1, Coord s
 
 bool wmGridder2D::faultBetween(Coord s1p1, Coord s1p2) const
 {
-    for (int idx=0; idx<faultpoly_.size(); idx++) {
-        for (int iv=0; iv<faultpoly_[idx]->size(); iv++) {
-            Coord s2p1 = faultpoly_[idx]->getVertex(iv);
-            Coord s2p2 = faultpoly_[idx]->nextVertex(iv);
-            if (segmentsIntersect(s1p1, s1p2, s2p1, s2p2))
-               return true;
-        }
+    return faultindex_.crosses(s1p1, s1p2);
+}
+
+wmFaultIndex2D::wmFaultIndex2D()
+{}
+
+void wmFaultIndex2D::erase()
+{
+    segp1_.erase();
+    segp2_.erase();
+    seggrid_.erase();
+    heaves_.erase();
+    heavegrid_.erase();
+}
+
+void wmFaultIndex2D::build(const ObjectSet<ODPolygon<Pos::Ordinate_Type>>& faults)
+{
+    erase();
+    TypeSet<Interval<double>> xrgs, yrgs;
+    for (int idx=0; idx<faults.size(); idx++) {
+	const ODPolygon<Pos::Ordinate_Type>& fault = *faults[idx];
+	for (int iv=0; iv<fault.size(); iv++) {
+	    const Coord p1 = fault.getVertex(iv);
+	    const Coord p2 = fault.nextVertex(iv);
+	    segp1_ += p1;
+	    segp2_ += p2;
+	    xrgs += Interval<double>(mMIN(p1.x,p2.x), mMAX(p1.x,p2.x));
+	    yrgs += Interval<double>(mMIN(p1.y,p2.y), mMAX(p1.y,p2.y));
+	}
+    }
+    seggrid_.build(xrgs, yrgs);
+
+    xrgs.erase();
+    yrgs.erase();
+    for (int idx=0; idx<faults.size(); idx++) {
+	const ODPolygon<Pos::Ordinate_Type>& fault = *faults[idx];
+	if (!fault.isClosed() || fault.isEmpty())
+	    continue;
+	const Interval<Pos::Ordinate_Type> xrg = fault.getRange(true);
+	const Interval<Pos::Ordinate_Type> yrg = fault.getRange(false);
+	heaves_ += &fault;
+	xrgs += Interval<double>(xrg.start, xrg.stop);
+	yrgs += Interval<double>(yrg.start, yrg.stop);
+    }
+    heavegrid_.build(xrgs, yrgs);
+}
+
+void wmFaultIndex2D::Grid::erase()
+{
+    nx_ = ny_ = 0;
+    first_.erase();
+    items_.erase();
+}
+
+void wmFaultIndex2D::Grid::build(const TypeSet<Interval<double>>& xrgs,
+				 const TypeSet<Interval<double>>& yrgs)
+{
+    erase();
+    const int nritems = xrgs.size();
+    if (nritems==0)
+	return;
+
+    Interval<double> xrg(xrgs[0]), yrg(yrgs[0]);
+    double sumsize = 0.;
+    for (int idx=0; idx<nritems; idx++) {
+	xrg.include(xrgs[idx]);
+	yrg.include(yrgs[idx]);
+	sumsize += mMAX(xrgs[idx].width(), yrgs[idx].width());
+    }
+
+    // Cells about the size of an item, but no more than a few per item
+    const double width = mMAX(xrg.width(), 1.);
+    const double height = mMAX(yrg.width(), 1.);
+    const double minsize = Math::Sqrt(width*height/(4.*nritems));
+    cellsize_ = mMAX(sumsize/nritems, minsize);
+    nx_ = mMAX((int)(width/cellsize_)+1, 1);
+    ny_ = mMAX((int)(height/cellsize_)+1, 1);
+    x0_ = xrg.start;
+    y0_ = yrg.start;
+
+    // Padding so that items touching a cell border are listed on both sides
+    const double pad = 1e-6*cellsize_;
+    TypeSet<int> cellrgs(4*nritems, 0);
+    first_.setSize(nx_*ny_+1, 0);
+    for (int idx=0; idx<nritems; idx++) {
+	int* rg = cellrgs.arr() + 4*idx;
+	getCell(xrgs[idx].start-pad, yrgs[idx].start-pad, rg[0], rg[1]);
+	getCell(xrgs[idx].stop+pad, yrgs[idx].stop+pad, rg[2], rg[3]);
+	for (int iy=rg[1]; iy<=rg[3]; iy++)
+	    for (int ix=rg[0]; ix<=rg[2]; ix++)
+		first_[iy*nx_+ix+1]++;
+    }
+    for (int icell=0; icell<nx_*ny_; icell++)
+	first_[icell+1] += first_[icell];
+
+    items_.setSize(first_[nx_*ny_], 0);
+    TypeSet<int> fill(first_);
+    for (int idx=0; idx<nritems; idx++) {
+	const int* rg = cellrgs.arr() + 4*idx;
+	for (int iy=rg[1]; iy<=rg[3]; iy++)
+	    for (int ix=rg[0]; ix<=rg[2]; ix++)
+		items_[fill[iy*nx_+ix]++] = idx;
+    }
+}
+
+void wmFaultIndex2D::Grid::getCell(double x, double y, int& ix, int& iy) const
+{
+    const double fx = Math::Floor((x-x0_)/cellsize_);
+    const double fy = Math::Floor((y-y0_)/cellsize_);
+    ix = fx<0. ? 0 : fx>=nx_ ? nx_-1 : (int)fx;
+    iy = fy<0. ? 0 : fy>=ny_ ? ny_-1 : (int)fy;
+}
+
+bool wmFaultIndex2D::cellCrosses(int ix, int iy, const Coord& p1, const Coord& p2) const
+{
+    for (int idx=seggrid_.firstItem(ix,iy); idx<seggrid_.stopItem(ix,iy); idx++) {
+	const int iseg = seggrid_.items_[idx];
+	if (wmGridder2D::segmentsIntersect(p1, p2, segp1_[iseg], segp2_[iseg]))
+	    return true;
+    }
+    return false;
+}
+
+bool wmFaultIndex2D::crosses(const Coord& p1, const Coord& p2) const
+{
+    if (seggrid_.isEmpty())
+	return false;
+
+    // Clip the segment to the grid, in cell units
+    const Grid& grd = seggrid_;
+    const double ax = (p1.x-grd.x0_)/grd.cellsize_;
+    const double ay = (p1.y-grd.y0_)/grd.cellsize_;
+    const double dx = (p2.x-grd.x0_)/grd.cellsize_ - ax;
+    const double dy = (p2.y-grd.y0_)/grd.cellsize_ - ay;
+    double t0 = 0., t1 = 1.;
+    const double pp[4] = { -dx, dx, -dy, dy };
+    const double qq[4] = { ax, grd.nx_-ax, ay, grd.ny_-ay };
+    for (int idx=0; idx<4; idx++) {
+	if (pp[idx]==0.) {
+	    if (qq[idx]<0.)
+		return false;
+	    continue;
+	}
+	const double t = qq[idx]/pp[idx];
+	if (pp[idx]<0.)
+	    t0 = mMAX(t0, t);
+	else
+	    t1 = mMIN(t1, t);
+    }
+    if (t0>t1)
+	return false;
+
+    // Walk the cells along the clipped segment
+    const double sx = ax + t0*dx;
+    const double sy = ay + t0*dy;
+    const double ex = ax + t1*dx;
+    const double ey = ay + t1*dy;
+    int ix, iy, endix, endiy;
+    grd.getCell(grd.x0_+sx*grd.cellsize_, grd.y0_+sy*grd.cellsize_, ix, iy);
+    grd.getCell(grd.x0_+ex*grd.cellsize_, grd.y0_+ey*grd.cellsize_, endix, endiy);
+    const int stepx = dx>0. ? 1 : dx<0. ? -1 : 0;
+    const int stepy = dy>0. ? 1 : dy<0. ? -1 : 0;
+    const double tdeltax = stepx ? 1./fabs(dx) : mUdf(double);
+    const double tdeltay = stepy ? 1./fabs(dy) : mUdf(double);
+    double tmaxx = stepx ? ((stepx>0 ? ix+1 : ix) - (ax+t0*dx))/dx + t0 : mUdf(double);
+    double tmaxy = stepy ? ((stepy>0 ? iy+1 : iy) - (ay+t0*dy))/dy + t0 : mUdf(double);
+    const int maxsteps = grd.nx_ + grd.ny_ + 2;
+    for (int istep=0; istep<maxsteps; istep++) {
+	if (cellCrosses(ix, iy, p1, p2))
+	    return true;
+	if (ix==endix && iy==endiy)
+	    break;
+	if (tmaxx<tmaxy) {
+	    ix += stepx;
+	    tmaxx += tdeltax;
+	} else {
+	    iy += stepy;
+	    tmaxy += tdeltay;
+	}
+	if (ix<0 || ix>=grd.nx_ || iy<0 || iy>=grd.ny_)
+	    break;
+    }
+    return false;
+}
+
+bool wmFaultIndex2D::mayCross(const Interval<double>& xrg,
+			      const Interval<double>& yrg) const
+{
+    if (seggrid_.isEmpty())
+	return false;
+
+    // Any segment with a bounding box overlapping the box may cross a segment inside it
+    int ix0, iy0, ix1, iy1;
+    seggrid_.getCell(xrg.start, yrg.start, ix0, iy0);
+    seggrid_.getCell(xrg.stop, yrg.stop, ix1, iy1);
+    for (int iy=iy0; iy<=iy1; iy++) {
+	for (int ix=ix0; ix<=ix1; ix++) {
+	    for (int idx=seggrid_.firstItem(ix,iy); idx<seggrid_.stopItem(ix,iy); idx++) {
+		const int iseg = seggrid_.items_[idx];
+		const Coord& p1 = segp1_[iseg];
+		const Coord& p2 = segp2_[iseg];
+		if (mMAX(p1.x,p2.x)>=xrg.start && mMIN(p1.x,p2.x)<=xrg.stop &&
+		    mMAX(p1.y,p2.y)>=yrg.start && mMIN(p1.y,p2.y)<=yrg.stop)
+		    return true;
+	    }
+	}
+    }
+    return false;
+}
+
+bool wmFaultIndex2D::inHeave(const Coord& pos) const
+{
+    if (heavegrid_.isEmpty())
+	return false;
+
+    const Grid& grd = heavegrid_;
+    const double fx = (pos.x-grd.x0_)/grd.cellsize_;
+    const double fy = (pos.y-grd.y0_)/grd.cellsize_;
+    if (fx<0. || fy<0. || fx>grd.nx_ || fy>grd.ny_)
+	return false;
+
+    int ix, iy;
+    grd.getCell(pos.x, pos.y, ix, iy);
+    for (int idx=grd.firstItem(ix,iy); idx<grd.stopItem(ix,iy); idx++) {
+	if (heaves_[grd.items_[idx]]->isInside(pos, false, mDefEpsD))
+	    return true;
     }
     return false;
 }
@@ -497,16 +714,33 @@ bool wmGridder2D::prepareForGridding()
     return true;
 }
 
+// One weighted contribution of a data point to a grid node, ix_<0 if unused
+struct wmLocalWeight
+{
+    int		ptidx_ = -1;
+    int		ix_ = -1;
+    int		iy_ = -1;
+    double	wgt_ = 0.0;
+};
+
+// Contributions sorted on grid inline so each inline can be summed by one thread
+struct wmLocalWeights
+{
+    TypeSet<wmLocalWeight>	weights_;
+    TypeSet<int>		order_;
+    TypeSet<int>		rowstart_;
+};
+
 mDefParallelCalc2Pars( LocalInterpolator, od_static_tr("LocalInterpolator","Interpolate nearest grid points"),
-		       const wmGridder2D*, interp, Threads::Lock, lock )
+		       const wmGridder2D*, interp, wmLocalWeights&, weights )
 mDefParallelCalcBody( 
 const TypeSet<Coord>& locs_ = interp_->binLocs_;
-const TypeSet<float>& vals_ = interp_->vals_;
 const TrcKeySampling& hs_ = interp_->hs_;
-Array2DImpl<float>* grid_ = interp_->grid_;
-Array2DImpl<float>* carr_ = interp_->carr_;
+const Array2DImpl<float>* grid_ = interp_->grid_;
+wmLocalWeight* wts_ = weights_.weights_.arr();
 ,
 const Coord pos(locs_[idx]);
+wmLocalWeight* wts = wts_ + 4*idx;
 BinID bidSnap = hs_.getNearest(BinID(mNINT32(pos.x), mNINT32(pos.y)));
 if (mIsEqual(pos.x, bidSnap.inl(), mDefEps) && mIsEqual(pos.y, bidSnap.crl(), mDefEps)) {
     int ix = hs_.inlIdx(bidSnap.inl());
@@ -514,13 +748,13 @@ if (mIsEqual(pos.x, bidSnap.inl(), mDefEps) && mIsEqual(pos.y, bidSnap.crl(), mD
     if (ix<0 || ix>=hs_.nrInl() || iy<0 || iy>=hs_.nrCrl())
 	continue;
 
-    float prev = grid_->get(ix,iy);
-    if (mIsUdf(prev))
+    if (mIsUdf(grid_->get(ix,iy)))
 	continue;
 
-    Threads::Locker lckr( lock_ );
-    grid_->set(ix, iy, prev + vals_[idx]);
-    carr_->set(ix, iy, carr_->get(ix, iy) + 1.0);
+    wts[0].ptidx_ = idx;
+    wts[0].ix_ = ix;
+    wts[0].iy_ = iy;
+    wts[0].wgt_ = 1.0;
 } else {
     BinID r[4];
     r[0] = pos.x<bidSnap.inl() ? bidSnap-BinID(hs_.step_.inl(),0) : bidSnap;
@@ -533,8 +767,7 @@ if (mIsEqual(pos.x, bidSnap.inl(), mDefEps) && mIsEqual(pos.y, bidSnap.crl(), mD
 	if (ix<0 || ix>=hs_.nrInl() || iy<0 || iy>=hs_.nrCrl())
 	    continue;
 
-	float prev = grid_->get(ix,iy);
-	if (mIsUdf(prev))
+	if (mIsUdf(grid_->get(ix,iy)))
 	    continue;
 
 	Coord rpos(r[ir].inl(), r[ir].crl());
@@ -542,14 +775,32 @@ if (mIsEqual(pos.x, bidSnap.inl(), mDefEps) && mIsEqual(pos.y, bidSnap.crl(), mD
 	    continue;
 
 	double dist = rpos.sqHorDistTo(pos);
-	double wgt = tanh(dist)/dist;
-	Threads::Locker lckr( lock_ );
-	grid_->set(ix, iy, prev + wgt*vals_[idx]);
-	carr_->set(ix, iy, carr_->get(ix, iy) + wgt);
+	wts[ir].ptidx_ = idx;
+	wts[ir].ix_ = ix;
+	wts[ir].iy_ = iy;
+	wts[ir].wgt_ = tanh(dist)/dist;
     }
 }
 , )
 
+mDefParallelCalc2Pars( LocalAccumulator, od_static_tr("LocalAccumulator","Sum weights on grid points"),
+		       const wmGridder2D*, interp, const wmLocalWeights&, weights )
+mDefParallelCalcBody(
+const TypeSet<float>& vals_ = interp_->vals_;
+Array2DImpl<float>* grid_ = interp_->grid_;
+Array2DImpl<float>* carr_ = interp_->carr_;
+const TypeSet<wmLocalWeight>& wts_ = weights_.weights_;
+const TypeSet<int>& order_ = weights_.order_;
+const TypeSet<int>& rowstart_ = weights_.rowstart_;
+,
+for (int iw=rowstart_[idx]; iw<rowstart_[idx+1]; iw++) {
+    const wmLocalWeight& wt = wts_[order_[iw]];
+    float prev = grid_->get(wt.ix_, wt.iy_);
+    grid_->set(wt.ix_, wt.iy_, prev + wt.wgt_*vals_[wt.ptidx_]);
+    carr_->set(wt.ix_, wt.iy_, carr_->get(wt.ix_, wt.iy_) + wt.wgt_);
+}
+, )
+
 void wmGridder2D::localInterp( bool approximation )
 {
     carr_ = new Array2DImpl<float>(hs_.nrInl(), hs_.nrCrl());
@@ -559,9 +810,30 @@ void wmGridder2D::localInterp( bool approximation )
     }
     carr_->setAll(0.0);
     
-    Threads::Lock lock;
-    LocalInterpolator interp( binLocs_.size(), this, lock);
+    // Each point gets up to 4 weights computed in parallel, the weights are then
+    // bucketed on grid inline and summed one inline per thread without locking
+    wmLocalWeights weights;
+    weights.weights_.setSize(4*binLocs_.size(), wmLocalWeight());
+    LocalInterpolator interp( binLocs_.size(), this, weights );
     interp.execute();
+
+    const int nrinl = hs_.nrInl();
+    weights.rowstart_.setSize(nrinl+1, 0);
+    for (int iw=0; iw<weights.weights_.size(); iw++) {
+	if (weights.weights_[iw].ix_>=0)
+	    weights.rowstart_[weights.weights_[iw].ix_+1]++;
+    }
+    for (int ix=0; ix<nrinl; ix++)
+	weights.rowstart_[ix+1] += weights.rowstart_[ix];
+
+    weights.order_.setSize(weights.rowstart_[nrinl], 0);
+    TypeSet<int> rowpos(weights.rowstart_);
+    for (int iw=0; iw<weights.weights_.size(); iw++) {
+	if (weights.weights_[iw].ix_>=0)
+	    weights.order_[rowpos[weights.weights_[iw].ix_]++] = iw;
+    }
+    LocalAccumulator accum( nrinl, this, weights );
+    accum.execute();
     
     binLocs_.erase();
     vals_.erase();
@@ -12,13 +12,67 @@
 class TaskRunner;
 class TrcKeySampling;
 class LocalInterpolator;
+class LocalAccumulator;
 namespace EM { class Horizon3D; }
 
 
+/*!\brief Uniform grid index of the fault polygons.
+
+  Every fault segment, and every closed polygon, is listed in the grid cells its padded
+  bounding box overlaps. A segment query walks only the cells the query segment passes
+  through and a point query looks in one cell, so only nearby faults are tested.
+*/
+
+class wmFaultIndex2D
+{
+public:
+			wmFaultIndex2D();
+
+    void		erase();
+    void		build(const ObjectSet<ODPolygon<Pos::Ordinate_Type>>&);
+    bool		isEmpty() const		{ return segp1_.isEmpty(); }
+
+    bool		crosses(const Coord&,const Coord&) const;
+    bool		mayCross(const Interval<double>& xrg,
+				 const Interval<double>& yrg) const;
+    bool		inHeave(const Coord&) const;
+
+protected:
+
+    struct Grid
+    {
+	void		erase();
+	void		build(const TypeSet<Interval<double>>& xrgs,
+			      const TypeSet<Interval<double>>& yrgs);
+	bool		isEmpty() const		{ return items_.isEmpty(); }
+	void		getCell(double x,double y,int& ix,int& iy) const;
+	int		firstItem(int ix,int iy) const	{ return first_[iy*nx_+ix]; }
+	int		stopItem(int ix,int iy) const	{ return first_[iy*nx_+ix+1]; }
+
+	double		x0_ = 0.;
+	double		y0_ = 0.;
+	double		cellsize_ = 1.;
+	int		nx_ = 0;
+	int		ny_ = 0;
+	TypeSet<int>	first_;
+	TypeSet<int>	items_;
+    };
+
+    bool		cellCrosses(int ix,int iy,const Coord&,const Coord&) const;
+
+    TypeSet<Coord>	segp1_;
+    TypeSet<Coord>	segp2_;
+    Grid		seggrid_;
+    ObjectSet<const ODPolygon<Pos::Ordinate_Type>>	heaves_;
+    Grid		heavegrid_;
+};
+
+
 class wmGridder2D
 { mODTextTranslationClass(wmGridder2D);
 public:
     friend class LocalInterpolator;
+    friend class LocalAccumulator;
     enum ScopeType   { Range, BoundingBox, ConvexHull, Horizon };
     enum Method { LTPS, MBA, IDW, NRN };
     static const char*	ScopeNames[];
@@ -43,6 +97,7 @@ public:
     bool		inFaultHeave( Coord ) const;
     static bool		segmentsIntersect(Coord, Coord, Coord, Coord);
     bool		faultBetween( Coord, Coord) const;
+    const wmFaultIndex2D&	faultIndex() const	{ return faultindex_; }
     void		getHorRange(Interval<int>&, Interval<int>&);
     bool		saveGridTo(EM::Horizon3D*);
     
@@ -81,6 +136,7 @@ protected:
 
     TypeSet<MultiID>				faultpolyID_;
     ObjectSet<ODPolygon<Pos::Ordinate_Type>>	faultpoly_;
+    wmFaultIndex2D				faultindex_;
     
     TypeSet<MultiID>				faultids_;
 
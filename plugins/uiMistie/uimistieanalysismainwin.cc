@@ -11,6 +11,7 @@
 #include "seisioobjinfo.h"
 #include "bufstringset.h"
 #include "uifiledlg.h"
+#include "file.h"
 #include "filepath.h"
 #include "oddirs.h"
 #include "uibuttongroup.h"
@@ -59,7 +60,7 @@ public:
         filefld_ = new uiFileInput( this, tr("Mistie File"), uiFileInput::Setup(uiFileDialog::Gen)
         .forread(true)
         .defseldir(defseldir)
-        .filter(MistieData::filtStr()) );
+        .filter(BufferString(MistieData::filtStr()," ",MistieData::binFiltStr())) );
         filefld_->setElemSzPol(uiObject::WideVar);
 
         actiongrp_ = new uiButtonGroup( this, "", OD::Horizontal );
@@ -419,7 +420,8 @@ void uiMistieAnalysisMainWin::openCB( CallBacker* )
         corrviewer_->close();
 
     BufferString defseldir = FilePath(GetDataDir()).add(MistieData::defDirStr()).fullPath();
-    uiFileDialog dlg( this, true, 0, MistieData::filtStr(), tr("Load Mistie File") );
+    uiFileDialog dlg( this, true, 0, BufferString(MistieData::filtStr()," ",MistieData::binFiltStr()),
+		      tr("Load Mistie File") );
     dlg.setDirectory(defseldir);
     if (!dlg.go())
         return;
@@ -449,16 +451,25 @@ void uiMistieAnalysisMainWin::saveasCB( CallBacker* )
 {
     if (misties_.size()>0) {
         BufferString defseldir = FilePath(GetDataDir()).add(MistieData::defDirStr()).fullPath();
-        uiFileDialog dlg( this, false, 0, MistieData::filtStr(), tr("Save Misties") );
+        uiFileDialog dlg( this, false, 0, BufferString(MistieData::filtStr(),";;",MistieData::binFiltStr()),
+			  tr("Save Misties") );
         dlg.setMode(uiFileDialog::AnyFile);
         dlg.setDirectory(defseldir);
-        dlg.setDefaultExtension(MistieData::extStr());
         dlg.setConfirmOverwrite(true);
         dlg.setSelectedFilter(MistieData::filtStr());
         if (!dlg.go())
             return;
 
-        filename_ = dlg.fileName();
+        // No default extension on the dialog, it would be added whichever filter is selected
+        FilePath fp( dlg.fileName() );
+        if (!*fp.extension()) {
+            const bool binary = BufferString(dlg.selectedFilter())==MistieData::binFiltStr();
+            fp.setExtension( binary ? MistieData::binExtStr() : MistieData::extStr() );
+            if (File::exists(fp.fullPath()) &&
+                !uiMSG().askOverwrite(tr("%1 already exists.\nOverwrite?").arg(fp.fileName())))
+                return;
+        }
+        filename_ = fp.fullPath();
         raise();
         saveCB(0);
     }
@@ -0,0 +1,58 @@
+#ifndef perthread_h
+#define perthread_h
+
+/*
+ *   Per thread objects for parallel attribute computation
+ *   Copyright (C) 2026  Wayne Mogg
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "manobjectset.h"
+#include "threadlock.h"
+
+/*
+ * Lazily created object per thread id, kept between calls so scratch space is only
+ * allocated once per thread. T must be default constructible, and can be a type that is
+ * only declared in the header of the owner as long as the owner destructor is defined
+ * where T is complete:
+ *
+ *    struct Workspace;
+ *    wmThreads::PerThread<Workspace>	workspaces_;
+ *    ...
+ *    Workspace& ws = workspaces_.get( threadid );
+ */
+namespace wmThreads {
+
+template <class T>
+class PerThread
+{
+public:
+    T&		get( int threadid ) const
+		{
+		    Threads::Locker lckr( lock_ );
+		    const int idx = threadid<0 ? 0 : threadid;
+		    while ( objs_.size() <= idx )
+			objs_ += new T;
+		    return *objs_[idx];
+		}
+
+protected:
+    mutable ManagedObjectSet<T>	objs_;
+    mutable Threads::Lock	lock_;
+};
+
+} // namespace wmThreads
+
+#endif
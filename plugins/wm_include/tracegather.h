@@ -0,0 +1,202 @@
+#ifndef tracegather_h
+#define tracegather_h
+
+/*
+ *   Multi-trace gather for stepout attributes
+ *   Copyright (C) 2026  Wayne Mogg
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "attribdataholder.h"
+#include "objectset.h"
+#include "odmemory.h"
+#include "valseries.h"
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define mWMGatherSSE2
+#endif
+
+/*
+ * Copies sample windows of many traces straight from the DataHolder value series into a
+ * trace-major block, each trace contiguous, with undefined and missing samples replaced by
+ * a fill value. Use mUdf(float) as the fill value to keep undefined samples.
+ *
+ * Inputs on fractional sample positions or without a value series fall back to a caller
+ * supplied functor, normally a lambda around Provider::getInputValue:
+ *
+ *    auto getval = [&]( const DataHolder& dh, int sampidx )
+ *		    { return getInputValue( dh, dataidx_, sampidx, z0 ); };
+ *    wmGather::TraceBlock<float> block( inputdata_.size(), sz );
+ *    wmGather::gatherTraces( inputdata_, dataidx_, z0, zmargin_.start, sz,
+ *			     block.data(), block.stride(), getval );
+ */
+namespace wmGather {
+
+// The undefined value range tested by mIsUdf
+static const float cUdfLow = 9.99999e29f;
+static const float cUdfHigh = 1.00001e30f;
+
+// Copy n values replacing undefined ones by fill
+inline void maskCopy( const float* src, float* dst, int n, float fill )
+{
+    int idx = 0;
+    if ( mIsUdf(fill) ) {
+	if ( src != dst )
+	    OD::memCopy( dst, src, n*sizeof(float) );
+	return;
+    }
+#ifdef mWMGatherSSE2
+    const __m128 lo = _mm_set1_ps( cUdfLow );
+    const __m128 hi = _mm_set1_ps( cUdfHigh );
+    const __m128 fv = _mm_set1_ps( fill );
+    for ( ; idx+4<=n; idx+=4 ) {
+	const __m128 v = _mm_loadu_ps( src+idx );
+	const __m128 udf = _mm_and_ps( _mm_cmpgt_ps(v,lo), _mm_cmplt_ps(v,hi) );
+	_mm_storeu_ps( dst+idx, _mm_or_ps(_mm_andnot_ps(udf,v), _mm_and_ps(udf,fv)) );
+    }
+#endif
+    for ( ; idx<n; idx++ )
+	dst[idx] = mIsUdf(src[idx]) ? fill : src[idx];
+}
+
+inline void maskCopy( const float* src, double* dst, int n, double fill )
+{
+    int idx = 0;
+    const bool keepudf = mIsUdf(fill);
+#ifdef mWMGatherSSE2
+    const __m128 lo = _mm_set1_ps( cUdfLow );
+    const __m128 hi = _mm_set1_ps( cUdfHigh );
+    const __m128 fv = _mm_set1_ps( keepudf ? mUdf(float) : float(fill) );
+    for ( ; idx+4<=n; idx+=4 ) {
+	__m128 v = _mm_loadu_ps( src+idx );
+	if ( !keepudf ) {
+	    const __m128 udf = _mm_and_ps( _mm_cmpgt_ps(v,lo), _mm_cmplt_ps(v,hi) );
+	    v = _mm_or_ps( _mm_andnot_ps(udf,v), _mm_and_ps(udf,fv) );
+	}
+	_mm_storeu_pd( dst+idx, _mm_cvtps_pd(v) );
+	_mm_storeu_pd( dst+idx+2, _mm_cvtps_pd(_mm_movehl_ps(v,v)) );
+    }
+#endif
+    for ( ; idx<n; idx++ )
+	dst[idx] = !keepudf && mIsUdf(src[idx]) ? fill : src[idx];
+}
+
+inline void fill( float* dst, int n, float val )
+{ for ( int idx=0; idx<n; idx++ ) dst[idx] = val; }
+
+inline void fill( double* dst, int n, double val )
+{ for ( int idx=0; idx<n; idx++ ) dst[idx] = val; }
+
+/*
+ * Gather sz samples of series dataidx of one trace, starting zstart samples from z0, into res.
+ * getval(const DataHolder&, int sampidx) is used when the series can not be read directly.
+ */
+template <typename T, typename GetValFn>
+void gatherTrace( const Attrib::DataHolder* data, int dataidx, int z0, int zstart, int sz,
+		  T* res, GetValFn getval, float fillval=0.f )
+{
+    const T udfval = mIsUdf(fillval) ? mUdf(T) : T(fillval);
+    if ( !data ) {
+	fill( res, sz, udfval );
+	return;
+    }
+
+    const ValueSeries<float>* vals = data->series( dataidx );
+    const float* arr = vals ? vals->arr() : nullptr;
+    if ( !vals || !mIsZero(data->extrazfromsamppos_,mDefEps) ) {
+	for ( int idx=0; idx<sz; idx++ ) {
+	    const float val = getval( *data, zstart+idx );
+	    res[idx] = mIsUdf(val) ? udfval : val;
+	}
+	return;
+    }
+
+    const int shift = z0 - data->z0_ + zstart;
+    const int start = mMIN( mMAX(0, -shift), sz );
+    const int stop = mMAX( mMIN(sz, data->nrsamples_-shift), start );
+    fill( res, start, udfval );
+    fill( res+stop, sz-stop, udfval );
+    if ( stop<=start )
+	return;
+
+    if ( arr )
+	maskCopy( arr+shift+start, res+start, stop-start, fillval );
+    else {
+	for ( int idx=start; idx<stop; idx++ ) {
+	    const float val = vals->value( shift+idx );
+	    res[idx] = mIsUdf(val) ? udfval : val;
+	}
+    }
+}
+
+/*
+ * Gather the same window of all traces in data, trace trcidx going to res+trcidx*stride.
+ */
+template <typename T, typename GetValFn>
+void gatherTraces( const ObjectSet<const Attrib::DataHolder>& data, int dataidx, int z0,
+		   int zstart, int sz, T* res, int stride, GetValFn getval, float fillval=0.f )
+{
+    for ( int trcidx=0; trcidx<data.size(); trcidx++ )
+	gatherTrace( data[trcidx], dataidx, z0, zstart, sz, res+trcidx*stride, getval,
+		     fillval );
+}
+
+/*
+ * Cache line aligned (nrtraces x nrsamples) block, each trace starting on a cache line.
+ */
+template <typename T>
+class TraceBlock
+{
+public:
+		TraceBlock( int nrtrcs=0, int nrsamples=0 )	{ setSize(nrtrcs,nrsamples); }
+
+    void	setSize( int nrtrcs, int nrsamples )
+		{
+		    const int align = cAlign / sizeof(T);
+		    nrtrcs_ = nrtrcs;
+		    nrsamples_ = nrsamples;
+		    stride_ = (nrsamples+align-1) / align * align;
+		    buf_.resize( size_t(nrtrcs_)*stride_ + align );
+		    const uintptr_t addr = reinterpret_cast<uintptr_t>( buf_.data() );
+		    offset_ = int( ((cAlign - addr%cAlign) % cAlign) / sizeof(T) );
+		}
+
+    int		nrTraces() const			{ return nrtrcs_; }
+    int		nrSamples() const			{ return nrsamples_; }
+    int		stride() const				{ return stride_; }
+
+    T*		data()					{ return buf_.data()+offset_; }
+    const T*	data() const				{ return buf_.data()+offset_; }
+    T*		trace( int trcidx )			{ return data()+trcidx*stride_; }
+    const T*	trace( int trcidx ) const		{ return data()+trcidx*stride_; }
+    T		get( int trcidx, int sampidx ) const	{ return trace(trcidx)[sampidx]; }
+
+protected:
+    static const int	cAlign = 64;
+
+    std::vector<T>	buf_;
+    int			nrtrcs_;
+    int			nrsamples_;
+    int			stride_;
+    int			offset_;
+};
+
+} // namespace wmGather
+
+#endif